@@ -2,6 +2,10 @@
 //#include <glm\glm.hpp>
 //#include <glm\gtc\matrix_transform.hpp>
 #include "Vertex.h"
+#include "common/jobSystem.h"
+#include "common/sinCos.h"
+#include <cassert>
+#include <vector>
 
 #define PI 3.14159265359
 using glm::vec3;
@@ -25,17 +29,24 @@ ShapeData ShapeGenerator::makePlaneVerts(uint dimensions)
 	ret.numVertices = dimensions * dimensions;
 	int half = dimensions / 2;
 	ret.vertices = new Vertex[ret.numVertices];
-	for (int i = 0; i < dimensions; i++)
+	// rows in parallel bands, each vertex has its fixed place
+	JobSystem::getInstance().runBands(dimensions, dimensions, [&](size_t firstRow, size_t endRow)
 	{
-		for (int j = 0; j < dimensions; j++)
+		for (int i = (int)firstRow; i < (int)endRow; i++)
 		{
-			Vertex& thisVert = ret.vertices[i * dimensions + j];
-			thisVert.position.x = j - half;
-			thisVert.position.z = i - half;
-			thisVert.position.y = 0;
-			thisVert.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-			thisVert.color = randomColor();
+			for (int j = 0; j < dimensions; j++)
+			{
+				Vertex& thisVert = ret.vertices[i * dimensions + j];
+				thisVert.position.x = j - half;
+				thisVert.position.z = i - half;
+				thisVert.position.y = 0;
+				thisVert.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+			}
 		}
+	});
+	// colors stay serial, rand() sequence must give the same colors to the same vertices
+	for (uint i = 0; i < ret.numVertices; i++) {
+		ret.vertices[i].color = randomColor();
 	}
 	return ret;
 }
@@ -45,21 +56,25 @@ ShapeData ShapeGenerator::makePlaneIndices(uint dimensions)
 	ShapeData ret;
 	ret.numIndices = (dimensions - 1) * (dimensions - 1) * 2 * 3; // 2 triangles per square, 3 indices per triangle
 	ret.indices = new unsigned short[ret.numIndices];
-	int runner = 0;
-	for (int row = 0; row < dimensions - 1; row++)
+	// rows in parallel bands, every row starts at its own fixed runner
+	JobSystem::getInstance().runBands(dimensions - 1, (dimensions - 1) * 6, [&](size_t firstRow, size_t endRow)
 	{
-		for (int col = 0; col < dimensions - 1; col++)
+		size_t runner = firstRow * (dimensions - 1) * 6;
+		for (int row = (int)firstRow; row < (int)endRow; row++)
 		{
-			ret.indices[runner++] = dimensions * row + col;
-			ret.indices[runner++] = dimensions * row + col + dimensions;
-			ret.indices[runner++] = dimensions * row + col + dimensions + 1;
+			for (int col = 0; col < dimensions - 1; col++)
+			{
+				ret.indices[runner++] = dimensions * row + col;
+				ret.indices[runner++] = dimensions * row + col + dimensions;
+				ret.indices[runner++] = dimensions * row + col + dimensions + 1;
 
-			ret.indices[runner++] = dimensions * row + col;
-			ret.indices[runner++] = dimensions * row + col + dimensions + 1;
-			ret.indices[runner++] = dimensions * row + col + 1;
+				ret.indices[runner++] = dimensions * row + col;
+				ret.indices[runner++] = dimensions * row + col + dimensions + 1;
+				ret.indices[runner++] = dimensions * row + col + 1;
+			}
 		}
-	}
-	assert(runner = ret.numIndices);
+		assert(runner == endRow * (dimensions - 1) * 6);
+	});
 	return ret;
 }
 
@@ -84,19 +99,25 @@ ShapeData ShapeGenerator::makeSphere(uint tesselation)
 	const float RADIUS = 1.0f;
 	const double CIRCLE = PI * 2;
 	const double SLICE_ANGLE = CIRCLE / (dimensions - 1);
-	for (size_t col = 0; col < dimensions; col++)
+
+	// sines / cosines of every column and row angle once, instead of once per vertex
+	std::vector<float> phiSines(dimensions), phiCosines(dimensions), thetaSines(dimensions), thetaCosines(dimensions);
+	SinCos::computeSteps(0.0f, (float)-SLICE_ANGLE, dimensions, phiSines.data(), phiCosines.data());
+	SinCos::computeSteps(0.0f, (float)(-SLICE_ANGLE / 2.0), dimensions, thetaSines.data(), thetaCosines.data());
+	JobSystem::getInstance().runBands(dimensions, dimensions, [&](size_t firstCol, size_t endCol)
 	{
-		double phi = -SLICE_ANGLE * col;
-		for (size_t row = 0; row < dimensions; row++)
+		for (size_t col = firstCol; col < endCol; col++)
 		{
-			double theta = -(SLICE_ANGLE / 2.0) * row;
-			size_t vertIndex = col * dimensions + row;
-			Vertex& v = ret.vertices[vertIndex];
-			v.position.x = RADIUS * cos(phi) * sin(theta);
-			v.position.y = RADIUS * sin(phi) * sin(theta);
-			v.position.z = RADIUS * cos(theta);
-			v.normal = glm::normalize(v.position);
+			for (size_t row = 0; row < dimensions; row++)
+			{
+				size_t vertIndex = col * dimensions + row;
+				Vertex& v = ret.vertices[vertIndex];
+				v.position.x = RADIUS * phiCosines[col] * thetaSines[row];
+				v.position.y = RADIUS * phiSines[col] * thetaSines[row];
+				v.position.z = RADIUS * thetaCosines[row];
+				v.normal = glm::normalize(v.position);
+			}
 		}
-	}
+	});
 	return ret;
 }
\ No newline at end of file
@@ -6,24 +6,55 @@
 
 // Using GLM
 #include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "camera.h"
 #include "ShapeData.h"
 #include "ShapeGenerator.h"
 #include "cylinder.h"
 #include "torus.h"
 #include "Sphere.h"
-
-// Cylinder Structure for VAO,VBO
-struct CylinderMesh {
-	unsigned int vao;
-	unsigned int vbo;
-	unsigned int texture;
-	unsigned int vertices;
-};
+#include "common/uniformTable.h"
+#include "common/uniformBufferObject.h"
+#include "common/uniformBlocks.h"
+#include "common/renderQueue.h"
+#include "common/instanceBuffer.h"
+#include "common/textureArrayPool.h"
+#include "common/textureCache.h"
+#include "common/glStateCache.h"
+#include "common/profiler.h"
+#include "common/headlessContext.h"
+#include "common/offscreenFramebuffer.h"
+#include "common/cameraPath.h"
+#include "common/benchmarkReport.h"
+#include "common/uploadCounter.h"
+#include "common/sceneFile.h"
+#include "common/transformHierarchy.h"
+#include "common/bounds.h"
+#include "common/frustumCuller.h"
+#include "common/bvh.h"
+#include "common/jobSystem.h"
+#include "common/geometryPool.h"
+#include "common/gpuCuller.h"
+#include "common/lodSelector.h"
+#include "common/occlusionCuller.h"
+#include "common/lightClusters.h"
+#include "common/geometryRegistry.h"
+#include "common/meshBenchmark.h"
 
 // Plane Structure for VAO, VBO and other variables
 struct PlaneMesh {
@@ -35,18 +66,9 @@ struct PlaneMesh {
 	unsigned int planeNumIndices;
 	unsigned int planeIndexByteOffset;
 	unsigned int planeVertexArrayObjectID;
+	Bounds bounds; // Local space bounds, for culling
 };
 
-// Structure for torus buffers and vertices
-struct TorusMesh {
-	int nVertices;
-	GLfloat* uvData;
-	unsigned int vao;
-	GLfloat* vertexData;
-	unsigned int texture;
-	unsigned int uvBuffer;
-	unsigned int vertexBuffer;
-}; 
 
 struct SphereMesh {
 	unsigned int vao;
@@ -62,35 +84,109 @@ struct CubeMesh {
 	unsigned int vbo;
 	unsigned int texture;
 	unsigned int vertices;
+	Bounds bounds; // Local space bounds, for culling
+};
+
+// One draw call of a scene mesh (the cylinder needs three: side, top and bottom cover)
+typedef GeometryDraw SceneMeshDraw;
+
+// Scene mesh as seen by the render queue, the geometry itself is shared through the geometry registry
+struct SceneMesh {
+	GeometryHandle geometry; // Keeps the geometry alive, vao, index and draws below are copied from it
+	glm::vec3 scale; // Scale of the unit-size geometry to the mesh, applied by a transform node of its own
+	unsigned int vao;
+	GLenum indexType; // 0 for non-indexed meshes
+	uintptr_t indexByteOffset;
+	std::vector<SceneMeshDraw> draws;
+	Bounds bounds; // Local space bounds of the geometry
+	float lodError; // Largest distance of the tessellated surface from the exact primitive, in local units
+	std::vector<unsigned int> lods; // LOD chain of a scene mesh, finest first: lods[0] is the mesh itself, tessellation is halved at every next level
+	std::vector<float> lodErrors; // lodError of every level of the chain
+	bool isOccluder; // Large opaque objects of the mesh hide other objects in the occlusion buffer
+	glm::vec3 occluderMin; // Local space box inside the geometry, rasterized for occluders
+	glm::vec3 occluderMax;
+};
+
+// Run of scene objects sharing pass, group, mesh and texture, drawn with one instanced draw per mesh draw
+struct SceneDrawGroup {
+	RenderPass pass;
+	const char* timingGroup; // Points into the scene string table
+	unsigned int mesh;
+	unsigned int texture;
+	unsigned int firstObject;
+	unsigned int numObjects;
+	unsigned int firstVisible; // Visible objects of the group in sceneVisibleObjects
+	unsigned int numVisible;
+	InstanceRange instances; // Same range as the visible objects, but only lit groups draw them instanced
+	InstanceRange lodInstances[LodSelector::MAX_LEVELS]; // Sub-ranges of instances drawn with every level of the mesh LOD chain
+	bool isGpuDriven; // Culled by sceneGpuCuller and drawn by indirect commands, skipped by the CPU path
+};
+
+// Range of scene objects culled on the CPU by one job
+struct SceneCullJob {
+	unsigned int firstObject;
+	unsigned int numObjects;
+};
+
+// Indirect commands sharing a texture, drawn by one glMultiDrawElementsIndirect
+struct SceneIndirectDraw {
+	unsigned int texture;
+	unsigned int firstCommand;
+	unsigned int numCommands;
 };
 
 // User Utility Functions
 void windowResize(GLFWwindow* window, int width, int height);
+// Command line options
+struct AppOptions {
+	bool headless = false; // --headless: no window, render into an FBO through a surfaceless EGL context
+	int numFrames = 0; // --frames N: quit after N frames, 0 runs until the window is closed
+	bool uncapped = false; // --uncapped: do not wait for vertical sync (headless rendering is never capped)
+	std::string dumpPrefix; // --dump PREFIX: write every frame to PREFIX_NNNN.ppm
+	std::string cameraPathFile; // --camera-path FILE: replay camera path on a fixed timestep instead of live input
+	std::string recordFile; // --record FILE: record live camera to a camera path file
+	std::string reportFile; // --report FILE: write JSON benchmark report (frame times, draws, triangles, uploads)
+	std::string sceneFile = "scenes/candle.scene"; // --scene FILE: text scene, or baked binary scene (.sceneb)
+	std::string bakeFile; // --bake-scene FILE: write the loaded scene in binary form and quit
+	uint32_t numThreads = 0; // --threads N: threads culling and recording the frame, 0 for one per hardware thread
+	bool gpuDriven = false; // --gpu-driven: cull and draw opaque objects on the GPU with multi-draw-indirect (OpenGL 4.3)
+	bool textureArrays = false; // --texture-arrays: pack diffuse textures into texture array layers, objects of different textures share draws
+	float lodPixelError = 1.0f; // --lod-error PIXELS: screen-space error allowed for levels of detail of parametric primitives, 0 draws them at full tessellation
+	bool occlusionCulling = false; // --occlusion: skip objects hidden behind large opaque boxes, planes and containers, tested on the CPU
+	bool meshBenchmark = false; // --bench-meshes: check that the SinCos kernels agree bit for bit, time generation of parametric meshes at 64 to 4096 segments, print the table and quit
+};
+
 void processInput(GLFWwindow* window);
+void keyPressed(GLFWwindow* window, int key, int scancode, int action, int mods); // One-shot keys: N reports object nearest to the camera
+glm::mat4 getProjectionMatrix(); // Perspective or orthographic projection of the camera
 unsigned int loadTexture(char const* path);
-unsigned int loadSphereTexture(char const* path);
+bool parseOptions(int argc, char* argv[], AppOptions& options);
 bool initializeWindow(GLFWwindow** window);
+bool initializeHeadless(); // Create surfaceless context instead of window
 
 // Plane
 void planeMeshCreation(PlaneMesh& mesh, int planeDimension);
 void planeMeshDeletion(PlaneMesh& mesh);
-void planeRender(PlaneMesh& mesh, unsigned int& shader, glm::mat4 MVP);
 
 // Cube
 void containerMeshCreation(CubeMesh& mesh);
 void cubeMeshCreation(CubeMesh& mesh);
 void cubeMeshDeletion(CubeMesh& mesh);
-void cubeRender(CubeMesh& mesh, unsigned int& shader, glm::mat4 MVP);
-
-// Cylinder 
-void cylinderMeshCreation(CylinderMesh& mesh); // Create Cylinder vertices
-void cylinderMeshDeletion(CylinderMesh& mesh); // Delete cylinder buffers
-void cylinderRender(const static_meshes_3D::Cylinder& cylinder, CylinderMesh& mesh, unsigned int& shader, glm::mat4 MVP); // Render the cylinder
 
-// Torus
-Torus torusMeshCreation(TorusMesh& mesh, float innerRadius, float outterRadius); // Create vertices for torus
-void torusMeshDeletion(TorusMesh& mesh); // Delete buffers and pointers for torus
-void torusRender(TorusMesh& mesh, unsigned int& shader, glm::mat4 MVP); // Render Torus
+// Scene
+bool sceneMeshesCreation(const SceneFile& scene); // Create geometry of every scene mesh and LOD chains of parametric primitives
+bool scenePrimitiveCreation(const SceneMeshRecord& record, uint32_t lod, SceneMesh& mesh); // Create geometry of a scene mesh, tessellation of parametric primitives divided by 2^lod
+uint32_t sceneGetNumLods(const SceneMeshRecord& record); // Levels of the LOD chain of a scene mesh, 1 for meshes without tessellation parameters
+void sceneMeshesDeletion();
+void sceneTransformsCreation(const SceneFile& scene); // Build transform hierarchy of scene objects, parents first
+void sceneDrawGroupsCreation(const SceneFile& scene); // Group sorted scene objects into draw groups
+bool sceneGpuDrivenCreation(const SceneFile& scene); // Copy meshes of GPU-driven draw groups into the geometry pool and create their indirect commands
+bool sceneTransformsUpdate(const SceneFile& scene); // Recompute moved subtrees and their world bounds, true if anything moved
+void sceneCull(const SceneFile& scene, const glm::mat4& viewProjection, bool hasMoved, InstanceBuffer& instances); // Rebuild instances of visible objects, if they have changed
+void sceneOcclusionCull(const SceneFile& scene, const glm::mat4& viewProjection); // Drop culled objects hidden behind the nearest large occluders
+void sceneSubmit(RenderQueue& queue, const RenderProgram& litProgram, const RenderProgram& unlitProgram, const RenderProgram& gpuDrivenProgram, const InstanceBuffer& instances); // Record visible objects, one command buffer per job
+void scenePick(GLFWwindow* window, int button, int action, int mods); // Left click reports scene object under the cursor
+GLint sceneGetTextureLayer(const SceneObjectRecord& object); // Layer of the object texture in its texture array, 0 for 2D textures
 
 // Shader Functions
 bool createShaders(const char* vertexShaderSource, const char* fragmentShaderSource, unsigned int& programID); // Link shaders
@@ -110,79 +206,184 @@ static bool perspectiveVal = true; // For switching perspectives
 // Window Pointer
 GLFWwindow* window = nullptr;
 
+// Headless mode
+AppOptions appOptions;
+HeadlessContext headlessContext;
+OffscreenFramebuffer offscreenFramebuffer; // Render target, as there is no default framebuffer
+
+// Scene
+SceneFile scene; // Parsed text scene, or baked scene mapped from its file
+std::vector<SceneMesh> sceneMeshes; // Indexed as SceneMeshRecord
+std::vector<SceneDrawGroup> sceneDrawGroups;
+std::vector<unsigned int> sceneTextureIDs; // Indexed as SceneTextureRecord
+TransformHierarchy sceneTransforms; // World matrices of scene objects, recomputed only when they move
+std::vector<uint32_t> sceneObjectNodes; // Transform node every scene object is drawn with, scaling its mesh geometry
+std::vector<uint32_t> sceneNodeObjects; // Scene object of every transform node, both of the object and of its geometry
+FrustumCuller sceneCuller; // World bounds of scene objects, indexed as SceneObjectRecord
+std::vector<uint32_t> sceneVisibleObjects; // Objects visible in the last frame, instances are built for them
+Bvh sceneBvh; // Hierarchy over world boxes of drawable scene objects, built on first update and refit when they move
+std::vector<uint32_t> sceneCulledObjects; // Visible objects found in this frame, sorted
+std::vector<std::vector<uint32_t>> sceneJobVisibleObjects; // Visible objects found by every cull job
+std::vector<uint32_t> sceneBvhSubtrees; // Subtrees of the hierarchy culled by separate jobs
+std::vector<SceneCullJob> sceneCullJobs; // Objects tested by every cull job, when the hierarchy is not used
+GeometryPool sceneGeometryPool; // Meshes of GPU-driven draw groups in shared vertex and index buffers
+GpuCuller sceneGpuCuller; // Culls objects of GPU-driven draw groups and writes their indirect commands
+std::vector<SceneIndirectDraw> sceneIndirectDraws;
+const uint32_t SCENE_BVH_MIN_OBJECTS = 4096; // Smaller scenes are culled by testing every object, which is faster than traversal
+const uint32_t SCENE_BVH_JOB_DEPTH = 4; // Hierarchy is culled by one job per subtree at this depth
+const uint32_t SCENE_CULL_JOB_OBJECTS = 4096; // Objects tested by one cull job, multiple of FrustumCuller::BATCH_SIZE
+const uint32_t SCENE_INSTANCE_JOB_OBJECTS = 2048; // Visible objects written to the instance buffer by one job
+const uint32_t SCENE_RECORD_JOB_GROUPS = 8; // Draw groups recorded by one job
+const int SCENE_LOD_MIN_SEGMENTS = 6; // LOD chains end before a level with fewer segments around a circle
+const int SCENE_TORUS_SEGMENTS = 180; // Segments of the finest torus, around both of its circles
+LodSelector sceneLodSelector; // Picks LOD level of visible objects from their projected geometric error
+std::vector<uint8_t> sceneObjectLods; // Level of detail every scene object has been drawn with
+std::vector<uint8_t> sceneJobLodChanges; // Set by LOD jobs, which changed level of any object
+std::vector<uint32_t> sceneInstanceObjects; // Visible objects in instance order: draw groups by LOD level
+OcclusionCuller sceneOcclusionCuller; // Depth buffer of the occluders of the frame, with --occlusion
+std::vector<std::pair<float, uint32_t>> sceneOccluders; // Projected size and object of the occluder candidates of the frame
+const int SCENE_OCCLUSION_WIDTH = 256; // Width of the occlusion buffer, its height follows the window aspect ratio
+const size_t SCENE_MAX_OCCLUDERS = 64; // Largest occluder candidates rasterized per frame
+const float SCENE_OCCLUDER_MIN_SIZE = 0.05f; // Smaller occluders (bounding sphere radius / view depth) hide too little to be worth rasterizing
+GeometryRegistry sceneGeometryRegistry; // Unit-size primitives shared by all scene meshes of the same shape and tessellation
+
+// Benchmark
+CameraPath cameraPath; // Replayed or recorded camera
+BenchmarkReport benchmarkReport;
+
 // Camera Details
 Camera camera(glm::vec3(0.0f, 0.5f, 3.0f));
 float lastX = WINDOW_WIDTH / 2.0f;
 float lastY = WINDOW_HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// Textures
+TextureCache textureCache; // Decodes and uploads every image only once
+std::vector<TextureHandle> sceneTextures; // Keeps textures used by the scene alive
+TextureArrayPool sceneTextureArrays; // Diffuse textures of the scene as layers of texture arrays, with --texture-arrays
+std::vector<GLint> sceneTextureLayers; // Layer of every scene texture in its array (0 for 2D textures), indexed as SceneTextureRecord
+
+// Lights
+LightClusters sceneLightClusters; // Lights of the scene binned into clusters of the view frustum, read by the lit shaders
+
 // Timing
 float deltaTime = 0.0f; // time difference between current frame and last frame
 float lastFrame = 0.0f;
 
 // Global Variables
-// General Shaders
-const char* vertexShader = "#version 330 core\n"
+// General Shaders, model matrix and material come from the instance buffer
+const char* instancedVertexShader = "#version 330 core\n"
+FRAME_BLOCK_GLSL
 "layout (location = 0) in vec3 aPos;\n"
 "layout (location = 1) in vec2 textureCoords;\n"
 "layout (location = 2) in vec3 aNormal;\n"
+"layout (location = 3) in mat4 instanceModel;\n"
+"layout (location = 7) in int instanceMaterial;\n"
+"layout (location = 8) in int instanceTextureLayer;\n"
 "out vec3 Normal;\n"
 "out vec3 FragPos;\n"
-"uniform mat4 model;\n"
-"uniform mat4 MVP;\n"
 "out vec2 textCoord;\n"
+"flat out int materialIndex;\n"
+"flat out int textureLayer;\n"
 "void main()\n"
 "{\n"
-"   FragPos = vec3(model * vec4(aPos, 1.0));\n"
-"   Normal = mat3(transpose(inverse(model))) * aNormal;;\n"
-"	gl_Position = MVP * vec4(aPos, 1.0f); \n"
+"   FragPos = vec3(instanceModel * vec4(aPos, 1.0));\n"
+"   Normal = mat3(transpose(inverse(instanceModel))) * aNormal;\n"
+"	gl_Position = projection * view * vec4(FragPos, 1.0f); \n"
 "	textCoord = textureCoords;\n"
+"	materialIndex = instanceMaterial;\n"
+"	textureLayer = instanceTextureLayer;\n"
 "}\0";
 
+// Diffuse texture of the lit fragment shaders: 2D texture bound per draw, or texture array with the layer of the instance
+#define DIFFUSE_TEXTURE_GLSL \
+"uniform sampler2D diffuseTexture;\n" \
+"vec3 sampleDiffuse(vec2 uv) { return texture(diffuseTexture, uv).rgb; }\n"
+#define DIFFUSE_TEXTURE_ARRAY_GLSL \
+"uniform sampler2DArray diffuseTexture;\n" \
+"flat in int textureLayer;\n" \
+"vec3 sampleDiffuse(vec2 uv) { return texture(diffuseTexture, vec3(uv, float(textureLayer))).rgb; }\n"
+
+// Phong lighting of the lit fragment shaders, pasted after the diffuse texture declaration. Only lights of the cluster of the fragment are shaded.
+#define PHONG_FRAGMENT_GLSL \
+FRAME_BLOCK_GLSL \
+MATERIAL_BLOCK_GLSL \
+LIGHT_CLUSTERS_GLSL \
+"out vec4 FragColor; \n" \
+"in vec3 FragPos;\n" \
+"in vec3 Normal;\n" \
+"uniform vec4 ourColor; \n" \
+"in vec2 textCoord;" \
+"flat in int materialIndex;\n" \
+"uniform sampler2D specularTexture;\n" \
+"void main() {\n" \
+"vec3 norm = normalize(Normal);\n" \
+"vec3 viewDir = normalize(viewPosition.xyz - FragPos);\n" \
+"vec2 uvScale = materials[materialIndex].uvScale;\n" \
+"float shininess = materials[materialIndex].shininess;\n" \
+"vec3 diffuseColor = sampleDiffuse(textCoord * uvScale);\n" \
+"vec3 specularColor = texture(specularTexture, textCoord * uvScale).rgb;\n" \
+"vec3 phong = vec3(0.0);\n" \
+"uvec2 cluster = getCluster(FragPos);\n" \
+"for (uint i = 0u; i < cluster.y; i++) {\n" \
+"    LightSource light = getClusterLight(cluster, i);\n" \
+"    vec3 ambient = light.ambient.rgb * diffuseColor;\n" \
+"    vec3 lightDir = normalize(light.position.xyz - FragPos);\n" \
+"    float diff = max(dot(norm, lightDir), 0.0);\n" \
+"    vec3 diffuse = light.diffuse.rgb * diff * diffuseColor;\n" \
+"    vec3 reflectDir = reflect(-lightDir, norm);\n" \
+"    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), shininess);\n" \
+"    vec3 specular = light.specular.rgb * specularComponent * specularColor;\n" \
+"    float distance = length(light.position.xyz - FragPos);\n" \
+"    vec3 attenuation = light.attenuation.xyz;\n" \
+"    float falloff = 1.0 / (attenuation.x + attenuation.y * distance + attenuation.z * (distance * distance));\n" \
+"    phong += (ambient + diffuse + specular) * falloff;\n" \
+"}\n" \
+"FragColor = vec4(phong, 1.0);\n" \
+"}\n"
+
 const char* fragmentShader = "#version 330 core\n"
-"out vec4 FragColor; \n"
-"in vec3 FragPos;\n"
-"in vec3 Normal;\n"
-"uniform vec4 ourColor; \n"
-"in vec2 textCoord;"
-"struct LightSource {\n"
-"    vec3 position;\n"
-"    vec3 ambientStr;\n"
-"    vec3 specular;\n"
-"	 vec3 diffuse;\n"
-"	 float constant;\n"
-"    float linear;\n"
-"    float quadratic;\n"
-"};\n"
-"uniform float shininess;\n"
-"uniform vec3 viewPosition;\n"
-"uniform sampler2D diffuseTexture;\n"
-"uniform sampler2D specularTexture;\n"
-"uniform vec2 uvScale;\n"
-"uniform LightSource light1;\n"
-"void main() {\n"
-"vec3 norm = normalize(Normal);\n"
-"vec3 viewDir = normalize(viewPosition - FragPos);\n"
-"vec3 ambient1 = light1.ambientStr * texture(diffuseTexture, textCoord * uvScale).rgb;\n"
-"vec3 lightDir1 = normalize(light1.position - FragPos);\n"
-"float diff1 = max(dot(norm, lightDir1), 0.0);\n"
-"vec3 diffuse1 = light1.diffuse * diff1 * texture(diffuseTexture, textCoord * uvScale).rgb;\n"
-"vec3 reflectDir1 = reflect(-lightDir1, norm);\n"
-"float specularComponent1 = pow(max(dot(viewDir, reflectDir1), 0.0), shininess);\n"
-"vec3 specular1 = light1.specular * specularComponent1 * texture(specularTexture, textCoord * uvScale).rgb;\n"
-"float distance = length(light1.position - FragPos);\n"
-"float attenuation = 1.0 / (light1.constant + light1.linear * distance + light1.quadratic * (distance * distance));\n"
-"vec3 phong = ((ambient1*attenuation) + (diffuse1*attenuation) + (specular1*attenuation));\n"
-"FragColor = vec4(phong, 1.0);\n"
+DIFFUSE_TEXTURE_GLSL
+PHONG_FRAGMENT_GLSL
+"\0";
+
+const char* textureArrayFragmentShader = "#version 330 core\n"
+DIFFUSE_TEXTURE_ARRAY_GLSL
+PHONG_FRAGMENT_GLSL
+"\0";
+
+// GPU-driven Shaders, model matrix and material of the drawn object come from the object buffer of the GPU culler
+const char* gpuDrivenVertexShader = "#version 430 core\n"
+FRAME_BLOCK_GLSL
+GPU_OBJECT_BUFFER_GLSL
+"layout (location = 0) in vec3 aPos;\n"
+"layout (location = 1) in vec2 textureCoords;\n"
+"layout (location = 2) in vec3 aNormal;\n"
+"layout (location = 3) in uint objectId;\n"
+"out vec3 Normal;\n"
+"out vec3 FragPos;\n"
+"out vec2 textCoord;\n"
+"flat out int materialIndex;\n"
+"flat out int textureLayer;\n"
+"void main()\n"
+"{\n"
+"   mat4 model = objects[objectId].model;\n"
+"   FragPos = vec3(model * vec4(aPos, 1.0));\n"
+"   Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+"	gl_Position = projection * view * vec4(FragPos, 1.0f); \n"
+"	textCoord = textureCoords;\n"
+"	materialIndex = objects[objectId].materialIndex;\n"
+"	textureLayer = objects[objectId].textureLayer;\n"
 "}\0";
 
 // Light Shaders
 const char* lightVertexShader = "#version 330 core\n"
+FRAME_BLOCK_GLSL
 "layout(location = 0) in vec3 aPos;\n"
-"uniform mat4 MVP;\n"
+"uniform mat4 model;\n"
 "void main()\n"
 "{\n"
-"    gl_Position = MVP * vec4(aPos, 1.0);\n"
+"    gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
 "}\0";
 
 const char* lightFragmentShader = "#version 330 core\n"
@@ -196,260 +397,388 @@ const char* lightFragmentShader = "#version 330 core\n"
 const uint NUM_FLOATS_PER_VERTICE = 9;
 const uint VERTEX_BYTE_SIZE = NUM_FLOATS_PER_VERTICE * sizeof(float);
 
-float xLight = -0.74f;
-float yLight = 0.66f;
-float zLight = 1.12f;
-
 // Shader programs
-unsigned int shaderProgram;
+unsigned int instancedShaderProgram;
 unsigned int lightShader;
+unsigned int gpuDrivenShaderProgram = 0;
 
-int main()
+// Active uniforms of the shader programs, reflected once after linking
+UniformTable instancedUniforms;
+UniformTable lightUniforms;
+UniformTable gpuDrivenUniforms;
+
+int main(int argc, char* argv[])
 {
-	if (!initializeWindow(&window)) {
+	if (!parseOptions(argc, argv, appOptions)) {
+		return -1;
+	}
+	JobSystem& jobSystem = JobSystem::getInstance();
+	jobSystem.start(appOptions.numThreads);
+	const bool isReplaying = !appOptions.cameraPathFile.empty();
+	if (isReplaying && !cameraPath.loadFromFile(appOptions.cameraPathFile)) {
+		return -1;
+	}
+
+	// Scene is loaded before the context, baking only converts it and needs no window
+	if (!scene.loadScene(appOptions.sceneFile)) {
+		return -1;
+	}
+	if (!appOptions.bakeFile.empty())
+	{
+		if (!scene.saveBinary(appOptions.bakeFile)) {
+			return -1;
+		}
+		std::cout << "Baked " << scene.getNumObjects() << " objects to " << appOptions.bakeFile << std::endl;
+		return 0;
+	}
+
+	if (!(appOptions.headless ? initializeHeadless() : initializeWindow(&window))) {
 		std::cout << "Error in intializing window" << std::endl;
 		return -1;
 	}
+	if (appOptions.gpuDriven && !GpuCuller::isSupported()) {
+		std::cout << "GPU-driven rendering needs OpenGL 4.3, culling on the CPU instead" << std::endl;
+		appOptions.gpuDriven = false;
+	}
+
+	// Meshes upload their buffers, so the benchmark runs once the context exists
+	if (appOptions.meshBenchmark)
+	{
+		const auto kernelsAgree = runMeshBenchmark(std::cout);
+		headlessContext.deleteContext();
+		glfwTerminate();
+		jobSystem.stop();
+		return kernelsAgree ? 0 : 1;
+	}
 
 	// Initialize Shaders
-	if (!createShaders(vertexShader, fragmentShader, shaderProgram)) {
-		std::cout << "Failure in Plane shader creation/compilation/linking." << std::endl;
+	const char* litFragmentShader = appOptions.textureArrays ? textureArrayFragmentShader : fragmentShader;
+	if (!createShaders(instancedVertexShader, litFragmentShader, instancedShaderProgram)) {
+		std::cout << "Failure in Instanced shader creation/compilation/linking." << std::endl;
 		return -1;
 	}
 	if (!createShaders(lightVertexShader, lightFragmentShader, lightShader)) {
 		std::cout << "Failure in Light shader creation/compilation/linking." << std::endl;
 		return -1;
 	}
+	if (appOptions.gpuDriven && !createShaders(gpuDrivenVertexShader, litFragmentShader, gpuDrivenShaderProgram)) {
+		std::cout << "Failure in GPU-driven shader creation/compilation/linking." << std::endl;
+		return -1;
+	}
+	instancedUniforms.reflectProgram(instancedShaderProgram);
+	lightUniforms.reflectProgram(lightShader);
+	if (appOptions.gpuDriven) {
+		gpuDrivenUniforms.reflectProgram(gpuDrivenShaderProgram);
+	}
+
+	// Uniform locations used by the render loop
+	const GLint lightModelLoc = lightUniforms.getLocation(uniformKey("model"));
+
+	// Uniform blocks shared by the scene programs, uploaded only when their content changes
+	UniformBufferObject frameBlock;
+	UniformBufferObject materialBlock;
+	frameBlock.createUBO(FRAME_BLOCK_BINDING, sizeof(FrameBlockData));
+	materialBlock.createUBO(MATERIAL_BLOCK_BINDING, sizeof(MaterialBlockData));
+	frameBlock.bindToProgram(lightShader, "FrameBlock");
+	frameBlock.bindToProgram(instancedShaderProgram, "FrameBlock");
+	materialBlock.bindToProgram(instancedShaderProgram, "MaterialBlock");
+	if (appOptions.gpuDriven) {
+		frameBlock.bindToProgram(gpuDrivenShaderProgram, "FrameBlock");
+		materialBlock.bindToProgram(gpuDrivenShaderProgram, "MaterialBlock");
+	}
+
+	// Scene lights, binned into clusters of the view frustum every frame
+	FrameBlockData frameData = {};
+	std::vector<LightBlockData> lights(scene.getNumLights());
+	for (uint32_t i = 0; i < scene.getNumLights(); i++) {
+		const SceneLightRecord& light = scene.getLight(i);
+		lights[i].position = glm::make_vec4(light.position);
+		lights[i].ambient = glm::make_vec4(light.ambient);
+		lights[i].diffuse = glm::make_vec4(light.diffuse);
+		lights[i].specular = glm::make_vec4(light.specular);
+		lights[i].attenuation = glm::make_vec4(light.attenuation);
+	}
+	if (!sceneLightClusters.createClusters()) {
+		return -1;
+	}
+	sceneLightClusters.setLights(lights);
+
+	// Samplers never change: diffuse texture is bound to unit 0 by the render queue, specular texture stays on unit 1,
+	// texture buffers of the light clusters on units 2 to 4
+	glUseProgram(instancedShaderProgram);
+	glUniform1i(instancedUniforms.getLocation(uniformKey("diffuseTexture")), 0);
+	glUniform1i(instancedUniforms.getLocation(uniformKey("specularTexture")), 1);
+	glUniform1i(instancedUniforms.getLocation(uniformKey("clusterGrid")), 2);
+	glUniform1i(instancedUniforms.getLocation(uniformKey("clusterLightIndices")), 3);
+	glUniform1i(instancedUniforms.getLocation(uniformKey("clusterLightData")), 4);
+	if (appOptions.gpuDriven) {
+		glUseProgram(gpuDrivenShaderProgram);
+		glUniform1i(gpuDrivenUniforms.getLocation(uniformKey("diffuseTexture")), 0);
+		glUniform1i(gpuDrivenUniforms.getLocation(uniformKey("specularTexture")), 1);
+		glUniform1i(gpuDrivenUniforms.getLocation(uniformKey("clusterGrid")), 2);
+		glUniform1i(gpuDrivenUniforms.getLocation(uniformKey("clusterLightIndices")), 3);
+		glUniform1i(gpuDrivenUniforms.getLocation(uniformKey("clusterLightData")), 4);
+	}
+
+	// Programs as seen by the render queue
+	RenderProgram instancedProgram; // Matrices come from the instance buffer
+	instancedProgram.programID = instancedShaderProgram;
+	RenderProgram lightProgram;
+	lightProgram.programID = lightShader;
+	lightProgram.modelLocation = lightModelLoc;
+	RenderProgram gpuDrivenProgram; // Matrices come from the object buffer of the GPU culler
+	gpuDrivenProgram.programID = gpuDrivenShaderProgram;
+	if (appOptions.textureArrays) {
+		// Unlit packets carry the scene texture too, although the light shader never samples it
+		instancedProgram.textureTarget = GL_TEXTURE_2D_ARRAY;
+		lightProgram.textureTarget = GL_TEXTURE_2D_ARRAY;
+		gpuDrivenProgram.textureTarget = GL_TEXTURE_2D_ARRAY;
+	}
+
+	// Scene materials
+	MaterialBlockData materialData = {};
+	for (uint32_t i = 0; i < scene.getNumMaterials(); i++) {
+		const SceneMaterialRecord& material = scene.getMaterial(i);
+		materialData.materials[i].uvScale = glm::make_vec2(material.uvScale);
+		materialData.materials[i].shininess = material.shininess;
+	}
+	materialBlock.setData(materialData);
+
+	// Scene meshes and textures
+	if (!sceneMeshesCreation(scene)) {
+		return -1;
+	}
+	if (appOptions.textureArrays) {
+		std::vector<uint32_t> images;
+		for (uint32_t i = 0; i < scene.getNumTextures(); i++) {
+			images.push_back(sceneTextureArrays.addImage(scene.getString(scene.getTexture(i).path)));
+		}
+		sceneTextureArrays.createArrays();
+		for (const uint32_t image : images) {
+			const bool isLoaded = image != TextureArrayPool::NO_IMAGE;
+			sceneTextureIDs.push_back(isLoaded ? sceneTextureArrays.getLayer(image).arrayID : 0);
+			sceneTextureLayers.push_back(isLoaded ? sceneTextureArrays.getLayer(image).layer : 0);
+		}
+		std::cout << "Packed " << sceneTextureArrays.getNumImages() << " textures into " << sceneTextureArrays.getNumArrays() << " texture arrays" << std::endl;
+	}
+	else {
+		for (uint32_t i = 0; i < scene.getNumTextures(); i++) {
+			sceneTextureIDs.push_back(loadTexture(scene.getString(scene.getTexture(i).path)));
+		}
+		sceneTextureLayers.assign(scene.getNumTextures(), 0);
+	}
+	const char* specularTexturePath = scene.getSpecularTexturePath();
+	const unsigned int specularTexture = specularTexturePath != nullptr ? loadTexture(specularTexturePath) : 0;
+
+	// Meshes, textures and programs above have been set up by calling OpenGL directly
+	GLStateCache& glState = GLStateCache::getInstance();
+	glState.invalidate();
+	glState.bindTextureToUnit(1, GL_TEXTURE_2D, specularTexture);
+	sceneLightClusters.bindTextures(2, 3, 4);
+	glState.activeTexture(GL_TEXTURE0);
+
+	// Instances hold world matrices of the visible scene objects, one range per draw group.
+	// They are rebuilt and uploaded only when the visible set changes or a part of the hierarchy moves.
+	InstanceBuffer sceneInstances;
+	sceneInstances.createInstanceBuffer(std::max<uint32_t>(scene.getNumObjects(), 1));
+	sceneTransformsCreation(scene);
+	sceneDrawGroupsCreation(scene);
+	sceneLodSelector.setPixelError(appOptions.lodPixelError);
+	if (appOptions.occlusionCulling) {
+		sceneOcclusionCuller.createBuffer(SCENE_OCCLUSION_WIDTH, SCENE_OCCLUSION_WIDTH * WINDOW_HEIGHT / WINDOW_WIDTH);
+	}
+	if (appOptions.gpuDriven && !sceneGpuDrivenCreation(scene)) {
+		return -1;
+	}
+
+	RenderQueue renderQueue;
 
-	// Mesh for plane
-	PlaneMesh planeMesh;
-	PlaneMesh lightWindow;
-
-	// Cube Mesh
-	CubeMesh container;
-	CubeMesh containerBump;
-	CubeMesh lidBottom;
-	CubeMesh lidTop;
-
-	// Create the Cylinder Mesh and Colors
-	CylinderMesh cylinderMesh;
-	CylinderMesh cylinderTwoMesh;
-
-	// Creating cylinder mesh
-	cylinderMeshCreation(cylinderMesh);
-	cylinderMeshCreation(cylinderTwoMesh);
-
-	// Creating Torus Mesh
-	TorusMesh torusMesh;
-
-	// Creating Sphere
-	Sphere ball(0.5, 50, 50);
-
-	// Creating the objects
-	planeMeshCreation(planeMesh, 4);
-	planeMeshCreation(lightWindow, 2);
-	containerMeshCreation(container);
-	cubeMeshCreation(containerBump);
-	cubeMeshCreation(lidBottom);
-	cubeMeshCreation(lidTop);
-	Torus aTorus = torusMeshCreation(torusMesh, 0.03f, 0.055f); // FIXME: Torus = No way there is no normal one only UV
-	auto cylinder1 = static_meshes_3D::Cylinder(0.15f, 30.0f, 0.5f, true, true, true);
-	auto cylinder2 = static_meshes_3D::Cylinder(0.01f, 30.0f, 0.1f, true, true, true);
-
-	// Binding Textures to meshes
-	planeMesh.texture = loadTexture("images/table.jpg");
-	planeMesh.texture2 = loadTexture("images/tableDark.jpg");
-	lidTop.texture = loadTexture("images/lid.jpg");
-	lidBottom.texture = loadTexture("images/lid.jpg");
-	container.texture = loadTexture("images/container.jpg");
-	containerBump.texture = loadTexture("images/container.jpg");
-	cylinderMesh.texture = loadTexture("images/candleEdit.jpg");
-	cylinderTwoMesh.texture = loadTexture("images/candleLit.jpg");
-	torusMesh.texture = loadTexture("images/CandleTop.jpg");
-	unsigned int sphereText = loadSphereTexture("images/ball.jpg");
+	// GPU time of the frame, its passes and draw groups, results are read a few frames later
+	GPUProfiler gpuProfiler;
+	gpuProfiler.createGPUProfiler();
 	
+	int frameIndex = 0;
+	const auto startTime = std::chrono::steady_clock::now();
+
 	// render loop
-	while (!glfwWindowShouldClose(window))
+	while (appOptions.headless ? frameIndex < appOptions.numFrames : !glfwWindowShouldClose(window))
 	{
-		glfwPollEvents();
+		// Gathers zones of the previous frame, the frame zone ends with the iteration
+		PROFILE_END_FRAME();
+		PROFILE_SCOPE("Frame");
+		const auto frameStartTime = std::chrono::steady_clock::now();
+		UploadCounter::getInstance().reset();
 
-		// per-frame time logic
+		// per-frame time logic, headless and replayed frames advance by fixed 60 Hz steps so that they are reproducible
 		// --------------------
-		float currentFrame = glfwGetTime();
+		float currentFrame = appOptions.headless || isReplaying ? frameIndex / 60.0f : static_cast<float>(glfwGetTime());
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		// Handle input
-		processInput(window);
+		if (!appOptions.headless)
+		{
+			PROFILE_SCOPE("Input");
+			glfwPollEvents();
+			if (!isReplaying) {
+				processInput(window);
+			}
+		}
+
+		// Camera comes either from the replayed path, or from input (optionally recorded)
+		if (isReplaying)
+		{
+			const CameraKeyframe keyframe = cameraPath.sample(currentFrame);
+			camera.SetState(keyframe.position, keyframe.yaw, keyframe.pitch, keyframe.zoom);
+		}
+		else if (!appOptions.recordFile.empty()) {
+			cameraPath.addKeyframe({ currentFrame, camera.Position, camera.Yaw, camera.Pitch, camera.Zoom });
+		}
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		// State changes of this frame only, redundant ones are skipped by the cache
+		glState.resetStats();
+		glState.enable(GL_BLEND);
+		glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 		// Enable Z-depth.
-		glEnable(GL_DEPTH_TEST);
+		glState.enable(GL_DEPTH_TEST);
 
 		// Render
+		gpuProfiler.beginFrame();
+		gpuProfiler.beginZone("Frame");
+		gpuProfiler.beginZone("Clear");
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		gpuProfiler.endZone();
 
-		// Light Shader
-		glUseProgram(lightShader);
-
-		glm::mat4 model = glm::mat4(1.0f);// Model
-		model = glm::translate(model, glm::vec3(xLight, yLight, zLight));
-		model = glm::scale(model, glm::vec3(0.6f, 0.5f, 0.6f));
-		model = glm::rotate(model, glm::radians(45.0f), glm::vec3(0.5f, 0.0f, 0.0f));
 		glm::mat4 view = camera.GetViewMatrix(); // View
-		glm::mat4 projection = glm::mat4(1.0f); // Projection
-		if (perspectiveVal) {
-			projection = glm::perspective(glm::radians(camera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		glm::mat4 projection = getProjectionMatrix(); // Projection
+
+		// Lights reaching every cluster of the view frustum, one job per depth slice, uploaded only when the lists change
+		{
+			PROFILE_SCOPE("Light clusters");
+			sceneLightClusters.setView(view, projection);
+			jobSystem.run(LightClusters::CLUSTERS_Z, [](uint32_t slice) {
+				sceneLightClusters.assignSlice(slice);
+			});
+			sceneLightClusters.uploadClusters();
 		}
-		else {
-			float scale = 350.0f;
-			projection = glm::ortho(-((float)WINDOW_WIDTH) / scale, ((float)WINDOW_WIDTH) / scale, -((float)WINDOW_HEIGHT) / scale, ((float)WINDOW_HEIGHT) / scale, 2.0f, 10.0f);
-		}
-		glm::mat4 MVP = projection * view * model;// Calculate MVP
-
-		// Light
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		planeRender(lightWindow, lightShader, MVP);
-
-		// Activate shader
-		glUseProgram(shaderProgram);
-
-		glm::vec2 gUVScale(2.0f, 2.0f);
-		glUniform2fv(glGetUniformLocation(shaderProgram, "uvScale"), 1, glm::value_ptr(gUVScale));
-		glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(camera.Position));
-
-		// Various Spotlight light info
-		glUniform1f(glGetUniformLocation(shaderProgram, "shininess"), 32.0f);
-		glUniform3f(glGetUniformLocation(shaderProgram, "light1.position"),xLight, yLight, zLight);
-		glUniform3f(glGetUniformLocation(shaderProgram, "light1.ambientStr"), 0.8f, 0.8f, 0.8f);
-		glUniform3f(glGetUniformLocation(shaderProgram, "light1.diffuse"), 0.6f, 0.6f, 0.6f);
-		glUniform3f(glGetUniformLocation(shaderProgram, "light1.specular"), 1.0f, 1.0f, 1.0f);
-		glUniform1f(glGetUniformLocation(shaderProgram, "light1.constant"), 1.0f);
-		glUniform1f(glGetUniformLocation(shaderProgram, "light1.linear"), 0.09f);
-		glUniform1f(glGetUniformLocation(shaderProgram, "light1.quadratic"), 0.032f);
-
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, planeMesh.texture);
-
-		glUniform1i(glGetUniformLocation(shaderProgram, "specularTexture"), 1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, planeMesh.texture2);
-
-		model = glm::mat4(1.0f);// Model
-		model = glm::translate(model, glm::vec3(-0.38f, -0.26f, -0.3f)); 
-		MVP = projection * view * model;// Calculate MVP
-		
-		// Plane
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		planeRender(planeMesh, shaderProgram, MVP);
-
-		// Container Render
-		// Container Lid Top
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 2);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, lidTop.texture);
-		glm::vec3 lidTopPos = glm::vec3(-1.2f, 0.41f, -0.6f);
-		model = glm::mat4(1.0f);// Model
-		model = glm::translate(model, lidTopPos);
-		model = glm::scale(model, glm::vec3(0.6f, 0.05f, 0.6f));
-		MVP = projection * view * model;// Calculate MVP
-		cubeRender(lidTop, shaderProgram, MVP);
-
-		// Container Lid Bottom
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 3);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, lidBottom.texture);
-		glm::vec3 lidBottomPos = glm::vec3(lidTopPos.x, lidTopPos.y - 0.02f, lidTopPos.z);
-		model = glm::mat4(1.0f);// Model
-		model = glm::translate(model, lidBottomPos);
-		model = glm::scale(model, glm::vec3(0.65f, 0.05f, 0.65f));
-		MVP = projection * view * model;// Calculate MVP
-		cubeRender(lidBottom, shaderProgram, MVP);
-		
-		// Container Bump
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 4);
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, containerBump.texture);
-		glm::vec3 containerBumpPos = glm::vec3(lidBottomPos.x, lidBottomPos.y - 0.02f, lidBottomPos.z);
-		model = glm::mat4(1.0f);// Model
-		model = glm::translate(model, containerBumpPos);
-		model = glm::scale(model, glm::vec3(0.7f, 0.05f, 0.7f));
-		MVP = projection * view * model;// Calculate MVP
-		cubeRender(containerBump, shaderProgram, MVP);
-
-		// Container
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 5);
-		glActiveTexture(GL_TEXTURE5);
-		glBindTexture(GL_TEXTURE_2D, container.texture);
-		model = glm::mat4(1.0f);// Model
-		glm::vec3 conatinerPos = glm::vec3(containerBumpPos.x, containerBumpPos.y - 0.3, containerBumpPos.z);
-		model = glm::translate(model, conatinerPos);
-		model = glm::scale(model, glm::vec3(0.48f, 0.65f, 0.55f));
-		MVP = projection * view * model;// Calculate MVP
-		cubeRender(container, shaderProgram, MVP);
-
-		// Cylinder Model (candel body)
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 6);
-		glActiveTexture(GL_TEXTURE6);
-		glBindTexture(GL_TEXTURE_2D, cylinderMesh.texture);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-		MVP = projection * view * model;
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		cylinderRender(cylinder1, cylinderMesh, shaderProgram, MVP); // Renders Cylinder
-
-		// Cylinder two (wix)
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 7);
-		glActiveTexture(GL_TEXTURE7);
-		glBindTexture(GL_TEXTURE_2D, cylinderTwoMesh.texture);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, 0.23f, 0.0f));
-		MVP = projection * view * model;
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		cylinderRender(cylinder2, cylinderTwoMesh, shaderProgram, MVP); // Renders Cylinder
-
-		// Torus model (candel bump)
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 8);
-		glActiveTexture(GL_TEXTURE8);
-		glBindTexture(GL_TEXTURE_2D, torusMesh.texture);
-		model = glm::mat4(1.0f);
-		model = glm::scale(model, glm::vec3(0.88f, 0.45f, 0.88f));
-		model = glm::translate(model, glm::vec3(0.0f, 0.55f, 0.0f)); // Translate the torus above cylinder 
-		model = glm::rotate(model, glm::radians(90.f), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate the torus by 90 degrees		
-		MVP = projection * view * model;
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		torusRender(torusMesh, shaderProgram, MVP); // Render Torus
-
-		// Sphere (basketball)
-		glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 9);
-		glActiveTexture(GL_TEXTURE9);
-		glBindTexture(GL_TEXTURE_2D, sphereText);
-		model = glm::mat4(1.0f);
-		model = glm::scale(model, glm::vec3(0.6f, 0.6f, 0.6f));
-		model = glm::translate(model, glm::vec3(-0.55f, 0.15f, -0.8f));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(2.0f, 0.0f, 0.0f));
-		MVP = projection * view * model;
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "MVP"), 1, GL_FALSE, &MVP[0][0]);
-		glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		ball.Draw();
-		
+
+		// Camera part of the frame block, uploaded only when the camera has moved
+		frameData.view = view;
+		frameData.projection = projection;
+		frameData.viewPosition = glm::vec4(camera.Position, 1.0f);
+		frameData.clusterCounts = sceneLightClusters.getClusterCounts();
+		frameData.clusterDepth = sceneLightClusters.getClusterDepth();
+		{
+			PROFILE_SCOPE("Uniform upload");
+			frameBlock.setData(frameData);
+			frameBlock.uploadIfDirty();
+			materialBlock.uploadIfDirty();
+		}
+
+		// Workers cull and record packets into their own command buffers, GL calls stay on this thread
+		renderQueue.beginFrame(projection * view, camera.Position, 100.0f, JobSystem::getNumJobs(sceneDrawGroups.size(), SCENE_RECORD_JOB_GROUPS));
+
+		// Scene, one instanced draw per draw group and LOD level
+		const bool hasSceneMoved = sceneTransformsUpdate(scene);
+		sceneLodSelector.setView(camera.Position, projection, static_cast<float>(WINDOW_HEIGHT));
+		sceneCull(scene, projection * view, hasSceneMoved, sceneInstances);
+		sceneInstances.uploadIfDirty();
+		sceneGpuCuller.cull(sceneCuller.getPlanes());
+		sceneSubmit(renderQueue, instancedProgram, lightProgram, gpuDrivenProgram, sceneInstances);
+
+		// Draw everything sorted by state
+		renderQueue.sort();
+		renderQueue.execute(&gpuProfiler);
+		gpuProfiler.endZone();
+		gpuProfiler.endFrame();
+
+		// Benchmark frame time includes the GPU work, so that it does not depend on how deep the driver queues
+		if (!appOptions.reportFile.empty())
+		{
+			glFinish();
+			const std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStartTime;
+			const RenderQueueStats& queueStats = renderQueue.getStats();
+			const GLStateCacheStats& stateStats = glState.getStats();
+			benchmarkReport.addFrame({ frameTime.count(), queueStats.numDraws, queueStats.numTriangles, UploadCounter::getInstance().getNumBytes(),
+				stateStats.numBinds, stateStats.numSkippedBinds, stateStats.numStateChanges, stateStats.numSkippedStateChanges });
+		}
+
+		// Dump frame (read from the back buffer or the FBO before they get swapped / overwritten)
+		if (!appOptions.dumpPrefix.empty())
+		{
+			PROFILE_SCOPE("Frame dump");
+			std::ostringstream path;
+			path << appOptions.dumpPrefix << "_" << std::setw(4) << std::setfill('0') << frameIndex << ".ppm";
+			int width = offscreenFramebuffer.getWidth();
+			int height = offscreenFramebuffer.getHeight();
+			if (!appOptions.headless) {
+				glfwGetFramebufferSize(window, &width, &height);
+			}
+			OffscreenFramebuffer::writePPM(path.str(), width, height);
+		}
+
 		// Swap Buffers
-		glfwSwapBuffers(window);
+		if (!appOptions.headless)
+		{
+			PROFILE_SCOPE("Swap buffers");
+			glfwSwapBuffers(window);
+		}
+
+		frameIndex++;
+		if (frameIndex == appOptions.numFrames && !appOptions.headless) {
+			glfwSetWindowShouldClose(window, true);
+		}
+	}
+	glFinish();
+	const std::chrono::duration<double> runTime = std::chrono::steady_clock::now() - startTime;
+	std::cout << "Rendered " << frameIndex << " frames in " << runTime.count() << " s ("
+		<< frameIndex / runTime.count() << " FPS)" << std::endl;
+	PROFILE_END_FRAME();
+	PROFILE_PRINT_SUMMARY(std::cout);
+	gpuProfiler.printSummary(std::cout);
+	PROFILE_WRITE_TRACE("profile_trace.json");
+
+	if (!appOptions.reportFile.empty())
+	{
+		benchmarkReport.setInfo("renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		benchmarkReport.setInfo("gl_version", reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+		benchmarkReport.setInfo("camera_path", isReplaying ? appOptions.cameraPathFile : "live input");
+		benchmarkReport.setInfo("scene", appOptions.sceneFile);
+		benchmarkReport.setInfo("mode", appOptions.headless ? "headless" : "windowed");
+		benchmarkReport.setInfo("threads", std::to_string(jobSystem.getNumThreads()));
+		benchmarkReport.setInfo("culling", appOptions.gpuDriven ? "gpu" : "cpu");
+		benchmarkReport.setInfo("textures", appOptions.textureArrays ? "arrays" : "2d");
+		benchmarkReport.setInfo("lod_error", std::to_string(appOptions.lodPixelError));
+		benchmarkReport.setInfo("occlusion", appOptions.occlusionCulling ? "cpu" : "off");
+		benchmarkReport.setInfo("lights", std::to_string(sceneLightClusters.getNumLights()));
+		benchmarkReport.setInfo("geometries", std::to_string(sceneGeometryRegistry.getNumCreations()));
+		benchmarkReport.setInfo("instance_stream_waits", std::to_string(sceneInstances.getNumStreamingWaits()));
+		benchmarkReport.writeJSON(appOptions.reportFile);
+	}
+	if (!appOptions.recordFile.empty()) {
+		cameraPath.saveToFile(appOptions.recordFile);
 	}
 	
-	planeMeshDeletion(planeMesh);
-	cubeMeshDeletion(container);
-	cubeMeshDeletion(lidBottom);
-	cubeMeshDeletion(lidTop);
-	cylinderMeshDeletion(cylinderMesh);
-	cylinderMeshDeletion(cylinderTwoMesh);
-	torusMeshDeletion(torusMesh);
-	destroyShaderProgram(shaderProgram);
+	sceneMeshesDeletion();
+	sceneInstances.deleteInstanceBuffer();
+	gpuProfiler.deleteGPUProfiler();
+	frameBlock.deleteUBO();
+	materialBlock.deleteUBO();
+	destroyShaderProgram(instancedShaderProgram);
+	destroyShaderProgram(lightShader);
+	if (appOptions.gpuDriven) {
+		destroyShaderProgram(gpuDrivenShaderProgram);
+	}
+	offscreenFramebuffer.deleteFramebuffer();
+	sceneTextures.clear(); // Textures have to be deleted while the context exists
+	sceneTextureArrays.deleteArrays();
+	sceneLightClusters.deleteClusters();
+	headlessContext.deleteContext();
 	glfwTerminate();
+	scene.clear();
+	jobSystem.stop();
 
 	return 0;
 }
@@ -458,7 +787,7 @@ int main()
 bool initializeWindow(GLFWwindow** window) {
 	// initialize and configure GLFW
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, appOptions.gpuDriven ? 4 : 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -468,6 +797,12 @@ bool initializeWindow(GLFWwindow** window) {
 
 	// Crete GLFW Window
 	* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+	if (*window == NULL && appOptions.gpuDriven)
+	{
+		// No OpenGL 4.3, the GPU-driven path is turned off once the 3.3 context is current
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		*window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+	}
 	if (*window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
@@ -480,6 +815,8 @@ bool initializeWindow(GLFWwindow** window) {
 	// Cursor movement
 	glfwSetCursorPosCallback(*window, getMousePosition);
 	glfwSetScrollCallback(*window, scrollMouseWheel);
+	glfwSetMouseButtonCallback(*window, scenePick);
+	glfwSetKeyCallback(*window, keyPressed);
 
 	// Load GLAD
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -488,6 +825,106 @@ bool initializeWindow(GLFWwindow** window) {
 		return false;
 	}
 
+	if (appOptions.uncapped) {
+		glfwSwapInterval(0);
+	}
+
+	return true;
+}
+
+bool initializeHeadless() {
+	// No GLFW at all, it would need a display
+	// GPU-driven path asks for OpenGL 4.3 first, it is turned off if only 3.3 is available
+	if (!(appOptions.gpuDriven && headlessContext.createContext(4, 3)) && !headlessContext.createContext(3, 3)) {
+		return false;
+	}
+
+	// Load GLAD
+	if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+
+	if (!offscreenFramebuffer.createFramebuffer(WINDOW_WIDTH, WINDOW_HEIGHT)) {
+		return false;
+	}
+	offscreenFramebuffer.bindFramebuffer();
+
+	std::cout << "Headless rendering on " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+	return true;
+}
+
+bool parseOptions(int argc, char* argv[], AppOptions& options) {
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string option = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (option == "--headless") {
+			options.headless = true;
+		}
+		else if (option == "--uncapped") {
+			options.uncapped = true;
+		}
+		else if (option == "--frames" && hasValue) {
+			options.numFrames = std::atoi(argv[++i]);
+		}
+		else if (option == "--dump" && hasValue) {
+			options.dumpPrefix = argv[++i];
+		}
+		else if (option == "--camera-path" && hasValue) {
+			options.cameraPathFile = argv[++i];
+		}
+		else if (option == "--record" && hasValue) {
+			options.recordFile = argv[++i];
+		}
+		else if (option == "--report" && hasValue) {
+			options.reportFile = argv[++i];
+		}
+		else if (option == "--scene" && hasValue) {
+			options.sceneFile = argv[++i];
+		}
+		else if (option == "--bake-scene" && hasValue) {
+			options.bakeFile = argv[++i];
+		}
+		else if (option == "--threads" && hasValue) {
+			options.numThreads = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 0));
+		}
+		else if (option == "--gpu-driven") {
+			options.gpuDriven = true;
+		}
+		else if (option == "--texture-arrays") {
+			options.textureArrays = true;
+		}
+		else if (option == "--lod-error" && hasValue) {
+			options.lodPixelError = std::max(static_cast<float>(std::atof(argv[++i])), 0.0f);
+		}
+		else if (option == "--occlusion") {
+			options.occlusionCulling = true;
+		}
+		else if (option == "--bench-meshes") {
+			options.meshBenchmark = true;
+		}
+		else
+		{
+			std::cout << "Usage: " << argv[0] << " [--headless] [--frames N] [--uncapped] [--dump PREFIX]"
+				<< " [--camera-path FILE] [--record FILE] [--report FILE] [--scene FILE] [--bake-scene FILE] [--threads N] [--gpu-driven] [--texture-arrays] [--lod-error PIXELS] [--occlusion] [--bench-meshes]" << std::endl;
+			return false;
+		}
+	}
+
+	if (!options.cameraPathFile.empty() && !options.recordFile.empty())
+	{
+		std::cout << "--camera-path and --record cannot be used together" << std::endl;
+		return false;
+	}
+
+	if (options.headless && options.numFrames <= 0 && !options.meshBenchmark)
+	{
+		std::cout << "--headless needs --frames N" << std::endl;
+		return false;
+	}
+
 	return true;
 }
 // Process Key Inputs
@@ -520,6 +957,28 @@ void processInput(GLFWwindow* window)
 		perspectiveVal = !perspectiveVal;
 	}
 }
+void keyPressed(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+		float distance = 0.0f;
+		const uint32_t object = sceneBvh.findNearest(camera.Position, 100.0f, distance);
+		if (object == Bvh::NO_OBJECT) {
+			std::cout << "No scene object within 100 units" << std::endl;
+		}
+		else {
+			const char* group = scene.getString(scene.getObjects()[object].group);
+			std::cout << "Nearest object " << object << " (" << (group != nullptr ? group : "no group") << ") at distance " << distance << std::endl;
+		}
+	}
+}
+glm::mat4 getProjectionMatrix()
+{
+	if (perspectiveVal) {
+		return glm::perspective(glm::radians(camera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	}
+	float scale = 350.0f;
+	return glm::ortho(-((float)WINDOW_WIDTH) / scale, ((float)WINDOW_WIDTH) / scale, -((float)WINDOW_HEIGHT) / scale, ((float)WINDOW_HEIGHT) / scale, 2.0f, 10.0f);
+}
 // Handle window resize
 void windowResize(GLFWwindow* window, int width, int height)
 {
@@ -589,6 +1048,7 @@ bool createShaders(const char* vertexShaderSource, const char* fragmentShaderSou
 // Handles destroying shaders
 void destroyShaderProgram(unsigned int& program) {
 	glDeleteProgram(program);
+	GLStateCache::getInstance().forgetProgram(program);
 }
 
 // Plane
@@ -609,6 +1069,7 @@ void planeMeshCreation(PlaneMesh& mesh, int planeDimension) {
 	mesh.planeIndexByteOffset = currentOffset;
 	glBufferSubData(GL_ARRAY_BUFFER, currentOffset, planeObj.indexBufferSize(), planeObj.indices);
 	mesh.planeNumIndices = planeObj.numIndices;
+	mesh.bounds = computeBounds(&planeObj.vertices[0].position.x, planeObj.numVertices, NUM_FLOATS_PER_VERTICE);
 
 	// Position 
 	glEnableVertexAttribArray(0);
@@ -627,12 +1088,6 @@ void planeMeshDeletion(PlaneMesh& mesh) {
 	glDeleteVertexArrays(1, &mesh.vao);
 	glDeleteBuffers(1, &mesh.vbo);
 }
-void planeRender(PlaneMesh& mesh, unsigned int& shader, glm::mat4 MVP) {
-	glUniformMatrix4fv(glGetUniformLocation(shader, "MVP"), 1, GL_FALSE, glm::value_ptr(MVP));
-
-	glBindVertexArray(mesh.vao);
-	glDrawElements(GL_TRIANGLES, mesh.planeNumIndices, GL_UNSIGNED_SHORT, (void*)mesh.planeIndexByteOffset);
-}
 
 // Cube
 void containerMeshCreation(CubeMesh& mesh) {
@@ -686,6 +1141,7 @@ void containerMeshCreation(CubeMesh& mesh) {
 
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	mesh.bounds = computeBounds(vertices, 36, 8);
 
 	glBindVertexArray(mesh.vao);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
@@ -746,6 +1202,7 @@ void cubeMeshCreation(CubeMesh& mesh){
 
 	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	mesh.bounds = computeBounds(vertices, 36, 8);
 
 	glBindVertexArray(mesh.vao);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
@@ -759,146 +1216,699 @@ void cubeMeshDeletion(CubeMesh& mesh){
 	glDeleteVertexArrays(1, &mesh.vao);
 	glDeleteBuffers(1, &mesh.vbo);
 }
-void cubeRender(CubeMesh& mesh, unsigned int& shader, glm::mat4 MVP){
-	glUniformMatrix4fv(glGetUniformLocation(shader, "MVP"), 1, GL_FALSE, glm::value_ptr(MVP));
 
-	glBindVertexArray(mesh.vao);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+// Scene Functions
+bool sceneMeshesCreation(const SceneFile& scene) {
+	for (uint32_t i = 0; i < scene.getNumMeshes(); i++) {
+		SceneMesh mesh = {};
+		if (!scenePrimitiveCreation(scene.getMesh(i), 0, mesh)) {
+			std::cout << "Unknown primitive of scene mesh " << scene.getString(scene.getMesh(i).name) << std::endl;
+			return false;
+		}
+		sceneMeshes.push_back(mesh);
+	}
+
+	// Coarser levels of the parametric primitives follow the scene meshes, so that these keep their indices
+	for (uint32_t i = 0; i < scene.getNumMeshes(); i++) {
+		const uint32_t numLods = sceneGetNumLods(scene.getMesh(i));
+		sceneMeshes[i].lods.push_back(i);
+		sceneMeshes[i].lodErrors.push_back(sceneMeshes[i].lodError);
+		for (uint32_t lod = 1; lod < numLods; lod++) {
+			SceneMesh mesh = {};
+			if (!scenePrimitiveCreation(scene.getMesh(i), lod, mesh)) {
+				std::cout << "Cannot create level " << lod << " of scene mesh " << scene.getString(scene.getMesh(i).name) << std::endl;
+				return false;
+			}
+			sceneMeshes[i].lods.push_back(static_cast<unsigned int>(sceneMeshes.size()));
+			sceneMeshes[i].lodErrors.push_back(mesh.lodError);
+			sceneMeshes.push_back(mesh);
+		}
+	}
+
+	return true;
 }
+bool scenePrimitiveCreation(const SceneMeshRecord& record, uint32_t lod, SceneMesh& mesh) {
+	using static_meshes_3D::StaticMesh3D;
+	using static_meshes_3D::Cylinder;
+	using static_meshes_3D::Torus;
+	const float* parameters = record.parameters;
+	const float PI = glm::pi<float>();
+
+	// Geometric error of a tessellated circle is the sagitta of its segments
+	auto getChordError = [PI](float radius, int numSegments) { return radius * (1.0f - std::cos(PI / numSegments)); };
+
+	// Geometry is looked up by shape only, parametric primitives are created at unit size and scaled to the mesh
+	// by its transform node. Attribute mask has bits of the vertex attribute locations the geometry fills.
+	const uint32_t POSITIONS = 1u << StaticMesh3D::POSITION_ATTRIBUTE_INDEX;
+	const uint32_t TEXTURE_COORDINATES = 1u << StaticMesh3D::TEXTURE_COORDINATE_ATTRIBUTE_INDEX;
+	const uint32_t NORMALS = 1u << StaticMesh3D::NORMAL_ATTRIBUTE_INDEX;
+	GeometryKey key;
+	key.primitive = record.primitive;
+	key.attributes = POSITIONS | TEXTURE_COORDINATES | NORMALS;
+	GeometryRegistry::Factory createGeometry;
+	mesh.scale = glm::vec3(1.0f);
+
+	switch (record.primitive) {
+	case SCENE_PRIMITIVE_PLANE: {
+		// Texture coordinates of the plane depend on its dimension, so planes are shared, but not scaled
+		const int planeDimension = static_cast<int>(parameters[0]);
+		key.tessellation[0] = planeDimension;
+		createGeometry = [planeDimension](SharedGeometry& geometry) {
+			std::shared_ptr<PlaneMesh> plane(new PlaneMesh(), [](PlaneMesh* plane) { planeMeshDeletion(*plane); delete plane; });
+			planeMeshCreation(*plane, planeDimension);
+			geometry.vao = plane->vao;
+			geometry.bounds = plane->bounds;
+			geometry.indexType = GL_UNSIGNED_SHORT;
+			geometry.indexByteOffset = plane->planeIndexByteOffset;
+			geometry.draws.push_back({ GL_TRIANGLES, 0, static_cast<GLsizei>(plane->planeNumIndices) });
+			geometry.owner = plane;
+			return true;
+		};
+		mesh.isOccluder = true;
+		break;
+	}
+	case SCENE_PRIMITIVE_CUBE:
+	case SCENE_PRIMITIVE_CONTAINER: {
+		const bool isContainer = record.primitive == SCENE_PRIMITIVE_CONTAINER;
+		createGeometry = [isContainer](SharedGeometry& geometry) {
+			std::shared_ptr<CubeMesh> cube(new CubeMesh(), [](CubeMesh* cube) { cubeMeshDeletion(*cube); delete cube; });
+			if (isContainer) {
+				containerMeshCreation(*cube);
+			}
+			else {
+				cubeMeshCreation(*cube);
+			}
+			geometry.vao = cube->vao;
+			geometry.bounds = cube->bounds;
+			geometry.draws.push_back({ GL_TRIANGLES, 0, 36 });
+			geometry.owner = cube;
+			return true;
+		};
+		mesh.isOccluder = true;
+		break;
+	}
+	case SCENE_PRIMITIVE_CYLINDER: {
+		// Unit radius and height
+		const int numSlices = static_cast<int>(parameters[1]) >> lod;
+		key.tessellation[0] = numSlices;
+		createGeometry = [numSlices](SharedGeometry& geometry) {
+			auto cylinder = std::make_shared<Cylinder>(1.0f, numSlices, 1.0f, true, true, true);
+			const int sideVertices = cylinder->getNumVerticesSide();
+			const int coverVertices = cylinder->getNumVerticesTopBottom();
+
+			// Side, top cover and bottom cover, same as Cylinder::render
+			geometry.vao = cylinder->getVAO();
+			geometry.bounds = cylinder->getBounds();
+			geometry.draws.push_back({ GL_TRIANGLE_STRIP, 0, sideVertices });
+			geometry.draws.push_back({ GL_TRIANGLE_FAN, sideVertices, coverVertices });
+			geometry.draws.push_back({ GL_TRIANGLE_FAN, sideVertices + coverVertices, coverVertices });
+			geometry.owner = cylinder;
+			return true;
+		};
+		mesh.scale = glm::vec3(parameters[0], parameters[2], parameters[0]);
+		mesh.lodError = getChordError(1.0f, numSlices);
+		break;
+	}
+	case SCENE_PRIMITIVE_TORUS: {
+		// Scene parameters are halves of the tube and ring radii, unit ring radius keeps their ratio
+		const int numSegments = SCENE_TORUS_SEGMENTS >> lod;
+		const float tubeRadius = parameters[0] / parameters[1];
+		key.tessellation[0] = numSegments;
+		key.tessellation[1] = numSegments;
+		key.shape = tubeRadius;
+		key.attributes |= 1u << Torus::TANGENT_ATTRIBUTE_INDEX;
+		createGeometry = [tubeRadius, numSegments](SharedGeometry& geometry) {
+			auto torus = std::make_shared<Torus>(tubeRadius, 1.0f, numSegments, numSegments);
+			geometry.vao = torus->getVAO();
+			geometry.bounds = torus->getBounds();
+			geometry.indexType = torus->getIndexType();
+			geometry.draws.push_back({ GL_TRIANGLES, 0, torus->getNumIndices() });
+			geometry.owner = torus;
+			return true;
+		};
+		mesh.scale = glm::vec3(2.0f * parameters[1]);
+		mesh.lodError = std::max(getChordError(tubeRadius, numSegments), getChordError(1.0f + tubeRadius, numSegments));
+		break;
+	}
+	case SCENE_PRIMITIVE_SPHERE: {
+		// Unit radius, stacks span half a circle only
+		const int numSectors = static_cast<int>(parameters[1]) >> lod;
+		const int numStacks = static_cast<int>(parameters[2]) >> lod;
+		key.tessellation[0] = numSectors;
+		key.tessellation[1] = numStacks;
+		key.attributes = POSITIONS | TEXTURE_COORDINATES;
+		createGeometry = [numSectors, numStacks](SharedGeometry& geometry) {
+			auto sphere = std::make_shared<Sphere>(1.0f, numSectors, numStacks);
+			geometry.vao = sphere->getVAO();
+			geometry.bounds = sphere->getBounds();
+			geometry.indexType = GL_UNSIGNED_INT;
+			geometry.draws.push_back({ GL_TRIANGLES, 0, sphere->getNumIndices() });
+			geometry.owner = sphere;
+			return true;
+		};
+		mesh.scale = glm::vec3(parameters[0]);
+		mesh.lodError = std::max(getChordError(1.0f, numSectors), getChordError(1.0f, 2 * numStacks));
+		break;
+	}
+	default:
+		return false;
+	}
 
-// Cylinder Functions
-void cylinderMeshCreation(CylinderMesh& mesh) {
-	glGenVertexArrays(1, &mesh.vao);
-	glGenBuffers(1, &mesh.vbo);
-	glBindVertexArray(mesh.vao);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+	mesh.geometry = sceneGeometryRegistry.acquire(key, createGeometry);
+	if (!mesh.geometry) {
+		return false;
+	}
+	mesh.vao = mesh.geometry->vao;
+	mesh.indexType = mesh.geometry->indexType;
+	mesh.indexByteOffset = mesh.geometry->indexByteOffset;
+	mesh.draws = mesh.geometry->draws;
+	mesh.bounds = mesh.geometry->bounds;
+
+	// Walls of the container lean outwards, the box of its bottom face stays inside
+	if (mesh.isOccluder) {
+		mesh.occluderMin = mesh.bounds.boxMin;
+		mesh.occluderMax = record.primitive == SCENE_PRIMITIVE_CONTAINER ? glm::vec3(0.5f) : mesh.bounds.boxMax;
+	}
+	return true;
 }
-void cylinderMeshDeletion(CylinderMesh& mesh) {
-	glDeleteVertexArrays(1, &mesh.vao);
-	glDeleteBuffers(1, &mesh.vbo);
+uint32_t sceneGetNumLods(const SceneMeshRecord& record) {
+	int numSegments = 0;
+	switch (record.primitive) {
+	case SCENE_PRIMITIVE_CYLINDER:
+		numSegments = static_cast<int>(record.parameters[1]);
+		break;
+	case SCENE_PRIMITIVE_TORUS:
+		numSegments = SCENE_TORUS_SEGMENTS;
+		break;
+	case SCENE_PRIMITIVE_SPHERE:
+		numSegments = std::min(static_cast<int>(record.parameters[1]), 2 * static_cast<int>(record.parameters[2]));
+		break;
+	default:
+		return 1;
+	}
+
+	uint32_t numLods = 1;
+	while (numLods < LodSelector::MAX_LEVELS && (numSegments >> numLods) >= SCENE_LOD_MIN_SEGMENTS) {
+		numLods++;
+	}
+	return numLods;
+}
+void sceneMeshesDeletion() {
+	sceneTransforms.clear();
+	sceneObjectNodes.clear();
+	sceneNodeObjects.clear();
+	sceneVisibleObjects.clear();
+	sceneInstanceObjects.clear();
+	sceneObjectLods.clear();
+	sceneJobLodChanges.clear();
+	sceneOcclusionCuller.deleteBuffer();
+	sceneOccluders.clear();
+	sceneBvh.clear();
+	sceneBvhSubtrees.clear();
+	sceneCulledObjects.clear();
+	sceneJobVisibleObjects.clear();
+	sceneCullJobs.clear();
+	sceneGpuCuller.deleteCuller();
+	sceneGeometryPool.deletePool();
+	sceneIndirectDraws.clear();
+	sceneMeshes.clear();
+	sceneGeometryRegistry.collectGarbage();
+	sceneDrawGroups.clear();
 }
-void cylinderRender(const static_meshes_3D::Cylinder& cylinder, CylinderMesh& mesh, unsigned int& shader, glm::mat4 MVP) {
-	glUniformMatrix4fv(glGetUniformLocation(shader, "MVP"), 1, GL_FALSE, glm::value_ptr(MVP));
+void sceneTransformsCreation(const SceneFile& scene) {
+	const SceneObjectRecord* objects = scene.getObjects();
+	const uint32_t numObjects = scene.getNumObjects();
+
+	// Baked objects are sorted for drawing, so parents may come after their children.
+	// Nodes are added by depth instead, which puts every parent before its children.
+	const uint32_t UNKNOWN_DEPTH = 0xFFFFFFFF;
+	std::vector<uint32_t> depths(numObjects, UNKNOWN_DEPTH);
+	std::vector<uint32_t> chain;
+	uint32_t maxDepth = 0;
+	for (uint32_t i = 0; i < numObjects; i++) {
+		chain.clear();
+		uint32_t object = i;
+		while (object != SceneFile::NO_PARENT && depths[object] == UNKNOWN_DEPTH) {
+			chain.push_back(object);
+			object = objects[object].parent;
+		}
+		uint32_t depth = object == SceneFile::NO_PARENT ? 0 : depths[object] + 1;
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+			depths[*it] = depth++;
+		}
+		maxDepth = std::max(maxDepth, depths[i]);
+	}
 
-	glBindVertexArray(mesh.vao);
-	cylinder.render();
+	// Meshes of unit-size geometry get a child node scaling it, which is not inherited by children of the object
+	std::vector<uint32_t> placementNodes(numObjects, TransformHierarchy::NO_PARENT);
+	sceneObjectNodes.assign(numObjects, TransformHierarchy::NO_PARENT);
+	for (uint32_t depth = 0; depth <= maxDepth && numObjects > 0; depth++) {
+		for (uint32_t i = 0; i < numObjects; i++) {
+			if (depths[i] != depth) {
+				continue;
+			}
+			const uint32_t parent = objects[i].parent;
+			const uint32_t parentNode = parent == SceneFile::NO_PARENT ? TransformHierarchy::NO_PARENT : placementNodes[parent];
+			placementNodes[i] = sceneTransforms.addNode(parentNode, glm::make_mat4(objects[i].model));
+			sceneObjectNodes[i] = placementNodes[i];
+			if (objects[i].mesh != SceneFile::NO_MESH && sceneMeshes[objects[i].mesh].scale != glm::vec3(1.0f)) {
+				sceneObjectNodes[i] = sceneTransforms.addNode(placementNodes[i], glm::scale(glm::mat4(1.0f), sceneMeshes[objects[i].mesh].scale));
+			}
+		}
+	}
+	sceneNodeObjects.assign(sceneTransforms.getNumNodes(), 0);
+	for (uint32_t i = 0; i < numObjects; i++) {
+		sceneNodeObjects[placementNodes[i]] = i;
+		sceneNodeObjects[sceneObjectNodes[i]] = i;
+	}
+	sceneCuller.setNumObjects(numObjects);
+	sceneBvh.setNumObjects(numObjects);
 }
+bool sceneTransformsUpdate(const SceneFile& scene) {
+	const SceneObjectRecord* objects = scene.getObjects();
+	if (sceneTransforms.update() == 0) {
+		return false;
+	}
 
-// Torus Functions
-Torus torusMeshCreation(TorusMesh& mesh, float innerRadius, float outterRadius) {
-	Torus aTorus;
+	// World bounds follow the moved objects
+	for (const uint32_t node : sceneTransforms.getChangedNodes()) {
+		const uint32_t object = sceneNodeObjects[node];
+		if (objects[object].mesh != SceneFile::NO_MESH && sceneObjectNodes[object] == node) {
+			const Bounds worldBounds = transformBounds(sceneMeshes[objects[object].mesh].bounds, sceneTransforms.getWorldMatrix(node));
+			sceneCuller.setBounds(object, worldBounds);
+			sceneBvh.setBounds(object, worldBounds);
+			if (sceneGpuCuller.isCreated()) {
+				sceneGpuCuller.setObjectTransform(object, sceneTransforms.getWorldMatrix(node), worldBounds);
+			}
+		}
+	}
 
-	glGenVertexArrays(1, &mesh.vao);
-	glBindVertexArray(mesh.vao);
+	// Hierarchy needs world bounds of all objects, so it is built by the first update and only refit later
+	if (sceneBvh.getNumNodes() == 0) {
+		std::vector<uint32_t> drawableObjects;
+		for (uint32_t i = 0; i < scene.getNumObjects(); i++) {
+			if (objects[i].mesh != SceneFile::NO_MESH) {
+				drawableObjects.push_back(i);
+			}
+		}
+		sceneBvh.build(drawableObjects);
+		sceneBvh.getSubtrees(SCENE_BVH_JOB_DEPTH, sceneBvhSubtrees);
+	}
+	else {
+		sceneBvh.refit();
+	}
+	return true;
+}
+void sceneDrawGroupsCreation(const SceneFile& scene) {
+	const SceneObjectRecord* objects = scene.getObjects();
+	const uint32_t numObjects = scene.getNumObjects();
+
+	// Baked objects are sorted by pass, group, mesh and texture, so every draw group is one contiguous run.
+	// Textures in layers of one texture array are the same texture for grouping, instances select their layers.
+	// Meshes of one shared geometry are the same mesh for grouping too, their sizes are in the instance matrices.
+	auto getTextureID = [](uint32_t texture) { return texture == SceneFile::NO_TEXTURE ? 0u : sceneTextureIDs[texture]; };
+	auto getGeometry = [](uint32_t mesh) { return mesh == SceneFile::NO_MESH ? nullptr : sceneMeshes[mesh].geometry.get(); };
+	uint32_t first = 0;
+	while (first < numObjects) {
+		const SceneObjectRecord& head = objects[first];
+		uint32_t last = first + 1;
+		while (last < numObjects && objects[last].pass == head.pass && objects[last].group == head.group
+			&& getGeometry(objects[last].mesh) == getGeometry(head.mesh) && getTextureID(objects[last].texture) == getTextureID(head.texture)) {
+			last++;
+		}
 
-	// Get Vertices
-	int vertices = aTorus.createObject(innerRadius, outterRadius, 180, 180, &mesh.vertexData, &mesh.uvData);
-	mesh.nVertices = vertices;
-	
-	// Position buffer
-	glGenBuffers(1, &mesh.vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices * 3 * sizeof(GLfloat), mesh.vertexData, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+		// Transform nodes are not drawn
+		if (head.mesh == SceneFile::NO_MESH) {
+			first = last;
+			continue;
+		}
 
-	// Texture buffer
-	glGenBuffers(1, &mesh.uvBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh.uvBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices * 2 * sizeof(GLfloat),mesh.uvData, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,0,(void*)0);
+		SceneDrawGroup group = {};
+		group.pass = static_cast<RenderPass>(head.pass);
+		group.timingGroup = scene.getString(head.group);
+		group.mesh = head.mesh;
+		group.texture = getTextureID(head.texture);
+		group.firstObject = first;
+		group.numObjects = last - first;
+		group.isGpuDriven = appOptions.gpuDriven && group.pass == RENDER_PASS_OPAQUE;
+		sceneDrawGroups.push_back(group);
+
+		first = last;
+	}
 
-	return aTorus;
-}
-void torusMeshDeletion(TorusMesh& mesh) {
-	glDeleteVertexArrays(1, &mesh.vao);
-	glDeleteBuffers(1, &mesh.vertexBuffer);
-	glDeleteBuffers(1, &mesh.uvBuffer);
-	delete mesh.uvData,mesh.vertexData;
+	sceneObjectLods.assign(numObjects, 0);
+
+	// Objects culled on the CPU, in increasing order, so that results of the jobs joined in job order are sorted
+	auto addCullJobs = [](unsigned int firstObject, unsigned int lastObject) {
+		for (unsigned int object = firstObject; object < lastObject; object += SCENE_CULL_JOB_OBJECTS) {
+			sceneCullJobs.push_back({ object, std::min(lastObject - object, SCENE_CULL_JOB_OBJECTS) });
+		}
+	};
+	if (!appOptions.gpuDriven) {
+		addCullJobs(0, numObjects);
+	}
+	for (const SceneDrawGroup& group : sceneDrawGroups) {
+		if (appOptions.gpuDriven && !group.isGpuDriven) {
+			addCullJobs(group.firstObject, group.firstObject + group.numObjects);
+		}
+	}
 }
-void torusRender(TorusMesh& mesh, unsigned int& shader, glm::mat4 MVP) {
-	glUniformMatrix4fv(glGetUniformLocation(shader, "MVP"), 1, GL_FALSE, &MVP[0][0]); // Update
+bool sceneGpuDrivenCreation(const SceneFile& scene) {
+	const SceneObjectRecord* objects = scene.getObjects();
+
+	// Meshes of the GPU-driven groups as triangle lists in the shared buffers, copied once per shared geometry
+	const uint32_t NO_POOL_MESH = 0xFFFFFFFF;
+	std::vector<uint32_t> poolMeshes(sceneMeshes.size(), NO_POOL_MESH);
+	std::map<const SharedGeometry*, uint32_t> geometryPoolMeshes;
+	std::vector<uint32_t> groups;
+	for (uint32_t i = 0; i < sceneDrawGroups.size(); i++) {
+		const SceneDrawGroup& group = sceneDrawGroups[i];
+		if (!group.isGpuDriven) {
+			continue;
+		}
+		groups.push_back(i);
+		if (poolMeshes[group.mesh] != NO_POOL_MESH) {
+			continue;
+		}
+		const SceneMesh& mesh = sceneMeshes[group.mesh];
+		const auto pooled = geometryPoolMeshes.find(mesh.geometry.get());
+		if (pooled != geometryPoolMeshes.end()) {
+			poolMeshes[group.mesh] = pooled->second;
+			continue;
+		}
+		sceneGeometryPool.beginMesh();
+		for (const SceneMeshDraw& draw : mesh.draws) {
+			if (!sceneGeometryPool.addDraw(mesh.vao, draw.mode, draw.first, draw.count, mesh.indexType, mesh.indexByteOffset)) {
+				return false;
+			}
+		}
+		poolMeshes[group.mesh] = sceneGeometryPool.endMesh();
+		geometryPoolMeshes[mesh.geometry.get()] = poolMeshes[group.mesh];
+	}
 
-	glBindVertexArray(mesh.vao);
+	// One command per group, commands of one texture are consecutive and drawn together
+	std::stable_sort(groups.begin(), groups.end(), [](uint32_t a, uint32_t b) { return sceneDrawGroups[a].texture < sceneDrawGroups[b].texture; });
+	sceneGpuCuller.setNumObjects(scene.getNumObjects());
+	for (const uint32_t groupIndex : groups) {
+		const SceneDrawGroup& group = sceneDrawGroups[groupIndex];
+		const GLuint command = sceneGpuCuller.addCommand(sceneGeometryPool.getMesh(poolMeshes[group.mesh]), group.numObjects);
+		for (uint32_t object = group.firstObject; object < group.firstObject + group.numObjects; object++) {
+			const GLint material = static_cast<GLint>(objects[object].material);
+			sceneGpuCuller.setObjectCommand(object, command, material, sceneGetTextureLayer(objects[object]));
+		}
 
-	glDrawArrays(GL_TRIANGLES, 0, mesh.nVertices);
+		if (sceneIndirectDraws.empty() || sceneIndirectDraws.back().texture != group.texture) {
+			sceneIndirectDraws.push_back({ group.texture, command, 0 });
+		}
+		sceneIndirectDraws.back().numCommands++;
+	}
+
+	sceneGeometryPool.createPool();
+	return sceneGpuCuller.createCuller(sceneGeometryPool.getVAO());
 }
+void sceneCull(const SceneFile& scene, const glm::mat4& viewProjection, bool hasMoved, InstanceBuffer& instances) {
+	// Large scenes skip whole subtrees outside the frustum, one job per subtree of the hierarchy.
+	// Hierarchy tests boxes only, small scenes test spheres too, one job per range of objects.
+	// GPU-driven groups are culled by sceneGpuCuller, only the other groups are tested here.
+	JobSystem& jobSystem = JobSystem::getInstance();
+	sceneCuller.setFrustum(viewProjection);
+	sceneCulledObjects.clear();
+	{
+		PROFILE_SCOPE("Cull objects");
+		const bool isHierarchical = scene.getNumObjects() >= SCENE_BVH_MIN_OBJECTS && !appOptions.gpuDriven;
+		const uint32_t numJobs = static_cast<uint32_t>(isHierarchical ? sceneBvhSubtrees.size() : sceneCullJobs.size());
+		sceneJobVisibleObjects.resize(numJobs);
+		jobSystem.run(numJobs, [isHierarchical](uint32_t job) {
+			sceneJobVisibleObjects[job].clear();
+			if (isHierarchical) {
+				sceneBvh.cullFrustum(sceneCuller.getPlanes(), sceneJobVisibleObjects[job], sceneBvhSubtrees[job]);
+			}
+			else {
+				sceneCuller.cullRange(sceneCullJobs[job].firstObject, sceneCullJobs[job].numObjects, sceneJobVisibleObjects[job]);
+			}
+		});
+
+		// Ranges are tested in increasing order, so their results joined in job order are sorted already
+		for (uint32_t job = 0; job < numJobs; job++) {
+			sceneCulledObjects.insert(sceneCulledObjects.end(), sceneJobVisibleObjects[job].begin(), sceneJobVisibleObjects[job].end());
+		}
+		if (isHierarchical) {
+			std::sort(sceneCulledObjects.begin(), sceneCulledObjects.end());
+		}
+	}
 
-// Load texture utility
-unsigned int loadTexture(char const* path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	if (appOptions.occlusionCulling) {
+		sceneOcclusionCull(scene, viewProjection);
+	}
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
+	// Levels of detail of the culled objects follow the camera, the level they have been drawn with damps the switching
+	const SceneObjectRecord* objects = scene.getObjects();
+	bool haveLodsChanged = false;
 	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+		PROFILE_SCOPE("Select LODs");
+		const uint32_t numJobs = JobSystem::getNumJobs(sceneCulledObjects.size(), SCENE_INSTANCE_JOB_OBJECTS);
+		sceneJobLodChanges.assign(numJobs, 0);
+		jobSystem.run(numJobs, [&](uint32_t job) {
+			const size_t last = std::min<size_t>(sceneCulledObjects.size(), (job + 1) * SCENE_INSTANCE_JOB_OBJECTS);
+			for (size_t i = job * SCENE_INSTANCE_JOB_OBJECTS; i < last; i++) {
+				const uint32_t object = sceneCulledObjects[i];
+				if (objects[object].mesh == SceneFile::NO_MESH || sceneMeshes[objects[object].mesh].lods.size() <= 1) {
+					continue;
+				}
+				const SceneMesh& mesh = sceneMeshes[objects[object].mesh];
+				const glm::vec4 sphere = sceneCuller.getSphere(object);
+				const float errorScale = mesh.bounds.sphereRadius > 0.0f ? sphere.w / mesh.bounds.sphereRadius : 1.0f;
+				const uint32_t lod = sceneLodSelector.selectLevel(mesh.lodErrors.data(), static_cast<uint32_t>(mesh.lodErrors.size()), errorScale,
+					glm::vec3(sphere.x, sphere.y, sphere.z), sphere.w, sceneObjectLods[object]);
+				if (lod != sceneObjectLods[object]) {
+					sceneObjectLods[object] = static_cast<uint8_t>(lod);
+					sceneJobLodChanges[job] = 1;
+				}
+			}
+		});
+		haveLodsChanged = std::find(sceneJobLodChanges.begin(), sceneJobLodChanges.end(), 1) != sceneJobLodChanges.end();
+	}
+	if (!hasMoved && !haveLodsChanged && sceneCulledObjects == sceneVisibleObjects) {
+		return; // Instances of the last frame are still valid, nothing is uploaded
+	}
+	sceneVisibleObjects.swap(sceneCulledObjects);
+
+	// Visible objects of every draw group, as a sub-range of the visible list. Its instances are in the same range,
+	// but sorted by LOD level, so that every level is drawn by one instanced draw.
+	PROFILE_SCOPE("Visible instances");
+	sceneInstanceObjects = sceneVisibleObjects;
+	for (SceneDrawGroup& group : sceneDrawGroups) {
+		const auto first = std::lower_bound(sceneVisibleObjects.begin(), sceneVisibleObjects.end(), group.firstObject);
+		const auto last = std::lower_bound(first, sceneVisibleObjects.end(), group.firstObject + group.numObjects);
+		group.firstVisible = static_cast<unsigned int>(first - sceneVisibleObjects.begin());
+		group.numVisible = static_cast<unsigned int>(last - first);
+		group.instances.firstInstance = group.firstVisible;
+		group.instances.numInstances = static_cast<GLsizei>(group.numVisible);
+
+		const size_t numLods = sceneMeshes[group.mesh].lods.size();
+		if (numLods <= 1) {
+			group.lodInstances[0] = group.instances;
+			continue;
+		}
+		GLsizei lodCounts[LodSelector::MAX_LEVELS] = {};
+		for (auto it = first; it != last; ++it) {
+			lodCounts[sceneObjectLods[*it]]++;
+		}
+		GLuint nextInstance = group.instances.firstInstance;
+		for (size_t lod = 0; lod < numLods; lod++) {
+			group.lodInstances[lod].firstInstance = nextInstance;
+			group.lodInstances[lod].numInstances = 0;
+			nextInstance += lodCounts[lod];
+		}
+		for (auto it = first; it != last; ++it) {
+			InstanceRange& range = group.lodInstances[sceneObjectLods[*it]];
+			sceneInstanceObjects[range.firstInstance + range.numInstances++] = *it;
+		}
 	}
 
-	return textureID;
+	// Instance i belongs to object sceneInstanceObjects[i], so that jobs can fill them independently.
+	// Unlit objects get unused instances, they are drawn one by one with their own matrices.
+	instances.clear();
+	instances.addInstances(static_cast<GLsizei>(sceneInstanceObjects.size()));
+	jobSystem.run(JobSystem::getNumJobs(sceneInstanceObjects.size(), SCENE_INSTANCE_JOB_OBJECTS), [&](uint32_t job) {
+		const size_t last = std::min<size_t>(sceneInstanceObjects.size(), (job + 1) * SCENE_INSTANCE_JOB_OBJECTS);
+		for (size_t i = job * SCENE_INSTANCE_JOB_OBJECTS; i < last; i++) {
+			const uint32_t object = sceneInstanceObjects[i];
+			const GLint material = static_cast<GLint>(objects[object].material);
+			instances.fillInstance(static_cast<GLuint>(i), sceneTransforms.getWorldMatrix(sceneObjectNodes[object]), material, sceneGetTextureLayer(objects[object]));
+		}
+	});
 }
-unsigned int loadSphereTexture(char const* path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+void sceneOcclusionCull(const SceneFile& scene, const glm::mat4& viewProjection) {
+	// Occluders are the visible opaque objects of occluder meshes, largest on the screen first
+	PROFILE_SCOPE("Occlusion cull");
+	const SceneObjectRecord* objects = scene.getObjects();
+	sceneOccluders.clear();
+	for (const uint32_t object : sceneCulledObjects) {
+		if (objects[object].mesh == SceneFile::NO_MESH || objects[object].pass != SCENE_PASS_OPAQUE || !sceneMeshes[objects[object].mesh].isOccluder) {
+			continue;
+		}
+		const glm::vec4 sphere = sceneCuller.getSphere(object);
+		const float depth = (viewProjection * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f)).w;
+		const float size = depth > sphere.w ? sphere.w / depth : std::numeric_limits<float>::max();
+		if (size >= SCENE_OCCLUDER_MIN_SIZE) {
+			sceneOccluders.push_back({ size, object });
+		}
+	}
+	if (sceneOccluders.size() > SCENE_MAX_OCCLUDERS) {
+		std::nth_element(sceneOccluders.begin(), sceneOccluders.begin() + SCENE_MAX_OCCLUDERS, sceneOccluders.end(), std::greater<std::pair<float, uint32_t>>());
+		sceneOccluders.resize(SCENE_MAX_OCCLUDERS);
+	}
+	if (sceneOccluders.empty()) {
+		return;
+	}
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+	sceneOcclusionCuller.beginFrame(viewProjection);
+	for (const auto& occluder : sceneOccluders) {
+		const SceneMesh& mesh = sceneMeshes[objects[occluder.second].mesh];
+		sceneOcclusionCuller.addOccluderBox(sceneTransforms.getWorldMatrix(sceneObjectNodes[occluder.second]), mesh.occluderMin, mesh.occluderMax);
 	}
 
-	return textureID;
+	// Bands of the buffer are rasterized in parallel, then ranges of the culled objects are tested against it
+	JobSystem& jobSystem = JobSystem::getInstance();
+	jobSystem.run(static_cast<uint32_t>(sceneOcclusionCuller.getNumBands()), [](uint32_t band) {
+		sceneOcclusionCuller.rasterizeBand(band);
+	});
+	const uint32_t numJobs = JobSystem::getNumJobs(sceneCulledObjects.size(), SCENE_INSTANCE_JOB_OBJECTS);
+	sceneJobVisibleObjects.resize(std::max<size_t>(sceneJobVisibleObjects.size(), numJobs));
+	jobSystem.run(numJobs, [objects](uint32_t job) {
+		sceneJobVisibleObjects[job].clear();
+		const size_t last = std::min<size_t>(sceneCulledObjects.size(), (job + 1) * SCENE_INSTANCE_JOB_OBJECTS);
+		for (size_t i = job * SCENE_INSTANCE_JOB_OBJECTS; i < last; i++) {
+			const uint32_t object = sceneCulledObjects[i];
+			if (objects[object].mesh == SceneFile::NO_MESH) {
+				continue;
+			}
+			const Bounds& bounds = sceneMeshes[objects[object].mesh].bounds;
+			if (sceneOcclusionCuller.isVisible(sceneTransforms.getWorldMatrix(sceneObjectNodes[object]), bounds.boxMin, bounds.boxMax)) {
+				sceneJobVisibleObjects[job].push_back(object);
+			}
+		}
+	});
+
+	sceneCulledObjects.clear();
+	for (uint32_t job = 0; job < numJobs; job++) {
+		sceneCulledObjects.insert(sceneCulledObjects.end(), sceneJobVisibleObjects[job].begin(), sceneJobVisibleObjects[job].end());
+	}
+}
+void sceneSubmit(RenderQueue& queue, const RenderProgram& litProgram, const RenderProgram& unlitProgram, const RenderProgram& gpuDrivenProgram, const InstanceBuffer& instances) {
+	PROFILE_SCOPE("Record draw packets");
+	JobSystem::getInstance().run(static_cast<uint32_t>(queue.getNumCommandBuffers()), [&](uint32_t job) {
+		RenderCommandBuffer& commandBuffer = queue.getCommandBuffer(job);
+		const size_t lastGroup = std::min<size_t>(sceneDrawGroups.size(), (job + 1) * SCENE_RECORD_JOB_GROUPS);
+		for (size_t groupIndex = job * SCENE_RECORD_JOB_GROUPS; groupIndex < lastGroup; groupIndex++) {
+			const SceneDrawGroup& group = sceneDrawGroups[groupIndex];
+			const SceneMesh& groupMesh = sceneMeshes[group.mesh];
+			if (group.isGpuDriven) {
+				continue;
+			}
+			commandBuffer.setTimingGroup(group.timingGroup);
+
+			if (group.pass == RENDER_PASS_UNLIT) {
+				// Unlit program does not read instance attributes, so its objects are drawn one by one
+				for (uint32_t i = group.firstVisible; i < group.firstVisible + group.numVisible; i++) {
+					const uint32_t object = sceneInstanceObjects[i];
+					const SceneMesh& mesh = sceneMeshes[groupMesh.lods[sceneObjectLods[object]]];
+					const glm::mat4& model = sceneTransforms.getWorldMatrix(sceneObjectNodes[object]);
+					for (const SceneMeshDraw& draw : mesh.draws) {
+						if (mesh.indexType == 0) {
+							commandBuffer.submitArrays(group.pass, unlitProgram, mesh.vao, group.texture, draw.mode, draw.first, draw.count, model);
+						}
+						else {
+							commandBuffer.submitElements(group.pass, unlitProgram, mesh.vao, group.texture, draw.mode, draw.count, mesh.indexType, mesh.indexByteOffset, model);
+						}
+					}
+				}
+				continue;
+			}
+
+			// One instanced draw per mesh draw of every LOD level in use
+			for (size_t lod = 0; lod < groupMesh.lods.size(); lod++) {
+				const InstanceRange& range = group.lodInstances[lod];
+				if (range.numInstances == 0) {
+					continue;
+				}
+				const SceneMesh& mesh = sceneMeshes[groupMesh.lods[lod]];
+				for (const SceneMeshDraw& draw : mesh.draws) {
+					if (mesh.indexType == 0) {
+						commandBuffer.submitArraysInstanced(group.pass, litProgram, mesh.vao, group.texture, draw.mode, draw.first, draw.count,
+							instances, range.firstInstance, range.numInstances);
+					}
+					else {
+						commandBuffer.submitElementsInstanced(group.pass, litProgram, mesh.vao, group.texture, draw.mode, draw.count, mesh.indexType, mesh.indexByteOffset,
+							instances, range.firstInstance, range.numInstances);
+					}
+				}
+			}
+		}
+	});
+
+	// GPU-driven groups, one multi-draw per texture over the commands written by sceneGpuCuller
+	queue.setTimingGroup("GPU-driven");
+	for (const SceneIndirectDraw& draw : sceneIndirectDraws) {
+		queue.submitElementsIndirect(RENDER_PASS_OPAQUE, gpuDrivenProgram, sceneGeometryPool.getVAO(), draw.texture, GL_TRIANGLES, GL_UNSIGNED_INT,
+			sceneGpuCuller.getCommandBufferID(), draw.firstCommand * sizeof(DrawElementsIndirectCommand), static_cast<GLsizei>(draw.numCommands));
+	}
+}
+
+void scenePick(GLFWwindow* window, int button, int action, int mods) {
+	if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS) {
+		return;
+	}
+
+	// Ray from the near plane to the far plane through the cursor
+	double cursorX = 0.0;
+	double cursorY = 0.0;
+	int width = 0;
+	int height = 0;
+	glfwGetCursorPos(window, &cursorX, &cursorY);
+	glfwGetWindowSize(window, &width, &height);
+	const float ndcX = 2.0f * static_cast<float>(cursorX) / std::max(width, 1) - 1.0f;
+	const float ndcY = 1.0f - 2.0f * static_cast<float>(cursorY) / std::max(height, 1);
+	const glm::mat4 inverseViewProjection = glm::inverse(getProjectionMatrix() * camera.GetViewMatrix());
+	const glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+	const glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+	const glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	const glm::vec3 ray = glm::vec3(farPoint) / farPoint.w - origin;
+
+	float distance = 0.0f;
+	const uint32_t object = sceneBvh.raycast(origin, glm::normalize(ray), glm::length(ray), distance);
+	if (object == Bvh::NO_OBJECT) {
+		std::cout << "No scene object under the cursor" << std::endl;
+		return;
+	}
+	const char* group = scene.getString(scene.getObjects()[object].group);
+	std::cout << "Picked object " << object << " (" << (group != nullptr ? group : "no group") << ") at distance " << distance << std::endl;
+}
+
+GLint sceneGetTextureLayer(const SceneObjectRecord& object) {
+	return object.texture == SceneFile::NO_TEXTURE ? 0 : sceneTextureLayers[object.texture];
+}
+
+// Load texture utility, images shared by several objects are decoded and uploaded only once
+unsigned int loadTexture(char const* path)
+{
+	TextureHandle texture = textureCache.load(path);
+	if (!texture) {
+		return 0;
+	}
+
+	sceneTextures.push_back(texture);
+	return texture->textureID;
 }
 
 // Mouse functions
 void getMousePosition(GLFWwindow* window, double xpos, double ypos) {
+	// Replayed camera path must not be disturbed
+	if (!appOptions.cameraPathFile.empty()) {
+		return;
+	}
+
 	// If this is the first mouse call set last positions
 	if (firstMouse) {
 		lastX = xpos;
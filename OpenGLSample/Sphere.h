@@ -7,6 +7,12 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include "common/glStateCache.h"
+#include "common/bounds.h"
+#include "common/jobSystem.h"
+#include "common/profiler.h"
+#include "common/sinCos.h"
+
 class Sphere
 {
 private:
@@ -17,89 +23,99 @@ private:
 	float radius = 1.0f;
 	int sectorCount = 36;
 	int stackCount = 18;
+	Bounds bounds; // local space bounds, for culling
 
 public:
 
 	~Sphere()
 	{
 		glDeleteVertexArrays(1, &VAO);
+		GLStateCache::getInstance().forgetVertexArray(VAO);
 		glDeleteBuffers(1, &VBO);
 		glDeleteBuffers(1, &EBO);
 	}
 	Sphere(float r, int sectors, int stacks)
 	{
+		PROFILE_SCOPE("Sphere::Sphere");
 		radius = r;
 		sectorCount = sectors;
 		stackCount = stacks;
 
 
 		/* GENERATE VERTEX ARRAY */
-		float x, y, z, xy;                              // vertex position
-		float lengthInv = 1.0f / radius;    // vertex normal
-		float s, t;                                     // vertex texCoord
-
-		float sectorStep = (float)(2 * M_PI / sectorCount);
+		// sines / cosines of sector and stack angles once per sector and stack, vertices are written in place
 		float stackStep = (float)(M_PI / stackCount);
-		float sectorAngle, stackAngle;
-
-		for (int i = 0; i <= stackCount; ++i)
+		std::vector<float> sectorSines(sectorCount + 1), sectorCosines(sectorCount + 1);
+		std::vector<float> stackSines(stackCount + 1), stackCosines(stackCount + 1);
+		SinCos::computeCircle(sectorCount, sectorSines.data(), sectorCosines.data());
+		SinCos::computeSteps((float)(M_PI / 2), -stackStep, stackCount + 1, stackSines.data(), stackCosines.data()); // starting from pi/2 to -pi/2
+
+		// stacks are split into bands generated by the job system, every vertex and index has its place known up front,
+		// so bands need no locking and the result does not depend on them
+		const size_t verticesPerStack = (size_t)sectorCount + 1;
+		sphere_vertices.resize((stackCount + 1) * verticesPerStack * 5);
+		JobSystem::getInstance().runBands(stackCount + 1, verticesPerStack, [&](size_t firstStack, size_t endStack)
 		{
-			stackAngle = (float)(M_PI / 2 - i * stackStep);        // starting from pi/2 to -pi/2
-			xy = 1.02f * radius * cosf(stackAngle);             // r * cos(u)
-			z = radius * sinf(stackAngle);              // r * sin(u)
-
-														// add (sectorCount+1) vertices per stack
-														// the first and last vertices have same position and normal, but different tex coords
-			for (int j = 0; j <= sectorCount; ++j)
+			float* vertex = sphere_vertices.data() + firstStack * verticesPerStack * 5;
+			for (int i = (int)firstStack; i < (int)endStack; ++i)
 			{
-				sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
-														// vertex position (x, y, z)
-				x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
-				y = xy * sinf(sectorAngle);				// r * cos(u) * sin(v)
-				sphere_vertices.push_back(x);
-				sphere_vertices.push_back(y);
-				sphere_vertices.push_back(z);
+				float xy = 1.02f * radius * stackCosines[i];         // r * cos(u)
+				float z = radius * stackSines[i];                   // r * sin(u)
+				float t = (float)i / stackCount;
 
+															// add (sectorCount+1) vertices per stack
+															// the first and last vertices have same position and normal, but different tex coords
+				for (int j = 0; j <= sectorCount; ++j, vertex += 5)
+				{
+					vertex[0] = xy * sectorCosines[j];              // r * cos(u) * cos(v)
+					vertex[1] = xy * sectorSines[j];                // r * cos(u) * sin(v)
+					vertex[2] = z;
 
-				// vertex tex coord (s, t) range between [0, 1]
-				s = (float)j / sectorCount;
-				t = (float)i / stackCount;
-				sphere_vertices.push_back(s);
-				sphere_vertices.push_back(t);
-
+					// vertex tex coord (s, t) range between [0, 1]
+					vertex[3] = (float)j / sectorCount;
+					vertex[4] = t;
+				}
 			}
-		}
+		});
 		/* GENERATE VERTEX ARRAY */
+		bounds = computeBounds(sphere_vertices.data(), sphere_vertices.size() / 5, 5); // position + tex coord
 
 
 		/* GENERATE INDEX ARRAY */
-		int k1, k2;
-		for (int i = 0; i < stackCount; ++i)
+		// 2 triangles per sector excluding first and last stacks, which have one
+		sphere_indices.resize(stackCount > 1 ? (size_t)sectorCount * (stackCount - 1) * 6 : 0);
+		JobSystem::getInstance().runBands(stackCount, verticesPerStack, [&](size_t firstStack, size_t endStack)
 		{
-			k1 = i * (sectorCount + 1);     // beginning of current stack
-			k2 = k1 + sectorCount + 1;      // beginning of next stack
-
-			for (int j = 0; j < sectorCount; ++j, ++k1, ++k2)
+			// first stack has sectorCount triangles, every next one 2 * sectorCount until the last one
+			int* index = sphere_indices.data() + (firstStack > 0 ? sectorCount * 3 + (firstStack - 1) * sectorCount * 6 : 0);
+			int k1, k2;
+			for (int i = (int)firstStack; i < (int)endStack; ++i)
 			{
-				// 2 triangles per sector excluding first and last stacks
-				// k1 => k2 => k1+1
-				if (i != 0)
-				{
-					sphere_indices.push_back(k1);
-					sphere_indices.push_back(k2);
-					sphere_indices.push_back(k1 + 1);
-				}
+				k1 = i * (sectorCount + 1);     // beginning of current stack
+				k2 = k1 + sectorCount + 1;      // beginning of next stack
 
-				// k1+1 => k2 => k2+1
-				if (i != (stackCount - 1))
+				for (int j = 0; j < sectorCount; ++j, ++k1, ++k2)
 				{
-					sphere_indices.push_back(k1 + 1);
-					sphere_indices.push_back(k2);
-					sphere_indices.push_back(k2 + 1);
+					// k1 => k2 => k1+1
+					if (i != 0)
+					{
+						index[0] = k1;
+						index[1] = k2;
+						index[2] = k1 + 1;
+						index += 3;
+					}
+
+					// k1+1 => k2 => k2+1
+					if (i != (stackCount - 1))
+					{
+						index[0] = k1 + 1;
+						index[1] = k2;
+						index[2] = k2 + 1;
+						index += 3;
+					}
 				}
 			}
-		}
+		});
 		/* GENERATE INDEX ARRAY */
 
 
@@ -127,15 +143,26 @@ public:
 		/* GENERATE VAO-EBO */
 
 
+	}
+	GLuint getVAO() const
+	{
+		return VAO;
+	}
+	const Bounds& getBounds() const
+	{
+		return bounds;
+	}
+	GLsizei getNumIndices() const
+	{
+		return (GLsizei)sphere_indices.size();
 	}
 	void Draw()
 	{
-		glBindVertexArray(VAO);
+		GLStateCache::getInstance().bindVertexArray(VAO);
 		glDrawElements(GL_TRIANGLES,
 			(unsigned int)sphere_indices.size(),
 			GL_UNSIGNED_INT,
 			(void*)0);
-		glBindVertexArray(0);
 	}
 };
 
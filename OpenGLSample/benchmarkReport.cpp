@@ -0,0 +1,123 @@
+// STL
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// Project
+#include "common/benchmarkReport.h"
+
+namespace {
+
+void writeJSONString(std::ostream& stream, const std::string& text)
+{
+    stream << '"';
+    for (const auto c : text)
+    {
+        if (c == '"' || c == '\\') {
+            stream << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            stream << ' ';
+        }
+        else {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+// Nearest-rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p)
+{
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1) + 0.5)];
+}
+
+} // namespace
+
+void BenchmarkReport::setInfo(const std::string& key, const std::string& value)
+{
+    _info.emplace_back(key, value);
+}
+
+void BenchmarkReport::addFrame(const BenchmarkFrame& frame)
+{
+    _frames.push_back(frame);
+}
+
+size_t BenchmarkReport::getNumFrames() const
+{
+    return _frames.size();
+}
+
+bool BenchmarkReport::writeJSON(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot write benchmark report to " << path << "!" << std::endl;
+        return false;
+    }
+
+    std::vector<double> frameTimes;
+    double totalMilliseconds = 0.0;
+    size_t totalDraws = 0;
+    size_t totalTriangles = 0;
+    size_t totalUploadedBytes = 0;
+    size_t maxUploadedBytes = 0;
+    size_t totalStateBinds = 0;
+    size_t totalSkippedStateBinds = 0;
+    size_t totalStateChanges = 0;
+    size_t totalSkippedStateChanges = 0;
+    for (const auto& frame : _frames)
+    {
+        frameTimes.push_back(frame.frameMilliseconds);
+        totalMilliseconds += frame.frameMilliseconds;
+        totalDraws += frame.numDraws;
+        totalTriangles += frame.numTriangles;
+        totalUploadedBytes += frame.numUploadedBytes;
+        maxUploadedBytes = std::max(maxUploadedBytes, frame.numUploadedBytes);
+        totalStateBinds += frame.numStateBinds;
+        totalSkippedStateBinds += frame.numSkippedStateBinds;
+        totalStateChanges += frame.numStateChanges;
+        totalSkippedStateChanges += frame.numSkippedStateChanges;
+    }
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    const auto numFrames = _frames.size();
+    const auto perFrame = [numFrames](double total) { return numFrames > 0 ? total / numFrames : 0.0; };
+
+    file << std::fixed << std::setprecision(4);
+    file << "{" << std::endl;
+    for (const auto& info : _info)
+    {
+        file << "  ";
+        writeJSONString(file, info.first);
+        file << ": ";
+        writeJSONString(file, info.second);
+        file << "," << std::endl;
+    }
+    file << "  \"frames\": " << numFrames << "," << std::endl;
+    file << "  \"frame_time_ms\": {";
+    if (numFrames > 0)
+    {
+        file << "\"mean\": " << totalMilliseconds / numFrames
+            << ", \"p50\": " << percentile(frameTimes, 0.50)
+            << ", \"p95\": " << percentile(frameTimes, 0.95)
+            << ", \"p99\": " << percentile(frameTimes, 0.99)
+            << ", \"max\": " << frameTimes.back();
+    }
+    file << "}," << std::endl;
+    file << "  \"draw_calls_per_frame\": " << perFrame(static_cast<double>(totalDraws)) << "," << std::endl;
+    file << "  \"triangles_per_frame\": " << perFrame(static_cast<double>(totalTriangles)) << "," << std::endl;
+    file << "  \"uploaded_bytes_per_frame\": " << perFrame(static_cast<double>(totalUploadedBytes)) << "," << std::endl;
+    file << "  \"uploaded_bytes_max_frame\": " << maxUploadedBytes << "," << std::endl;
+    file << "  \"uploaded_bytes_total\": " << totalUploadedBytes << "," << std::endl;
+    file << "  \"state_binds_per_frame\": " << perFrame(static_cast<double>(totalStateBinds)) << "," << std::endl;
+    file << "  \"state_binds_skipped_per_frame\": " << perFrame(static_cast<double>(totalSkippedStateBinds)) << "," << std::endl;
+    file << "  \"state_changes_per_frame\": " << perFrame(static_cast<double>(totalStateChanges)) << "," << std::endl;
+    file << "  \"state_changes_skipped_per_frame\": " << perFrame(static_cast<double>(totalSkippedStateChanges)) << std::endl;
+    file << "}" << std::endl;
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,84 @@
+// STL
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+// Project
+#include "common/bounds.h"
+#include "common/jobSystem.h"
+
+Bounds computeBounds(const float* positions, size_t numVertices, size_t strideFloats)
+{
+    Bounds bounds;
+    if (numVertices == 0) {
+        return bounds;
+    }
+
+    // Large meshes are scanned in bands by the job system, bands are merged under the lock.
+    // Minimum and maximum do not depend on the order of the merges, so the bounds do not depend on the bands.
+    std::mutex mergeMutex;
+    bounds.boxMin = glm::vec3(positions[0], positions[1], positions[2]);
+    bounds.boxMax = bounds.boxMin;
+    JobSystem::getInstance().runBands(numVertices, 1, [&](size_t firstVertex, size_t endVertex) {
+        auto boxMin = bounds.boxMin;
+        auto boxMax = bounds.boxMax;
+        for (size_t i = firstVertex; i < endVertex; i++)
+        {
+            const auto position = glm::vec3(positions[i * strideFloats], positions[i * strideFloats + 1], positions[i * strideFloats + 2]);
+            boxMin = glm::min(boxMin, position);
+            boxMax = glm::max(boxMax, position);
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        bounds.boxMin = glm::min(bounds.boxMin, boxMin);
+        bounds.boxMax = glm::max(bounds.boxMax, boxMax);
+    });
+
+    // Box center is not the smallest sphere, but it is close for the symmetric primitives used here
+    bounds.sphereCenter = (bounds.boxMin + bounds.boxMax) * 0.5f;
+    auto maxDistanceSquared = 0.0f;
+    JobSystem::getInstance().runBands(numVertices, 1, [&](size_t firstVertex, size_t endVertex) {
+        auto bandDistanceSquared = 0.0f;
+        for (size_t i = firstVertex; i < endVertex; i++)
+        {
+            const auto position = glm::vec3(positions[i * strideFloats], positions[i * strideFloats + 1], positions[i * strideFloats + 2]);
+            const auto offset = position - bounds.sphereCenter;
+            bandDistanceSquared = std::max(bandDistanceSquared, glm::dot(offset, offset));
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        maxDistanceSquared = std::max(maxDistanceSquared, bandDistanceSquared);
+    });
+    bounds.sphereRadius = std::sqrt(maxDistanceSquared);
+
+    return bounds;
+}
+
+Bounds makeBoxBounds(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    Bounds bounds;
+    bounds.boxMin = boxMin;
+    bounds.boxMax = boxMax;
+    bounds.sphereCenter = (boxMin + boxMax) * 0.5f;
+    bounds.sphereRadius = glm::length(boxMax - boxMin) * 0.5f;
+    return bounds;
+}
+
+Bounds transformBounds(const Bounds& bounds, const glm::mat4& model)
+{
+    // Box extent in world space is the sum of absolute values of the transformed local axes (Arvo)
+    const auto center = glm::vec3(model * glm::vec4((bounds.boxMin + bounds.boxMax) * 0.5f, 1.0f));
+    const auto extent = (bounds.boxMax - bounds.boxMin) * 0.5f;
+    const auto worldExtent = glm::abs(glm::vec3(model[0])) * extent.x
+        + glm::abs(glm::vec3(model[1])) * extent.y
+        + glm::abs(glm::vec3(model[2])) * extent.z;
+
+    const auto maxScale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+    Bounds result;
+    result.boxMin = center - worldExtent;
+    result.boxMax = center + worldExtent;
+    result.sphereCenter = glm::vec3(model * glm::vec4(bounds.sphereCenter, 1.0f));
+    result.sphereRadius = bounds.sphereRadius * maxScale;
+    return result;
+}
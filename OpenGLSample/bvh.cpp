@@ -0,0 +1,523 @@
+// STL
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <limits>
+#include <thread>
+
+// Project
+#include "common/bvh.h"
+#include "common/profiler.h"
+
+const uint32_t Bvh::NO_NODE;
+const uint32_t Bvh::NO_OBJECT;
+const uint32_t Bvh::NUM_BINS;
+const uint32_t Bvh::MAX_LEAF_OBJECTS;
+const uint32_t Bvh::MAX_DEPTH;
+const uint32_t Bvh::PARALLEL_MIN_OBJECTS;
+
+void Bvh::Bin::addBox(const glm::vec3& objectBoxMin, const glm::vec3& objectBoxMax)
+{
+    const auto center = (objectBoxMin + objectBoxMax) * 0.5f;
+    boxMin = glm::min(boxMin, objectBoxMin);
+    boxMax = glm::max(boxMax, objectBoxMax);
+    centerMin = glm::min(centerMin, center);
+    centerMax = glm::max(centerMax, center);
+    numObjects++;
+}
+
+void Bvh::Bin::addBin(const Bin& bin)
+{
+    boxMin = glm::min(boxMin, bin.boxMin);
+    boxMax = glm::max(boxMax, bin.boxMax);
+    centerMin = glm::min(centerMin, bin.centerMin);
+    centerMax = glm::max(centerMax, bin.centerMax);
+    numObjects += bin.numObjects;
+}
+
+namespace {
+
+float surfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    const auto size = boxMax - boxMin;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// Entry distance of the ray into the box, negative if it misses the box before maxDistance
+float intersectBox(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    const auto t0 = (boxMin - origin) * inverseDirection;
+    const auto t1 = (boxMax - origin) * inverseDirection;
+    const auto tNear = glm::min(t0, t1);
+    const auto tFar = glm::max(t0, t1);
+    const auto entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    const auto exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    return entry <= exit ? entry : -1.0f;
+}
+
+float distanceSquaredToBox(const glm::vec3& point, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    const auto offset = glm::max(glm::max(boxMin - point, point - boxMax), glm::vec3(0.0f));
+    return glm::dot(offset, offset);
+}
+
+} // namespace
+
+void Bvh::setNumObjects(size_t numObjects)
+{
+    clear();
+    _objectBoxMin.resize(numObjects, glm::vec3(0.0f));
+    _objectBoxMax.resize(numObjects, glm::vec3(0.0f));
+    _objectLeaves.resize(numObjects, NO_NODE);
+}
+
+void Bvh::setBounds(uint32_t index, const Bounds& worldBounds)
+{
+    _objectBoxMin[index] = worldBounds.boxMin;
+    _objectBoxMax[index] = worldBounds.boxMax;
+
+    const auto leaf = _objectLeaves[index];
+    if (leaf != NO_NODE && !_isNodeDirty[leaf])
+    {
+        _isNodeDirty[leaf] = 1;
+        _dirtyNodes.push_back(leaf);
+    }
+}
+
+size_t Bvh::build(const std::vector<uint32_t>& objects)
+{
+    PROFILE_SCOPE("Bvh::build");
+    _nodes.clear();
+    _objectOrder = objects;
+    _isNodeDirty.clear();
+    _dirtyNodes.clear();
+    std::fill(_objectLeaves.begin(), _objectLeaves.end(), NO_NODE);
+    if (objects.empty()) {
+        return 0;
+    }
+
+    // Binary tree with at least one object per leaf never has more nodes than this
+    _nodes.resize(objects.size() * 2 - 1);
+    Bin rootBin;
+    computeRangeBounds(0, static_cast<uint32_t>(objects.size()), rootBin);
+    _nodes[0] = { rootBin.boxMin, rootBin.boxMax, 0, static_cast<uint32_t>(objects.size()), 0, NO_NODE };
+    _numBuiltNodes = 1;
+    buildNode(0, 0, rootBin.centerMin, rootBin.centerMax);
+    _nodes.resize(_numBuiltNodes);
+
+    for (uint32_t node = 0; node < _nodes.size(); node++)
+    {
+        if (_nodes[node].leftChild != 0) {
+            continue;
+        }
+        for (uint32_t i = _nodes[node].firstObject; i < _nodes[node].firstObject + _nodes[node].numObjects; i++) {
+            _objectLeaves[_objectOrder[i]] = node;
+        }
+    }
+    _isNodeDirty.assign(_nodes.size(), 0);
+    return _nodes.size();
+}
+
+void Bvh::buildNode(uint32_t node, uint32_t depth, const glm::vec3& centerMin, const glm::vec3& centerMax)
+{
+    // Box of the node has been set by its parent, which also knows box of the centers, so objects are scanned once per level
+    const auto firstObject = _nodes[node].firstObject;
+    const auto numObjects = _nodes[node].numObjects;
+    _nodes[node].leftChild = 0;
+    if (numObjects <= 1 || depth + 1 >= MAX_DEPTH) {
+        return;
+    }
+
+    const auto centerSize = centerMax - centerMin;
+    const int axis = centerSize.x >= centerSize.y && centerSize.x >= centerSize.z ? 0 : (centerSize.y >= centerSize.z ? 1 : 2);
+    const auto first = _objectOrder.begin() + firstObject;
+    const auto last = first + numObjects;
+    auto middle = first;
+    Bin leftBin;
+    Bin rightBin;
+
+    if (centerSize[axis] <= 0.0f)
+    {
+        // All centers coincide, no plane separates them
+        if (numObjects <= MAX_LEAF_OBJECTS) {
+            return;
+        }
+        middle = first + numObjects / 2;
+        computeRangeBounds(firstObject, numObjects / 2, leftBin);
+        computeRangeBounds(firstObject + numObjects / 2, numObjects - numObjects / 2, rightBin);
+    }
+    else
+    {
+        // Small nodes do not need as many candidate planes as objects near the root
+        const auto numBins = std::min(NUM_BINS, std::max(numObjects, 2u));
+        Bin bins[NUM_BINS];
+        const auto binScale = numBins / centerSize[axis];
+        const auto binOf = [&](uint32_t object) {
+            const auto center = (_objectBoxMin[object][axis] + _objectBoxMax[object][axis]) * 0.5f;
+            return std::min(numBins - 1, static_cast<uint32_t>((center - centerMin[axis]) * binScale));
+        };
+        for (auto it = first; it != last; ++it) {
+            bins[binOf(*it)].addBox(_objectBoxMin[*it], _objectBoxMax[*it]);
+        }
+
+        // Split after bin i has bins 0 to i on the left and the others, merged in rightBins[i], on the right
+        Bin rightBins[NUM_BINS];
+        for (auto i = numBins - 1; i > 0; i--)
+        {
+            rightBins[i - 1] = i == numBins - 1 ? Bin() : rightBins[i];
+            rightBins[i - 1].addBin(bins[i]);
+        }
+
+        // Cost of the split is traversal (1) plus objects of each side weighted by the chance of hitting its box
+        const auto nodeArea = std::max(surfaceArea(_nodes[node].boxMin, _nodes[node].boxMax), std::numeric_limits<float>::min());
+        auto bestCost = std::numeric_limits<float>::max();
+        uint32_t bestBin = 0;
+        Bin left;
+        for (uint32_t i = 0; i + 1 < numBins; i++)
+        {
+            left.addBin(bins[i]);
+            const auto& right = rightBins[i];
+            if (left.numObjects == 0 || right.numObjects == 0) {
+                continue;
+            }
+            const auto cost = 1.0f + (surfaceArea(left.boxMin, left.boxMax) * left.numObjects
+                + surfaceArea(right.boxMin, right.boxMax) * right.numObjects) / nodeArea;
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestBin = i;
+                leftBin = left;
+                rightBin = right;
+            }
+        }
+
+        if (numObjects <= MAX_LEAF_OBJECTS && static_cast<float>(numObjects) <= bestCost) {
+            return;
+        }
+        middle = std::partition(first, last, [&](uint32_t object) { return binOf(object) <= bestBin; });
+    }
+
+    const auto leftChild = _numBuiltNodes.fetch_add(2);
+    const auto numLeftObjects = static_cast<uint32_t>(middle - first);
+    _nodes[node].leftChild = leftChild;
+    _nodes[leftChild] = { leftBin.boxMin, leftBin.boxMax, firstObject, numLeftObjects, 0, node };
+    _nodes[leftChild + 1] = { rightBin.boxMin, rightBin.boxMax, firstObject + numLeftObjects, numObjects - numLeftObjects, 0, node };
+
+    // Large subtrees near the root are split between threads, until there is one per hardware thread
+    static const auto numThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (numObjects >= PARALLEL_MIN_OBJECTS && (1u << std::min(depth, 31u)) < numThreads)
+    {
+        auto leftBuild = std::async(std::launch::async, &Bvh::buildNode, this, leftChild, depth + 1, leftBin.centerMin, leftBin.centerMax);
+        buildNode(leftChild + 1, depth + 1, rightBin.centerMin, rightBin.centerMax);
+        leftBuild.get();
+    }
+    else
+    {
+        buildNode(leftChild, depth + 1, leftBin.centerMin, leftBin.centerMax);
+        buildNode(leftChild + 1, depth + 1, rightBin.centerMin, rightBin.centerMax);
+    }
+}
+
+void Bvh::computeRangeBounds(uint32_t firstObject, uint32_t numObjects, Bin& bounds) const
+{
+    bounds = Bin();
+    for (auto i = firstObject; i < firstObject + numObjects; i++) {
+        bounds.addBox(_objectBoxMin[_objectOrder[i]], _objectBoxMax[_objectOrder[i]]);
+    }
+}
+
+size_t Bvh::refit()
+{
+    if (_dirtyNodes.empty()) {
+        return 0;
+    }
+
+    PROFILE_SCOPE("Bvh::refit");
+
+    // Ancestors of the moved leaves, each one only once
+    for (size_t i = 0; i < _dirtyNodes.size(); i++)
+    {
+        const auto parent = _nodes[_dirtyNodes[i]].parent;
+        if (parent != NO_NODE && !_isNodeDirty[parent])
+        {
+            _isNodeDirty[parent] = 1;
+            _dirtyNodes.push_back(parent);
+        }
+    }
+
+    // Children have greater indices than their parents, so they are refit first
+    std::sort(_dirtyNodes.begin(), _dirtyNodes.end(), std::greater<uint32_t>());
+    for (const auto nodeIndex : _dirtyNodes)
+    {
+        auto& node = _nodes[nodeIndex];
+        if (node.leftChild == 0)
+        {
+            Bin leafBin;
+            computeRangeBounds(node.firstObject, node.numObjects, leafBin);
+            node.boxMin = leafBin.boxMin;
+            node.boxMax = leafBin.boxMax;
+        }
+        else
+        {
+            node.boxMin = glm::min(_nodes[node.leftChild].boxMin, _nodes[node.leftChild + 1].boxMin);
+            node.boxMax = glm::max(_nodes[node.leftChild].boxMax, _nodes[node.leftChild + 1].boxMax);
+        }
+        _isNodeDirty[nodeIndex] = 0;
+    }
+
+    const auto numRefitNodes = _dirtyNodes.size();
+    _dirtyNodes.clear();
+    return numRefitNodes;
+}
+
+void Bvh::cullFrustum(const glm::vec4* planes, std::vector<uint32_t>& visibleObjects, uint32_t root) const
+{
+    if (root >= _nodes.size()) {
+        return;
+    }
+
+    const unsigned int ALL_PLANES = 0x3F;
+
+    // Each entry carries planes its node may still cross, planes the parent is completely in front of are not tested again
+    struct Entry
+    {
+        uint32_t node;
+        unsigned int planeMask;
+    };
+    Entry stack[MAX_DEPTH];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = { root, ALL_PLANES };
+
+    while (stackSize > 0)
+    {
+        const auto entry = stack[--stackSize];
+        const auto& node = _nodes[entry.node];
+
+        auto planeMask = entry.planeMask;
+        bool isOutside = false;
+        const auto center = (node.boxMin + node.boxMax) * 0.5f;
+        const auto extent = (node.boxMax - node.boxMin) * 0.5f;
+        for (int plane = 0; plane < 6 && !isOutside; plane++)
+        {
+            if (!(planeMask & (1u << plane))) {
+                continue;
+            }
+            const auto normal = glm::vec3(planes[plane]);
+            const auto distance = glm::dot(normal, center) + planes[plane].w;
+            const auto radius = glm::dot(glm::abs(normal), extent);
+            isOutside = distance + radius < 0.0f;
+            if (distance - radius >= 0.0f) {
+                planeMask &= ~(1u << plane);
+            }
+        }
+
+        if (isOutside) {
+            continue;
+        }
+        if (planeMask == 0)
+        {
+            // Whole subtree is inside
+            visibleObjects.insert(visibleObjects.end(), _objectOrder.begin() + node.firstObject, _objectOrder.begin() + node.firstObject + node.numObjects);
+            continue;
+        }
+        if (node.leftChild != 0)
+        {
+            stack[stackSize++] = { node.leftChild, planeMask };
+            stack[stackSize++] = { node.leftChild + 1, planeMask };
+            continue;
+        }
+
+        for (auto i = node.firstObject; i < node.firstObject + node.numObjects; i++)
+        {
+            const auto object = _objectOrder[i];
+            const auto objectCenter = (_objectBoxMin[object] + _objectBoxMax[object]) * 0.5f;
+            const auto objectExtent = (_objectBoxMax[object] - _objectBoxMin[object]) * 0.5f;
+            bool isObjectOutside = false;
+            for (int plane = 0; plane < 6 && !isObjectOutside; plane++)
+            {
+                const auto normal = glm::vec3(planes[plane]);
+                isObjectOutside = (planeMask & (1u << plane))
+                    && glm::dot(normal, objectCenter) + planes[plane].w + glm::dot(glm::abs(normal), objectExtent) < 0.0f;
+            }
+            if (!isObjectOutside) {
+                visibleObjects.push_back(object);
+            }
+        }
+    }
+}
+
+void Bvh::getSubtrees(uint32_t depth, std::vector<uint32_t>& roots) const
+{
+    roots.clear();
+    if (_nodes.empty()) {
+        return;
+    }
+
+    // Breadth first, one level at a time
+    roots.push_back(0);
+    for (uint32_t level = 0; level < depth; level++)
+    {
+        std::vector<uint32_t> nextRoots;
+        for (const auto node : roots)
+        {
+            if (_nodes[node].leftChild == 0) {
+                nextRoots.push_back(node);
+            }
+            else
+            {
+                nextRoots.push_back(_nodes[node].leftChild);
+                nextRoots.push_back(_nodes[node].leftChild + 1);
+            }
+        }
+        roots.swap(nextRoots);
+    }
+}
+
+uint32_t Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const
+{
+    uint32_t hitObject = NO_OBJECT;
+    hitDistance = maxDistance;
+    if (_nodes.empty() || intersectBox(origin, 1.0f / direction, maxDistance, _nodes[0].boxMin, _nodes[0].boxMax) < 0.0f) {
+        return hitObject;
+    }
+
+    // Nearer child is visited first, entries farther than the closest hit so far are dropped when popped
+    const auto inverseDirection = 1.0f / direction;
+    struct Entry
+    {
+        uint32_t node;
+        float distance;
+    };
+    Entry stack[MAX_DEPTH];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = { 0, 0.0f };
+
+    while (stackSize > 0)
+    {
+        const auto entry = stack[--stackSize];
+        if (entry.distance > hitDistance) {
+            continue;
+        }
+
+        const auto& node = _nodes[entry.node];
+        if (node.leftChild == 0)
+        {
+            for (auto i = node.firstObject; i < node.firstObject + node.numObjects; i++)
+            {
+                const auto object = _objectOrder[i];
+                const auto distance = intersectBox(origin, inverseDirection, hitDistance, _objectBoxMin[object], _objectBoxMax[object]);
+                if (distance >= 0.0f && (distance < hitDistance || hitObject == NO_OBJECT))
+                {
+                    hitDistance = distance;
+                    hitObject = object;
+                }
+            }
+            continue;
+        }
+
+        const auto& left = _nodes[node.leftChild];
+        const auto& right = _nodes[node.leftChild + 1];
+        const auto leftDistance = intersectBox(origin, inverseDirection, hitDistance, left.boxMin, left.boxMax);
+        const auto rightDistance = intersectBox(origin, inverseDirection, hitDistance, right.boxMin, right.boxMax);
+        const bool isLeftFirst = leftDistance >= 0.0f && (rightDistance < 0.0f || leftDistance <= rightDistance);
+        const Entry leftEntry = { node.leftChild, leftDistance };
+        const Entry rightEntry = { node.leftChild + 1, rightDistance };
+        const auto& farEntry = isLeftFirst ? rightEntry : leftEntry;
+        const auto& nearEntry = isLeftFirst ? leftEntry : rightEntry;
+        if (farEntry.distance >= 0.0f) {
+            stack[stackSize++] = farEntry;
+        }
+        if (nearEntry.distance >= 0.0f) {
+            stack[stackSize++] = nearEntry;
+        }
+    }
+
+    if (hitObject == NO_OBJECT) {
+        hitDistance = 0.0f;
+    }
+    return hitObject;
+}
+
+uint32_t Bvh::findNearest(const glm::vec3& point, float maxDistance, float& distance) const
+{
+    uint32_t nearestObject = NO_OBJECT;
+    auto nearestDistanceSquared = maxDistance * maxDistance;
+    distance = 0.0f;
+    if (_nodes.empty()) {
+        return nearestObject;
+    }
+
+    // Same traversal as raycast, with distance to the point instead of distance along the ray
+    struct Entry
+    {
+        uint32_t node;
+        float distanceSquared;
+    };
+    Entry stack[MAX_DEPTH];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = { 0, distanceSquaredToBox(point, _nodes[0].boxMin, _nodes[0].boxMax) };
+
+    while (stackSize > 0)
+    {
+        const auto entry = stack[--stackSize];
+        if (entry.distanceSquared > nearestDistanceSquared) {
+            continue;
+        }
+
+        const auto& node = _nodes[entry.node];
+        if (node.leftChild == 0)
+        {
+            for (auto i = node.firstObject; i < node.firstObject + node.numObjects; i++)
+            {
+                const auto object = _objectOrder[i];
+                const auto distanceSquared = distanceSquaredToBox(point, _objectBoxMin[object], _objectBoxMax[object]);
+                if (distanceSquared < nearestDistanceSquared || (distanceSquared == nearestDistanceSquared && nearestObject == NO_OBJECT))
+                {
+                    nearestDistanceSquared = distanceSquared;
+                    nearestObject = object;
+                }
+            }
+            continue;
+        }
+
+        const Entry leftEntry = { node.leftChild, distanceSquaredToBox(point, _nodes[node.leftChild].boxMin, _nodes[node.leftChild].boxMax) };
+        const Entry rightEntry = { node.leftChild + 1, distanceSquaredToBox(point, _nodes[node.leftChild + 1].boxMin, _nodes[node.leftChild + 1].boxMax) };
+        const bool isLeftFirst = leftEntry.distanceSquared <= rightEntry.distanceSquared;
+        const auto& farEntry = isLeftFirst ? rightEntry : leftEntry;
+        const auto& nearEntry = isLeftFirst ? leftEntry : rightEntry;
+        if (farEntry.distanceSquared <= nearestDistanceSquared) {
+            stack[stackSize++] = farEntry;
+        }
+        if (nearEntry.distanceSquared <= nearestDistanceSquared) {
+            stack[stackSize++] = nearEntry;
+        }
+    }
+
+    if (nearestObject != NO_OBJECT) {
+        distance = std::sqrt(nearestDistanceSquared);
+    }
+    return nearestObject;
+}
+
+size_t Bvh::getNumNodes() const
+{
+    return _nodes.size();
+}
+
+const BvhNode& Bvh::getNode(uint32_t node) const
+{
+    return _nodes[node];
+}
+
+void Bvh::clear()
+{
+    _objectBoxMin.clear();
+    _objectBoxMax.clear();
+    _objectLeaves.clear();
+    _nodes.clear();
+    _objectOrder.clear();
+    _numBuiltNodes = 0;
+    _isNodeDirty.clear();
+    _dirtyNodes.clear();
+}
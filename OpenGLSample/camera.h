@@ -102,6 +102,16 @@ public:
 		updateCameraVectors();
 	}
 
+	// sets position, Euler angles and zoom at once (e.g. when replaying a recorded camera path)
+	void SetState(glm::vec3 position, float yaw, float pitch, float zoom)
+	{
+		Position = position;
+		Yaw = yaw;
+		Pitch = pitch;
+		Zoom = zoom;
+		updateCameraVectors();
+	}
+
 	// processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
 	void ProcessMouseScroll(float yoffset)
 	{
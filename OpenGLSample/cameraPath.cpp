@@ -0,0 +1,143 @@
+// STL
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Project
+#include "common/cameraPath.h"
+
+namespace {
+
+template<typename T>
+T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+{
+    const auto t2 = t * t;
+    const auto t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+} // namespace
+
+void CameraPath::addKeyframe(const CameraKeyframe& keyframe)
+{
+    _keyframes.push_back(keyframe);
+}
+
+void CameraPath::clear()
+{
+    _keyframes.clear();
+}
+
+bool CameraPath::loadFromFile(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot open camera path " << path << "!" << std::endl;
+        return false;
+    }
+
+    _keyframes.clear();
+    std::string line;
+    auto lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        CameraKeyframe keyframe;
+        std::istringstream lineStream(line);
+        if (!(lineStream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+            >> keyframe.yaw >> keyframe.pitch >> keyframe.zoom))
+        {
+            std::cerr << "Invalid keyframe on line " << lineNumber << " of camera path " << path << "!" << std::endl;
+            return false;
+        }
+        if (!_keyframes.empty() && keyframe.time < _keyframes.back().time)
+        {
+            std::cerr << "Keyframe on line " << lineNumber << " of camera path " << path << " goes back in time!" << std::endl;
+            return false;
+        }
+        _keyframes.push_back(keyframe);
+    }
+
+    if (_keyframes.empty())
+    {
+        std::cerr << "Camera path " << path << " has no keyframes!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool CameraPath::saveToFile(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot write camera path " << path << "!" << std::endl;
+        return false;
+    }
+
+    file << "# time x y z yaw pitch zoom" << std::endl;
+    for (const auto& keyframe : _keyframes)
+    {
+        file << keyframe.time << " " << keyframe.position.x << " " << keyframe.position.y << " " << keyframe.position.z
+            << " " << keyframe.yaw << " " << keyframe.pitch << " " << keyframe.zoom << std::endl;
+    }
+
+    return static_cast<bool>(file);
+}
+
+CameraKeyframe CameraPath::sample(float time) const
+{
+    if (_keyframes.empty()) {
+        return CameraKeyframe();
+    }
+    if (_keyframes.size() == 1) {
+        return _keyframes.front();
+    }
+
+    const auto start = _keyframes.front().time;
+    const auto duration = _keyframes.back().time - start;
+    if (duration > 0.0f) {
+        time = start + std::fmod(std::fmod(time - start, duration) + duration, duration);
+    }
+
+    // Segment [i1, i2] containing the time, end keyframes are repeated as outer control points
+    const auto it = std::upper_bound(_keyframes.begin(), _keyframes.end(), time,
+        [](float t, const CameraKeyframe& keyframe) { return t < keyframe.time; });
+    const auto i2 = std::min(static_cast<size_t>(it - _keyframes.begin()), _keyframes.size() - 1);
+    const auto i1 = i2 > 0 ? i2 - 1 : 0;
+    const auto i0 = i1 > 0 ? i1 - 1 : 0;
+    const auto i3 = std::min(i2 + 1, _keyframes.size() - 1);
+
+    const auto& k0 = _keyframes[i0];
+    const auto& k1 = _keyframes[i1];
+    const auto& k2 = _keyframes[i2];
+    const auto& k3 = _keyframes[i3];
+    const auto segmentDuration = k2.time - k1.time;
+    const auto t = segmentDuration > 0.0f ? glm::clamp((time - k1.time) / segmentDuration, 0.0f, 1.0f) : 0.0f;
+
+    CameraKeyframe result;
+    result.time = time;
+    result.position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+    result.yaw = catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+    result.pitch = glm::clamp(catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t), -89.0f, 89.0f);
+    result.zoom = glm::clamp(catmullRom(k0.zoom, k1.zoom, k2.zoom, k3.zoom, t), 1.0f, 45.0f);
+    return result;
+}
+
+float CameraPath::getDuration() const
+{
+    return _keyframes.empty() ? 0.0f : _keyframes.back().time;
+}
+
+size_t CameraPath::getNumKeyframes() const
+{
+    return _keyframes.size();
+}
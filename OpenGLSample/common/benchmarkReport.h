@@ -0,0 +1,47 @@
+#pragma once
+
+// STL
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+  Measurements of one benchmark frame.
+*/
+struct BenchmarkFrame
+{
+	double frameMilliseconds; //!< Wall time of the frame, including waiting for the GPU
+	size_t numDraws;
+	size_t numTriangles;
+	size_t numUploadedBytes;
+	size_t numStateBinds; //!< Binds issued by GLStateCache
+	size_t numSkippedStateBinds; //!< Redundant binds skipped by GLStateCache
+	size_t numStateChanges; //!< Enables and other state changes issued by GLStateCache
+	size_t numSkippedStateChanges; //!< Redundant enables and other state changes skipped by GLStateCache
+};
+
+/**
+  Collects per-frame measurements of a benchmark run and writes them as a JSON report with frame time
+  statistics (mean, p50, p95, p99, max) and per-frame draw calls, triangles, uploaded bytes and state changes issued and skipped by GLStateCache.
+*/
+class BenchmarkReport
+{
+public:
+	/** \brief Adds descriptive value to the report (renderer, camera path...). */
+	void setInfo(const std::string& key, const std::string& value);
+
+	/** \brief Adds measurements of one frame. */
+	void addFrame(const BenchmarkFrame& frame);
+
+	size_t getNumFrames() const;
+
+	/** \brief Writes the report.
+	*   \param path Path of the output JSON file
+	*   \return True if the file has been written or false otherwise.
+	*/
+	bool writeJSON(const std::string& path) const;
+
+private:
+	std::vector<std::pair<std::string, std::string>> _info;
+	std::vector<BenchmarkFrame> _frames;
+};
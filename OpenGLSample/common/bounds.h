@@ -0,0 +1,34 @@
+#pragma once
+
+// STL
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+/**
+  Bounding volumes of a mesh: axis-aligned box and sphere. Computed once when the mesh is created,
+  in its local space, and transformed by the model matrix for culling.
+*/
+struct Bounds
+{
+	glm::vec3 boxMin = glm::vec3(0.0f);
+	glm::vec3 boxMax = glm::vec3(0.0f);
+	glm::vec3 sphereCenter = glm::vec3(0.0f);
+	float sphereRadius = 0.0f;
+};
+
+/** \brief Computes bounds of vertex positions. Sphere is centered in the box, radius reaches the farthest vertex.
+*          Many positions are scanned in bands by the job system, so it must not be called from a job.
+*   \param positions    First coordinate of the first position
+*   \param numVertices  Number of vertices
+*   \param strideFloats Distance between two consecutive positions, in floats
+*/
+Bounds computeBounds(const float* positions, size_t numVertices, size_t strideFloats);
+
+/** \brief Makes bounds of an axis-aligned box (its sphere touches the box corners). */
+Bounds makeBoxBounds(const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+/** \brief Transforms bounds by model matrix. The box is the axis-aligned box of the transformed box,
+*          the sphere radius is scaled by the largest axis scale of the matrix.
+*/
+Bounds transformBounds(const Bounds& bounds, const glm::mat4& model);
@@ -0,0 +1,125 @@
+#pragma once
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Project
+#include "bounds.h"
+
+/**
+  Node of the bounding volume hierarchy. Every node covers a contiguous range of the object order
+  of the hierarchy, so that all objects of a subtree can be gathered without visiting it.
+*/
+struct BvhNode
+{
+	glm::vec3 boxMin; //!< Box of all objects of the subtree
+	glm::vec3 boxMax;
+	uint32_t firstObject; //!< First object of the subtree in the object order
+	uint32_t numObjects; //!< Objects of the subtree
+	uint32_t leftChild; //!< Right child follows it, 0 for leaves (root is never a child)
+	uint32_t parent; //!< NO_NODE for the root
+};
+
+/**
+  Bounding volume hierarchy over world-space boxes of objects, for hierarchical frustum culling, ray picking
+  and nearest object queries in logarithmic time. Built top-down with binned surface area heuristic, large
+  subtrees are built in parallel. Moved objects only refit boxes of their leaves and ancestors: topology is kept,
+  so the hierarchy should be built again when objects have moved far from where they were at build time.
+*/
+class Bvh
+{
+public:
+	static const uint32_t NO_NODE = 0xFFFFFFFF;
+	static const uint32_t NO_OBJECT = 0xFFFFFFFF;
+	static const uint32_t NUM_BINS = 16; //!< Candidate split planes per node are placed between bins
+	static const uint32_t MAX_LEAF_OBJECTS = 4; //!< Larger leaves are made only if no split reduces the cost
+	static const uint32_t MAX_DEPTH = 64; //!< Size of the traversal stacks
+	static const uint32_t PARALLEL_MIN_OBJECTS = 16384; //!< Smaller subtrees are built by the thread that split their parent
+
+	Bvh() = default;
+	Bvh(const Bvh&) = delete;
+	Bvh& operator=(const Bvh&) = delete;
+
+	/** \brief Sets number of objects, object indices are then 0 to numObjects - 1. Clears the hierarchy. */
+	void setNumObjects(size_t numObjects);
+
+	/** \brief Sets world-space bounds of the object. If the object is in the hierarchy, its leaf is refit by the next refit call. */
+	void setBounds(uint32_t index, const Bounds& worldBounds);
+
+	/** \brief Builds hierarchy over the objects (others are never returned by queries).
+	*   \return Number of nodes
+	*/
+	size_t build(const std::vector<uint32_t>& objects);
+
+	/** \brief Updates boxes of leaves whose objects have moved since last build or refit, and of their ancestors.
+	*   \return Number of updated nodes
+	*/
+	size_t refit();
+
+	/** \brief Gathers objects whose boxes are not completely behind any of the planes.
+	*   \param planes         6 frustum planes, xyz = inward normal, w = distance (see FrustumCuller::getPlanes)
+	*   \param visibleObjects Visible objects are appended to it, in no particular order
+	*   \param root           Node whose subtree is tested, subtrees of getSubtrees can be tested by different threads
+	*/
+	void cullFrustum(const glm::vec4* planes, std::vector<uint32_t>& visibleObjects, uint32_t root = 0) const;
+
+	/** \brief Gets nodes at given depth (and leaves above it), whose subtrees together cover all objects. */
+	void getSubtrees(uint32_t depth, std::vector<uint32_t>& roots) const;
+
+	/** \brief Finds object whose box is hit first by the ray.
+	*   \param direction   Ray direction, does not have to be normalized (distances are then in its units)
+	*   \param maxDistance Hits farther than it are ignored
+	*   \param hitDistance Distance of the hit along the ray, 0 if the origin is inside the box
+	*   \return Hit object, NO_OBJECT if there is none
+	*/
+	uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const;
+
+	/** \brief Finds object whose box is closest to the point.
+	*   \param maxDistance Objects farther than it are ignored
+	*   \param distance    Distance of the point to the box, 0 if it is inside
+	*   \return Nearest object, NO_OBJECT if there is none
+	*/
+	uint32_t findNearest(const glm::vec3& point, float maxDistance, float& distance) const;
+
+	size_t getNumNodes() const;
+	const BvhNode& getNode(uint32_t node) const;
+
+	/** \brief Clears objects and the hierarchy. */
+	void clear();
+
+private:
+	//! Bounds of a group of objects while building: their box, box of their centers and their count
+	struct Bin
+	{
+		glm::vec3 boxMin = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 boxMax = glm::vec3(-std::numeric_limits<float>::max());
+		glm::vec3 centerMin = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 centerMax = glm::vec3(-std::numeric_limits<float>::max());
+		uint32_t numObjects = 0;
+
+		void addBox(const glm::vec3& objectBoxMin, const glm::vec3& objectBoxMax);
+		void addBin(const Bin& bin);
+	};
+
+	//! Builds subtree of the node over its range of the object order, splits large subtrees between threads
+	void buildNode(uint32_t node, uint32_t depth, const glm::vec3& centerMin, const glm::vec3& centerMax);
+
+	//! Bounds of the objects in range of the object order
+	void computeRangeBounds(uint32_t firstObject, uint32_t numObjects, Bin& bounds) const;
+
+	std::vector<glm::vec3> _objectBoxMin; //! World box of every object
+	std::vector<glm::vec3> _objectBoxMax;
+	std::vector<uint32_t> _objectLeaves; //! Leaf containing the object, NO_NODE if it is not in the hierarchy
+
+	std::vector<BvhNode> _nodes; //! Root first, parents before their children
+	std::vector<uint32_t> _objectOrder; //! Objects as the leaves reference them
+	std::atomic<uint32_t> _numBuiltNodes{ 0 }; //! Nodes are taken from _nodes by the build threads through this counter
+
+	std::vector<uint8_t> _isNodeDirty; //! Node is in _dirtyNodes
+	std::vector<uint32_t> _dirtyNodes; //! Leaves with moved objects, their ancestors are added by refit
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// STL
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+  Camera state at a point of time.
+*/
+struct CameraKeyframe
+{
+	float time; //!< Seconds from the beginning of the path
+	glm::vec3 position;
+	float yaw; //!< Degrees, same convention as Camera::Yaw
+	float pitch; //!< Degrees, same convention as Camera::Pitch
+	float zoom; //!< Vertical field of view in degrees, same as Camera::Zoom
+};
+
+/**
+  Camera path given by keyframes, interpolated by a Catmull-Rom spline (passes through all keyframes).
+  Path is either recorded from a live session or written by hand as a text file with one keyframe per line:
+  "time x y z yaw pitch zoom", lines starting with '#' are comments.
+*/
+class CameraPath
+{
+public:
+	/** \brief Adds keyframe, keyframes have to be added in increasing time order. */
+	void addKeyframe(const CameraKeyframe& keyframe);
+
+	/** \brief Removes all keyframes. */
+	void clear();
+
+	/** \brief Loads keyframes from a text file (replaces current keyframes).
+	*   \return True if the file has been read and has at least one keyframe or false otherwise.
+	*/
+	bool loadFromFile(const std::string& path);
+
+	/** \brief Saves keyframes to a text file, that loadFromFile reads.
+	*   \return True if the file has been written or false otherwise.
+	*/
+	bool saveToFile(const std::string& path) const;
+
+	/** \brief Gets interpolated camera state. Time is wrapped around the path duration, so the path loops.
+	*   \param time Seconds from the beginning of the path
+	*/
+	CameraKeyframe sample(float time) const;
+
+	/** \brief Gets time of the last keyframe. */
+	float getDuration() const;
+
+	size_t getNumKeyframes() const;
+
+private:
+	std::vector<CameraKeyframe> _keyframes;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Project
+#include "bounds.h"
+
+/**
+  Tests world-space bounds of many objects against the view frustum. Bounds are kept as structure of arrays
+  (box centers and extents, sphere centers and radii), so that they are tested in batches of 8 objects:
+  one AVX instruction per batch, or two SSE instructions when AVX is not enabled at compile time.
+  An object is culled when its box or its sphere lies completely behind one of the frustum planes.
+*/
+class FrustumCuller
+{
+public:
+	static const int BATCH_SIZE = 8; //!< Objects tested together, arrays are padded to a multiple of it
+
+	/** \brief Sets number of objects. Bounds of added objects are empty boxes at the origin. */
+	void setNumObjects(size_t numObjects);
+
+	size_t getNumObjects() const;
+
+	/** \brief Sets world-space bounds of the object. */
+	void setBounds(uint32_t index, const Bounds& worldBounds);
+
+	/** \brief Extracts frustum planes from projection * view matrix (Gribb-Hartmann), normalized. */
+	void setFrustum(const glm::mat4& viewProjection);
+
+	/** \brief Gets the 6 planes of the last setFrustum, xyz = inward normal, w = distance. */
+	const glm::vec4* getPlanes() const;
+
+	/** \brief Tests all objects against the frustum.
+	*   \return Indices of visible objects in increasing order, valid until the next cull.
+	*/
+	const std::vector<uint32_t>& cull();
+
+	/** \brief Tests range of objects against the frustum, without touching the result of cull, so that ranges can be tested by different threads.
+	*   \param firstObject    First tested object, ranges starting at a multiple of BATCH_SIZE waste no SIMD lanes
+	*   \param visibleObjects Indices of visible objects are appended to it in increasing order
+	*/
+	void cullRange(size_t firstObject, size_t numObjects, std::vector<uint32_t>& visibleObjects) const;
+
+	/** \brief Gets world-space bounding sphere of the object, xyz = center, w = radius. */
+	glm::vec4 getSphere(uint32_t index) const;
+
+	/** \brief Tests one object without SIMD, same result as cull. */
+	bool isVisible(uint32_t index) const;
+
+private:
+	size_t _numObjects = 0;
+	glm::vec4 _planes[6]; //! xyz = inward normal, w = distance, a point p is inside if dot(xyz, p) + w >= 0
+
+	// Bounds, one array per component
+	std::vector<float> _boxCenterX;
+	std::vector<float> _boxCenterY;
+	std::vector<float> _boxCenterZ;
+	std::vector<float> _boxExtentX;
+	std::vector<float> _boxExtentY;
+	std::vector<float> _boxExtentZ;
+	std::vector<float> _sphereCenterX;
+	std::vector<float> _sphereCenterY;
+	std::vector<float> _sphereCenterZ;
+	std::vector<float> _sphereRadius;
+
+	std::vector<uint32_t> _visibleObjects; //! Result of the last cull
+};
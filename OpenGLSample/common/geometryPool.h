@@ -0,0 +1,87 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/**
+  Vertex of the geometry pool, as it is stored in the shared vertex buffer.
+*/
+struct PoolVertex
+{
+	glm::vec3 position;
+	glm::vec2 textureCoordinate;
+	glm::vec3 normal;
+};
+
+/**
+  Mesh of the geometry pool: range of the shared index buffer, indices are relative to the base vertex.
+  Fields map directly onto DrawElementsIndirectCommand.
+*/
+struct PoolMesh
+{
+	GLuint firstIndex = 0;
+	GLuint numIndices = 0;
+	GLint baseVertex = 0;
+};
+
+/**
+  Static geometry of many meshes in one vertex buffer and one index buffer (32-bit triangle lists) behind one VAO,
+  so that all of them can be drawn by a single multi-draw call. Meshes are copied from the VAOs they have been created with:
+  their vertices are read back from the GPU, strips and fans are converted to triangle lists.
+*/
+class GeometryPool
+{
+public:
+	static const GLuint POSITION_ATTRIBUTE_INDEX = 0;
+	static const GLuint TEXTURE_COORDINATE_ATTRIBUTE_INDEX = 1;
+	static const GLuint NORMAL_ATTRIBUTE_INDEX = 2;
+
+	/** \brief Starts a new mesh, draws added next are appended to it. */
+	void beginMesh();
+
+	/** \brief Appends one draw of an existing VAO to the current mesh. Float attributes 0 (position), 1 (texture coordinate)
+	*          and 2 (normal) are read back from the buffers of the VAO, disabled ones take their current generic value.
+	*   \param mode            GL_TRIANGLES, GL_TRIANGLE_STRIP or GL_TRIANGLE_FAN
+	*   \param first           First vertex, for non-indexed draws
+	*   \param count           Number of vertices or indices
+	*   \param indexType       Index type for indexed draws, 0 for glDrawArrays
+	*   \param indexByteOffset Byte offset of first index in the element buffer of the VAO
+	*   \return True if the draw has been added or false otherwise.
+	*/
+	bool addDraw(GLuint vao, GLenum mode, GLint first, GLsizei count, GLenum indexType, uintptr_t indexByteOffset);
+
+	/** \brief Closes the current mesh.
+	*   \return Index of the mesh.
+	*/
+	uint32_t endMesh();
+
+	/** \brief Uploads all meshes into the shared buffers and sets up the VAO. In-memory copies are freed, no more meshes can be added. */
+	void createPool();
+
+	size_t getNumMeshes() const;
+	const PoolMesh& getMesh(uint32_t index) const;
+
+	/** \brief Gets VAO with the shared buffers, attributes 0 to 2 and the element buffer are set. */
+	GLuint getVAO() const;
+
+	/** \brief Deletes VAO and buffers of the pool and all its meshes. */
+	void deletePool();
+
+private:
+	//! Reads float attribute of vertices [firstVertex, firstVertex + numVertices) of the bound VAO, as vec4 (missing components as in OpenGL)
+	bool readAttribute(GLuint attributeIndex, GLuint firstVertex, GLuint numVertices, std::vector<glm::vec4>& values);
+
+	GLuint _vao = 0;
+	GLuint _vertexBufferID = 0;
+	GLuint _indexBufferID = 0;
+	bool _isPoolCreated = false;
+
+	std::vector<PoolMesh> _meshes;
+	std::vector<PoolVertex> _vertices; //! In-memory geometry, until the pool is created
+	std::vector<GLuint> _indices;
+	std::vector<uint8_t> _bufferData; //! Read back content of a VAO buffer
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Project
+#include "bounds.h"
+
+//! One draw call of a shared geometry
+struct GeometryDraw
+{
+	GLenum mode;
+	GLint first; //!< First vertex, or first index of indexed geometry
+	GLsizei count;
+};
+
+/**
+  Vertex (and index) buffers of a primitive, shared by all meshes of the same shape. Buffers belong to the owner,
+  which is deleted when the last handle goes away, so all handles must be released while the OpenGL context still exists.
+*/
+struct SharedGeometry
+{
+	GLuint vao = 0;
+	GLenum indexType = 0; //!< 0 for non-indexed geometry
+	uintptr_t indexByteOffset = 0; //!< Offset of the indices in the element buffer bound to the VAO
+	std::vector<GeometryDraw> draws; //!< Draws of the whole geometry, ranges of its vertices or indices
+	Bounds bounds; //!< Local space bounds of the (unit-size) geometry
+	std::shared_ptr<void> owner; //!< Mesh object creating the buffers and deleting them in its destructor
+};
+
+//! Shared, reference-counted handle to a registered geometry
+typedef std::shared_ptr<const SharedGeometry> GeometryHandle;
+
+//! Shape of a registered geometry: everything, that cannot be applied by scaling the unit-size primitive
+struct GeometryKey
+{
+	uint32_t primitive = 0; //!< Primitive type, as enumerated by the caller
+	int tessellation[2] = {}; //!< Slices, stacks or segments around both circles, 0 where unused
+	float shape = 0.0f; //!< Proportion scaling cannot change, e.g. tube to ring radius ratio of a torus
+	uint32_t attributes = 0; //!< Mask of the vertex attributes, primitives with and without them differ
+
+	bool operator==(const GeometryKey& other) const;
+};
+
+/**
+  Geometry of parametric primitives, keyed by primitive type and parameters, so that every shape is tessellated
+  and uploaded only once, however many meshes use it. Sizes are not part of the key: primitives are created
+  at unit size and scaled by the model matrix. Registry keeps only weak references, like TextureCache,
+  geometry lives as long as someone holds its handle.
+*/
+class GeometryRegistry
+{
+public:
+	//! Creates geometry of the key, fills vao, draws, bounds and owner, returns false on failure
+	typedef std::function<bool(SharedGeometry& geometry)> Factory;
+
+	/** \brief Gets geometry of given shape, creates it only if it is not registered yet.
+	*   \param createGeometry Called when there is no geometry of the key alive
+	*   \return Handle to the geometry, or empty handle, if it could not be created.
+	*/
+	GeometryHandle acquire(const GeometryKey& key, const Factory& createGeometry);
+
+	/** \brief Removes entries of geometries, that are not referenced anymore. */
+	void collectGarbage();
+
+	/** \brief Gets number of geometries, that are currently alive. */
+	size_t getNumGeometries() const;
+
+	/** \brief Gets number of geometries created so far. */
+	size_t getNumCreations() const;
+
+	/** \brief Gets number of acquires served by an already existing geometry. */
+	size_t getNumHits() const;
+
+private:
+	//! FNV-1a over the key fields
+	struct KeyHash
+	{
+		size_t operator()(const GeometryKey& key) const;
+	};
+
+	std::unordered_map<GeometryKey, std::weak_ptr<const SharedGeometry>, KeyHash> _geometries;
+
+	size_t _numCreations = 0;
+	size_t _numHits = 0;
+};
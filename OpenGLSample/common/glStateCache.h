@@ -0,0 +1,113 @@
+#pragma once
+
+// STL
+#include <cstddef>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+/**
+  Counters of the state cache.
+*/
+struct GLStateCacheStats
+{
+	size_t numBinds = 0; //!< Program, VAO, buffer, texture and active texture unit binds forwarded to OpenGL
+	size_t numSkippedBinds = 0; //!< Binds skipped, because the object was already bound
+	size_t numStateChanges = 0; //!< Enables, disables, blend and depth state changes forwarded to OpenGL
+	size_t numSkippedStateChanges = 0; //!< State changes skipped, because OpenGL already had that state
+};
+
+/**
+  Shadows OpenGL state (program, VAO, buffers, texture units, enables, blend and depth state) and forwards
+  a state change to OpenGL only when it really changes something. State set by calling OpenGL directly
+  is not seen by the cache, so such code has to call invalidate afterwards (mesh creation, for instance).
+  Deleted objects have to be reported through forget* methods, because OpenGL reuses their names.
+*/
+class GLStateCache
+{
+public:
+	static const int MAX_TEXTURE_UNITS = 32; //!< Number of shadowed texture units
+
+	/** \brief Gets cache of the current OpenGL context. */
+	static GLStateCache& getInstance();
+
+	/** \brief Same as glUseProgram. */
+	void useProgram(GLuint programID);
+
+	/** \brief Same as glBindVertexArray. */
+	void bindVertexArray(GLuint vao);
+
+	/** \brief Same as glBindBuffer. GL_ELEMENT_ARRAY_BUFFER is part of VAO state, so it is always forwarded. */
+	void bindBuffer(GLenum target, GLuint bufferID);
+
+	/** \brief Same as glActiveTexture.
+	*   \param unit Texture unit (GL_TEXTURE0 + i)
+	*/
+	void activeTexture(GLenum unit);
+
+	/** \brief Same as glBindTexture, binds to the active texture unit. */
+	void bindTexture(GLenum target, GLuint textureID);
+
+	/** \brief Binds texture to given texture unit (activates the unit only if the texture is not bound already).
+	*   \param unit Zero-based texture unit index
+	*/
+	void bindTextureToUnit(GLuint unit, GLenum target, GLuint textureID);
+
+	/** \brief Same as glEnable. */
+	void enable(GLenum capability);
+
+	/** \brief Same as glDisable. */
+	void disable(GLenum capability);
+
+	/** \brief Same as glBlendFunc. */
+	void blendFunc(GLenum sourceFactor, GLenum destinationFactor);
+
+	/** \brief Same as glDepthFunc. */
+	void depthFunc(GLenum function);
+
+	/** \brief Same as glDepthMask. */
+	void depthMask(GLboolean flag);
+
+	/** \brief Forgets all shadowed state, next state change of every kind is forwarded to OpenGL. */
+	void invalidate();
+
+	/** \brief Forgets bindings of deleted objects. */
+	void forgetProgram(GLuint programID);
+	void forgetVertexArray(GLuint vao);
+	void forgetBuffer(GLuint bufferID);
+	void forgetTexture(GLuint textureID);
+
+	/** \brief Gets counters since the last resetStats call. */
+	const GLStateCacheStats& getStats() const;
+
+	/** \brief Resets counters (e.g. at the beginning of a frame). */
+	void resetStats();
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFF; //! Value of state, that has not been shadowed yet
+	static const int NUM_BUFFER_TARGETS = 9; //! Number of shadowed buffer targets
+
+	struct TextureBinding
+	{
+		GLenum target;
+		GLuint textureID;
+	};
+
+	GLStateCache();
+
+	GLuint _programID;
+	GLuint _vao;
+	GLuint _buffers[NUM_BUFFER_TARGETS];
+	GLenum _activeTextureUnit;
+	TextureBinding _textures[MAX_TEXTURE_UNITS];
+	std::unordered_map<GLenum, bool> _capabilities; //! Known enabled / disabled capabilities
+	GLenum _blendSourceFactor;
+	GLenum _blendDestinationFactor;
+	GLenum _depthFunction;
+	GLuint _depthMask;
+
+	GLStateCacheStats _stats;
+
+	static int getBufferTargetIndex(GLenum target);
+	void setCapability(GLenum capability, bool enabled);
+};
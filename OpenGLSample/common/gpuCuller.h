@@ -0,0 +1,133 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Project
+#include "bounds.h"
+#include "geometryPool.h"
+
+/**
+  Indirect draw command, as glMultiDrawElementsIndirect reads it from the draw indirect buffer.
+*/
+struct DrawElementsIndirectCommand
+{
+	GLuint count; //!< Number of indices
+	GLuint instanceCount; //!< Written by the culling shader
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance; //!< First object ID of the command, offsets instanced attributes
+};
+
+/**
+  Object as the culling shader and GPU-driven vertex shaders see it, mirrors std430 layout of GPU_OBJECT_BUFFER_GLSL.
+*/
+struct GpuObjectData
+{
+	glm::mat4 model; //!< World matrix
+	glm::vec4 boxCenter; //!< xyz = center of the world box
+	glm::vec4 boxExtent; //!< xyz = half size of the world box
+	glm::vec4 sphere; //!< xyz = center of the world sphere, w = radius
+	GLuint command; //!< Indirect command drawing the object, GpuCuller::NO_COMMAND if it is not drawn
+	GLint materialIndex; //!< Index into materials array of MaterialBlock
+	GLint textureLayer; //!< Layer of the diffuse texture, when it is a texture array
+	GLuint padding;
+};
+
+// GLSL declaration of the object buffer, to be pasted into shader sources (#version 430) right after #version.
+// Drawn object is objects[objectId], objectId comes from instanced attribute GpuCuller::OBJECT_ID_ATTRIBUTE_INDEX.
+#define GPU_OBJECT_BUFFER_GLSL \
+"struct GpuObject {\n" \
+"    mat4 model;\n" \
+"    vec4 boxCenter;\n" \
+"    vec4 boxExtent;\n" \
+"    vec4 sphere;\n" \
+"    uint command;\n" \
+"    int materialIndex;\n" \
+"    int textureLayer;\n" \
+"};\n" \
+"layout (std430, binding = 0) readonly buffer GpuObjectBuffer {\n" \
+"    GpuObject objects[];\n" \
+"};\n"
+
+/**
+  Frustum culling of objects in a compute shader, which writes instance counts of indirect draw commands
+  and IDs of the visible objects. The commands then draw all visible objects with one glMultiDrawElementsIndirect call
+  per texture, without any per-object work on the CPU. Every command draws one geometry pool mesh and owns a range
+  of the object ID buffer large enough for all objects assigned to it. Object IDs are an instanced vertex attribute,
+  so that the base instance of the command selects its range (no gl_BaseInstance in OpenGL 4.3).
+  Needs OpenGL 4.3 (compute shaders, shader storage buffers and multi-draw-indirect).
+*/
+class GpuCuller
+{
+public:
+	static const GLuint OBJECT_BUFFER_BINDING = 0; //!< Shader storage binding of GpuObjectBuffer, as in GPU_OBJECT_BUFFER_GLSL
+	static const GLuint COMMAND_BUFFER_BINDING = 1; //!< Shader storage binding of the indirect commands, written by the culling shader
+	static const GLuint OBJECT_ID_BUFFER_BINDING = 2; //!< Shader storage binding of the object IDs, written by the culling shader
+	static const GLuint OBJECT_ID_ATTRIBUTE_INDEX = 3; //!< Instanced vertex attribute with ID of the drawn object
+	static const GLuint WORK_GROUP_SIZE = 64; //!< Objects tested by one work group of the culling shader
+	static const GLuint NO_COMMAND = 0xFFFFFFFF;
+
+	/** \brief Checks, that the current context is OpenGL 4.3 or newer. */
+	static bool isSupported();
+
+	/** \brief Adds indirect command drawing a pool mesh, can be called only before createCuller.
+	*   \param maxInstances Number of objects, that will be assigned to the command
+	*   \return Index of the command.
+	*/
+	GLuint addCommand(const PoolMesh& mesh, GLuint maxInstances);
+
+	/** \brief Sets number of objects, object indices are then 0 to numObjects - 1. Added objects are not drawn by any command. */
+	void setNumObjects(size_t numObjects);
+
+	/** \brief Assigns the object to a command, which draws it whenever it is visible. */
+	void setObjectCommand(uint32_t index, GLuint command, GLint materialIndex, GLint textureLayer = 0);
+
+	/** \brief Sets world matrix and world bounds of the object, they are uploaded by the next cull. */
+	void setObjectTransform(uint32_t index, const glm::mat4& model, const Bounds& worldBounds);
+
+	/** \brief Compiles the culling shader and creates the buffers, using commands and objects added so far.
+	*   \param vao VAO drawn by the commands (geometry pool), its attribute OBJECT_ID_ATTRIBUTE_INDEX is pointed to the object IDs
+	*   \return True if the culler has been created or false otherwise.
+	*/
+	bool createCuller(GLuint vao);
+
+	/** \brief Uploads objects changed since the last cull, clears instance counts and dispatches the culling shader.
+	*          Draws issued afterwards read the commands and object IDs of this cull.
+	*   \param planes 6 frustum planes, xyz = inward normal, w = distance (see FrustumCuller::getPlanes)
+	*/
+	void cull(const glm::vec4* planes);
+
+	/** \brief Gets buffer with the commands, to be bound as GL_DRAW_INDIRECT_BUFFER. */
+	GLuint getCommandBufferID() const;
+
+	size_t getNumCommands() const;
+	bool isCreated() const;
+
+	/** \brief Deletes the shader, buffers, commands and objects. */
+	void deleteCuller();
+
+private:
+	GLuint _programID = 0;
+	GLint _planesLocation = -1;
+	GLint _numObjectsLocation = -1;
+
+	GLuint _objectBufferID = 0;
+	GLuint _commandBufferID = 0;
+	GLuint _commandTemplateBufferID = 0; //! Commands with zero instance counts, copied over the commands before every cull
+	GLuint _objectIdBufferID = 0;
+	bool _isCullerCreated = false;
+
+	std::vector<DrawElementsIndirectCommand> _commands;
+	GLuint _numObjectIds = 0; //! Object ID slots of all commands
+	std::vector<GpuObjectData> _objects; //! In-memory copy of objects
+
+	size_t _dirtyBegin = 0; //! Range of objects, whose in-memory data differ from GPU data (empty if equal)
+	size_t _dirtyEnd = 0;
+
+	void markDirty(size_t index);
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+  Rolling statistics of one GPU zone, over the last WINDOW_SIZE frames. Durations of all occurrences
+  of the zone within a frame are summed.
+*/
+struct GPUZoneSummary
+{
+	const char* name;
+	size_t numFrames; //!< Frames, in which the zone has been measured
+	double averageMilliseconds;
+	double p50Milliseconds;
+	double p95Milliseconds;
+	double maxMilliseconds;
+};
+
+/**
+  Measures GPU time of nested zones with GL_TIMESTAMP queries (glQueryCounter). Every frame uses its own set
+  of queries from a pool of NUM_FRAMES sets and its results are read only once the GPU has made them available,
+  so the CPU never waits for the GPU. A frame whose queries are still pending when its set is needed again
+  is dropped. Timestamps are converted to the CPU profiler clock, so that GPU zones appear in the same
+  Chrome trace as CPU zones (on their own "GPU" track).
+*/
+class GPUProfiler
+{
+public:
+	static const int NUM_FRAMES = 4; //!< Frames in flight before their query set is reused
+	static const int MAX_QUERIES_PER_FRAME = 256; //!< Two queries per zone, zones over the limit are not measured
+	static const size_t WINDOW_SIZE = 256; //!< How many last frames the statistics are computed from
+
+	/** \brief Creates query pool (needs current OpenGL context).
+	*   \return True if the driver supports timestamp queries or false otherwise (profiler then does nothing).
+	*/
+	bool createGPUProfiler();
+
+	/** \brief Reads results of finished frames and starts measuring a new frame. */
+	void beginFrame();
+
+	/** \brief Ends measuring of current frame. All zones have to be closed. */
+	void endFrame();
+
+	/** \brief Starts a zone, zones can be nested.
+	*   \param name Zone name, must be a string literal (only the pointer is stored)
+	*/
+	void beginZone(const char* name);
+
+	/** \brief Ends the last started zone. */
+	void endZone();
+
+	/** \brief Gets rolling statistics of all zones measured so far, sorted by name. */
+	std::vector<GPUZoneSummary> getSummary() const;
+
+	/** \brief Prints rolling statistics as a table. */
+	void printSummary(std::ostream& stream) const;
+
+	/** \brief Gets number of frames, whose results were not available in time and have been dropped. */
+	size_t getNumDroppedFrames() const;
+
+	/** \brief Deletes all queries. */
+	void deleteGPUProfiler();
+
+private:
+	struct Zone
+	{
+		const char* name;
+		int beginQuery; //! Query index of the start timestamp in the frame set
+		int endQuery; //! Query index of the end timestamp, -1 while the zone is open
+		uint32_t depth;
+	};
+
+	struct FrameQueries
+	{
+		GLuint queries[MAX_QUERIES_PER_FRAME];
+		int numUsedQueries = 0;
+		std::vector<Zone> zones;
+		bool isPending = false; //! Issued, but results have not been read yet
+	};
+
+	struct NameLess
+	{
+		bool operator()(const char* a, const char* b) const;
+	};
+
+	struct ZoneWindow
+	{
+		std::vector<int64_t> durations; //! Ring of last WINDOW_SIZE per-frame durations, in nanoseconds
+		size_t numFrames = 0;
+	};
+
+	bool _isCreated = false;
+	FrameQueries _frames[NUM_FRAMES];
+	int _currentFrame = -1; //! Index of the set used by current (or last) frame, -1 before first frame
+	std::vector<int> _openZones; //! Indices of open zones of current frame
+
+	int64_t _gpuToCPUOffset = 0; //! Added to a GPU timestamp to get CPU profiler time, in nanoseconds
+	std::map<const char*, ZoneWindow, NameLess> _zones;
+	size_t _numDroppedFrames = 0;
+
+	void calibrate();
+	bool readFrame(FrameQueries& frame);
+	int issueTimestamp();
+};
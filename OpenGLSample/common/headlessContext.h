@@ -0,0 +1,30 @@
+#pragma once
+
+/**
+  OpenGL context without any window or display, created through EGL on Mesa's surfaceless platform
+  (EGL_MESA_platform_surfaceless). Works on machines with no display server and no GPU, where Mesa
+  falls back to llvmpipe. There is no default framebuffer, so everything has to be rendered into an FBO.
+
+  EGL is available only when the project is built with HEADLESS_EGL defined (and linked with libEGL),
+  as the Linux build in CMakeLists.txt does, otherwise createContext always fails.
+*/
+class HeadlessContext
+{
+public:
+	/** \brief Creates core profile context and makes it current on the calling thread.
+	*   \param majorVersion Requested OpenGL major version
+	*   \param minorVersion Requested OpenGL minor version
+	*   \return True if the context has been created or false otherwise.
+	*/
+	bool createContext(int majorVersion, int minorVersion);
+
+	/** \brief Gets address of an OpenGL function, to be passed to gladLoadGLLoader. */
+	static void* getProcAddress(const char* name);
+
+	/** \brief Releases and destroys the context. */
+	void deleteContext();
+
+private:
+	void* _display = nullptr; //! EGLDisplay
+	void* _context = nullptr; //! EGLContext
+};
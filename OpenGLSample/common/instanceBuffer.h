@@ -0,0 +1,124 @@
+#pragma once
+
+// STL
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Project
+#include "vertexBufferObject.h"
+
+/**
+  Per-instance attributes, as they are stored in the instance buffer.
+*/
+struct InstanceData
+{
+	glm::mat4 model; //!< Model matrix of the instance
+	GLint materialIndex; //!< Index into materials array of MaterialBlock
+	GLint textureLayer; //!< Layer of the diffuse texture, when it is a texture array
+	GLint padding[2];
+};
+
+/**
+  Contiguous range of instances, drawn by one instanced draw call.
+*/
+struct InstanceRange
+{
+	GLuint firstInstance = 0;
+	GLsizei numInstances = 0;
+};
+
+/**
+  Buffer with per-instance attributes (model matrix, material index and texture layer), read by instanced draws
+  with attribute divisor 1. Instances of one primitive are expected to be added one after another,
+  so that they form a contiguous range drawn by a single glDrawArraysInstanced call.
+  GPU copy lives in a streaming ring buffer (see VertexBufferObject::createStreamingVBO): every upload writes all instances
+  into the next region, so the driver neither re-allocates storage nor waits for draws still reading the previous upload.
+*/
+class InstanceBuffer
+{
+public:
+	static const int MODEL_ATTRIBUTE_INDEX; //!< First vertex attribute index of instance model matrix (3, occupies 3..6)
+	static const int MATERIAL_ATTRIBUTE_INDEX; //!< Vertex attribute index of instance material index (7)
+	static const int TEXTURE_LAYER_ATTRIBUTE_INDEX; //!< Vertex attribute index of instance texture layer (8)
+
+	static const int NUM_STREAMING_REGIONS = 3; //!< Uploads the GPU may still be reading, when the next one is written
+
+	/** \brief Creates a new instance buffer, with optional reserved number of instances.
+	*   \param reserveInstances Number of instances to reserve memory for, in memory and in every ring region
+	*/
+	void createInstanceBuffer(size_t reserveInstances = 0);
+
+	/** \brief Adds instance to the in-memory buffer.
+	*   \param model         Model matrix of the instance
+	*   \param materialIndex Index of instance material in MaterialBlock
+	*   \param textureLayer  Layer of instance diffuse texture, if it is a texture array
+	*   \return Index of the added instance.
+	*/
+	GLuint addInstance(const glm::mat4& model, GLint materialIndex = 0, GLint textureLayer = 0);
+
+	/** \brief Starts a range of instances, that will be added next. */
+	InstanceRange beginRange() const;
+
+	/** \brief Closes the range, so that it contains all instances added since beginRange. */
+	void endRange(InstanceRange& range) const;
+
+	/** \brief Adds instances, that are filled later by fillInstance (possibly from several threads).
+	*          The whole range is marked dirty at once.
+	*   \param numInstances Number of added instances
+	*   \return Range of the added instances.
+	*/
+	InstanceRange addInstances(GLsizei numInstances);
+
+	/** \brief Writes instance added by addInstances. Does not touch the dirty range, so that different threads may fill different instances. */
+	void fillInstance(GLuint index, const glm::mat4& model, GLint materialIndex, GLint textureLayer = 0);
+
+	/** \brief Overwrites already added instance, marks buffer dirty. */
+	void setInstance(GLuint index, const glm::mat4& model, GLint materialIndex, GLint textureLayer = 0);
+
+	/** \brief Removes all instances (buffer keeps its GPU memory). */
+	void clear();
+
+	/** \brief Gets instance at given index. */
+	const InstanceData& getInstance(GLuint index) const;
+
+	/** \brief Gets number of instances added so far. */
+	GLuint getNumInstances() const;
+
+	/** \brief Uploads in-memory instances to the GPU, if they have been changed since last upload.
+	*          All instances are written into the next region of the ring, which grows with the number of instances.
+	*   \return True if the upload took place or false otherwise.
+	*/
+	bool uploadIfDirty();
+
+	/** \brief Points instance attributes of currently bound VAO to this buffer, starting at given instance.
+	*          OpenGL 3.3 has no base instance for draw calls, so sub-ranges are drawn by offsetting the pointers.
+	*   \param firstInstance Index of the instance, that will be instance 0 of the next draw
+	*/
+	void setInstanceAttributesPointers(GLuint firstInstance) const;
+
+	/** \brief Gets OpenGL-assigned buffer ID.
+	*   \return Buffer ID.
+	*/
+	GLuint getBufferID() const;
+
+	/** \brief Gets how many uploads had to wait for the GPU to finish reading the ring region. */
+	size_t getNumStreamingWaits() const;
+
+	/** \brief Deletes instance buffer and frees memory and internal structures. */
+	void deleteInstanceBuffer();
+
+private:
+	VertexBufferObject _ringBuffer; //! Streaming ring, every region holds all instances of one upload
+	size_t _regionCapacity = 0; //! Number of instances one ring region can hold
+	size_t _uploadedOffset = 0; //! Byte offset of the last uploaded instances in the ring
+
+	std::vector<InstanceData> _instances; //! In-memory copy of instances
+
+	bool _isBufferCreated = false;
+	size_t _dirtyBegin = 0; //! Range of instances changed since the last upload (empty if there was no change)
+	size_t _dirtyEnd = 0;
+
+	void markDirty(size_t index);
+};
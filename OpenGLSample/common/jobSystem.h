@@ -0,0 +1,75 @@
+#pragma once
+
+// STL
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  Pool of worker threads running the CPU part of the frame (culling, instance and draw packet recording)
+  and tessellation of large meshes at load time.
+  Work is split into jobs identified by their index, the calling thread runs jobs too, so that one thread
+  means no workers at all. Jobs must not call OpenGL, the context stays current on the calling thread only.
+*/
+class JobSystem
+{
+public:
+	static const size_t MIN_BAND_ITEMS = 16384; //!< Items (e.g. vertices) of the smallest band, smaller bands cost more to schedule than to compute
+	static const uint32_t BANDS_PER_THREAD = 4; //!< Bands of one run per thread, so that threads finishing early take more of them
+
+	/** \brief Gets the job system of the application. */
+	static JobSystem& getInstance();
+
+	/** \brief Starts worker threads.
+	*   \param numThreads Threads running jobs including the calling one, 0 for one per hardware thread
+	*/
+	void start(uint32_t numThreads = 0);
+
+	/** \brief Stops and joins worker threads, jobs then run on the calling thread only. */
+	void stop();
+
+	/** \brief Gets number of threads running jobs (workers and the calling thread). */
+	uint32_t getNumThreads() const;
+
+	/** \brief Runs job(jobIndex) for every index from 0 to numJobs - 1 and waits for all of them.
+	*          Jobs are taken in increasing order by whichever thread is free, so they must not depend on each other.
+	*/
+	void run(uint32_t numJobs, const std::function<void(uint32_t)>& job);
+
+	/** \brief Splits rows into bands of consecutive rows and runs job(firstRow, endRow) for every band, see run.
+	*          Small work is one band, run on the calling thread right away. Must not be called from a job.
+	*   \param itemsPerRow Items (e.g. vertices) of one row, bands get at least MIN_BAND_ITEMS of them
+	*/
+	void runBands(size_t numRows, size_t itemsPerRow, const std::function<void(size_t, size_t)>& job);
+
+	/** \brief Gets number of jobs needed for items split into chunks of itemsPerJob. */
+	static uint32_t getNumJobs(size_t numItems, size_t itemsPerJob);
+
+	~JobSystem();
+
+private:
+	JobSystem() = default;
+
+	//! Loop of a worker thread: waits for next run, takes its jobs until there are none left
+	void workerLoop();
+
+	//! Takes and runs jobs of the current run until all have been taken
+	void runJobs(const std::function<void(uint32_t)>& job, uint32_t numJobs);
+
+	std::vector<std::thread> _workers;
+
+	std::mutex _mutex; //! Guards fields below, except the atomic job counter
+	std::condition_variable _startCondition; //! Signals workers that a run started or that they should quit
+	std::condition_variable _finishCondition; //! Signals run that a worker left the run
+	const std::function<void(uint32_t)>* _job = nullptr; //! Job of the current run
+	uint32_t _numJobs = 0;
+	uint64_t _runIndex = 0; //! Incremented by every run, so that workers join each run only once
+	uint32_t _numActiveWorkers = 0; //! Workers which joined the current run and have not left it yet
+	bool _isStopping = false;
+
+	std::atomic<uint32_t> _nextJob{ 0 }; //! Next job to take
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Project
+#include "uniformBlocks.h"
+
+#define TEXELS_PER_LIGHT_VALUE 5 // LightClusters::TEXELS_PER_LIGHT, as a macro for LIGHT_CLUSTERS_GLSL
+
+/**
+  Clustered forward lighting: the view frustum is split into a grid of clusters (tiles of the viewport times
+  logarithmic slices of the view depth) and every cluster gets the list of lights reaching it, so that a fragment
+  shades only the lights of its cluster. A light reaches as far as its attenuation keeps it above the cutoff intensity.
+  Lights are assigned on the CPU, one job per depth slice, testing light spheres against boxes of 8 clusters at once:
+  one AVX instruction, two SSE instructions when AVX is not enabled at compile time.
+
+  Lists are read by the shaders from texture buffers (OpenGL 3.1), see LIGHT_CLUSTERS_GLSL:
+  cluster grid (first index and count of every cluster), light indices of all clusters, and the lights themselves.
+*/
+class LightClusters
+{
+public:
+	static const int CLUSTERS_X = 16; //!< Clusters along the viewport width
+	static const int CLUSTERS_Y = 12; //!< Clusters along the viewport height
+	static const int CLUSTERS_Z = 24; //!< Slices of the view depth, from the near to the far plane
+	static const int BATCH_SIZE = 8; //!< Clusters tested together, CLUSTERS_X * CLUSTERS_Y is a multiple of it
+	static const int TEXELS_PER_LIGHT = TEXELS_PER_LIGHT_VALUE; //!< RGBA texels of LightBlockData in the light texture buffer
+
+	/** \brief Creates the texture buffers.
+	*   \return True if the clusters have been created or false otherwise.
+	*/
+	bool createClusters();
+
+	/** \brief Sets world-space lights and uploads them.
+	*   \param cutoffIntensity Lights are ignored where their attenuated intensity drops below it
+	*/
+	void setLights(const std::vector<LightBlockData>& lights, float cutoffIntensity = 1.0f / 256.0f);
+
+	size_t getNumLights() const;
+
+	/** \brief Gets distance, where attenuated intensity of the light (brightest of its colors) drops to the cutoff. */
+	static float getLightRadius(const LightBlockData& light, float cutoffIntensity);
+
+	/** \brief Sets camera of the frame: moves lights to view space and rebuilds cluster boxes if the projection has changed.
+	*   \param projection Perspective or orthographic projection, without skew of x and y by the depth
+	*/
+	void setView(const glm::mat4& view, const glm::mat4& projection);
+
+	/** \brief Gets clusters along the viewport width, height and view depth (xyz) for the frame block. */
+	glm::vec4 getClusterCounts() const;
+
+	/** \brief Gets scale (x) and bias (y) of the depth slice of a fragment, log(view depth) * x + y, for the frame block. */
+	glm::vec4 getClusterDepth() const;
+
+	/** \brief Assigns lights to the clusters of one depth slice, slices can be assigned by different threads. */
+	void assignSlice(size_t slice);
+
+	/** \brief Joins lists of all slices and uploads them, if they differ from the last frame. */
+	void uploadClusters();
+
+	/** \brief Gets light indices of all clusters, after uploadClusters. */
+	size_t getNumLightIndices() const;
+
+	/** \brief Binds the texture buffers to texture units, they can stay bound, as the buffers are only re-filled. */
+	void bindTextures(GLuint gridUnit, GLuint indexUnit, GLuint lightUnit) const;
+
+	/** \brief Deletes the texture buffers, lights and lists. */
+	void deleteClusters();
+
+private:
+	//! Texture buffer: buffer object and the texture viewing it
+	struct TextureBuffer
+	{
+		GLuint bufferID = 0;
+		GLuint textureID = 0;
+	};
+
+	TextureBuffer _grid; //! RG32UI, first index and count of every cluster
+	TextureBuffer _indices; //! R32UI, light indices of all clusters
+	TextureBuffer _lights; //! RGBA32F, TEXELS_PER_LIGHT per light
+	bool _areClustersCreated = false;
+
+	std::vector<glm::vec4> _lightSpheres; //! World-space center and radius of every light
+
+	// View-space light spheres, one array per component
+	std::vector<float> _lightCenterX;
+	std::vector<float> _lightCenterY;
+	std::vector<float> _lightCenterZ;
+	std::vector<float> _lightRadius;
+
+	// View-space cluster boxes, one array per component, slice after slice
+	std::vector<float> _clusterMinX;
+	std::vector<float> _clusterMinY;
+	std::vector<float> _clusterMinZ;
+	std::vector<float> _clusterMaxX;
+	std::vector<float> _clusterMaxY;
+	std::vector<float> _clusterMaxZ;
+	float _sliceDepths[CLUSTERS_Z + 1] = {}; //! View depth of the slice boundaries
+	float _depthScale = 0.0f; //! Slice of view depth d is log(d) * _depthScale + _depthBias
+	float _depthBias = 0.0f;
+	glm::mat4 _projection = glm::mat4(0.0f); //! Projection the cluster boxes have been built for
+
+	std::vector<std::vector<uint32_t>> _clusterLights; //! Lights of every cluster, written by the slice jobs
+	std::vector<GLuint> _gridData; //! Uploaded grid and indices, to skip uploads of unchanged lists
+	std::vector<GLuint> _indexData;
+
+	void buildClusterBoxes(const glm::mat4& projection);
+	static void fillTextureBuffer(const TextureBuffer& textureBuffer, const void* data, size_t numBytes);
+};
+
+// GLSL access to the clusters, to be pasted after FRAME_BLOCK_GLSL, light i of a cluster is getClusterLight(cluster, i)
+#define LIGHT_CLUSTERS_GLSL \
+"uniform usamplerBuffer clusterGrid;\n" \
+"uniform usamplerBuffer clusterLightIndices;\n" \
+"uniform samplerBuffer clusterLightData;\n" \
+"struct LightSource {\n" \
+"    vec4 position;\n" \
+"    vec4 ambient;\n" \
+"    vec4 diffuse;\n" \
+"    vec4 specular;\n" \
+"    vec4 attenuation;\n" \
+"};\n" \
+"uvec2 getCluster(vec3 worldPosition) {\n" \
+"    vec4 viewPos = view * vec4(worldPosition, 1.0);\n" \
+"    vec4 clipPos = projection * viewPos;\n" \
+"    ivec3 counts = ivec3(clusterCounts.xyz);\n" \
+"    ivec2 tile = clamp(ivec2((clipPos.xy / clipPos.w * 0.5 + 0.5) * clusterCounts.xy), ivec2(0), counts.xy - 1);\n" \
+"    int slice = clamp(int(log(max(-viewPos.z, 1e-4)) * clusterDepth.x + clusterDepth.y), 0, counts.z - 1);\n" \
+"    return texelFetch(clusterGrid, (slice * counts.y + tile.y) * counts.x + tile.x).rg;\n" \
+"}\n" \
+"LightSource getClusterLight(uvec2 cluster, uint i) {\n" \
+"    int first = int(texelFetch(clusterLightIndices, int(cluster.x + i)).r) * " GLSL_VALUE(TEXELS_PER_LIGHT_VALUE) ";\n" \
+"    return LightSource(texelFetch(clusterLightData, first), texelFetch(clusterLightData, first + 1),\n" \
+"        texelFetch(clusterLightData, first + 2), texelFetch(clusterLightData, first + 3), texelFetch(clusterLightData, first + 4));\n" \
+"}\n"
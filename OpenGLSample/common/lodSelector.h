@@ -0,0 +1,54 @@
+#pragma once
+
+// STL
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+/**
+  Chooses level of detail of objects from screen-space error. Geometric error of a level (largest distance of its
+  surface from the exact shape) is projected to pixels at the nearest point of the object bounding sphere, the coarsest
+  level within the pixel error threshold is drawn. A coarser level is taken only once its error drops below
+  threshold * (1 - hysteresis), so that objects near a switching distance do not pop between two levels every frame.
+*/
+class LodSelector
+{
+public:
+	static const uint32_t MAX_LEVELS = 8; //!< Longest LOD chain
+
+	/** \brief Sets camera of the frame.
+	*   \param cameraPosition World position of the camera
+	*   \param projection     Perspective or orthographic projection matrix
+	*   \param viewportHeight Height of the viewport, in pixels
+	*/
+	void setView(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight);
+
+	/** \brief Sets allowed screen-space error, in pixels (0 keeps the finest level), and hysteresis of switching to coarser levels (0 to 1). */
+	void setPixelError(float threshold, float hysteresis = 0.25f);
+
+	float getPixelError() const;
+
+	/** \brief Projects world-space error at given bounding sphere to the screen.
+	*   \return Error in pixels.
+	*/
+	float getProjectedError(float worldError, const glm::vec3& sphereCenter, float sphereRadius) const;
+
+	/** \brief Chooses level of an object.
+	*   \param levelErrors  Geometric error of every level in local units, finest level first, non-decreasing
+	*   \param numLevels    Number of levels, at most MAX_LEVELS
+	*   \param errorScale   Scale of the object, from local to world units
+	*   \param sphereCenter Center of the world bounding sphere of the object
+	*   \param sphereRadius Radius of the world bounding sphere of the object
+	*   \param currentLevel Level the object has been drawn with so far
+	*   \return Level to draw the object with.
+	*/
+	uint32_t selectLevel(const float* levelErrors, uint32_t numLevels, float errorScale,
+		const glm::vec3& sphereCenter, float sphereRadius, uint32_t currentLevel) const;
+
+private:
+	glm::vec3 _cameraPosition = glm::vec3(0.0f);
+	float _pixelsPerUnit = 0.0f; //! Pixels covered by one world unit at distance 1 (perspective) or at any distance (orthographic)
+	bool _isPerspective = true;
+	float _threshold = 1.0f;
+	float _hysteresis = 0.25f;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+// STL
+#include <cstddef>
+#include <string>
+
+/**
+  Read-only memory mapping of a whole file. Pages are loaded by the OS on first access,
+  so opening even a large file costs next to nothing and its data are used in place.
+*/
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/** \brief Maps file to memory (closes previously mapped file).
+	*   \return True if the file has been mapped or false otherwise.
+	*/
+	bool openFile(const std::string& path);
+
+	/** \brief Gets pointer to the mapped data, nullptr if no file is mapped. */
+	const unsigned char* getData() const;
+
+	/** \brief Gets size of the mapped file, in bytes. */
+	size_t getSize() const;
+
+	/** \brief Unmaps the file. */
+	void closeFile();
+
+private:
+	const unsigned char* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	void* _fileHandle = nullptr; //! HANDLE of the file
+	void* _mappingHandle = nullptr; //! HANDLE of the file mapping
+#endif
+};
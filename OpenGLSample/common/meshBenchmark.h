@@ -0,0 +1,12 @@
+#pragma once
+
+// STL
+#include <ostream>
+
+/** \brief Checks, that all SinCos kernels the CPU supports agree bit for bit, then times generation of parametric meshes from 64 to 4096 segments around their circles and prints a table:
+*          sines and cosines of one circle by SinCos and by std::sin / std::cos, then creation of a cylinder,
+*          a sphere and a torus, uploads included, so an OpenGL context has to be current.
+*   \param stream Stream receiving the check results and the table
+*   \return False if some SinCos kernel differs from the scalar one.
+*/
+bool runMeshBenchmark(std::ostream& stream);
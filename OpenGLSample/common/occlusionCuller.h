@@ -0,0 +1,72 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+  Software occlusion culling: boxes of large occluders are rasterized into a low-resolution depth buffer on the CPU,
+  then boxes of objects are tested against it, before their draws are queued. The buffer keeps the nearest occluder
+  depth (NDC z) of every pixel and the farthest of these per tile, so that most tests are answered by the tiles only.
+  Rows of the buffer are split into bands rasterized by separate jobs, 8 pixels of a row at once: one AVX instruction,
+  two SSE instructions when AVX is not enabled at compile time.
+
+  Occluder boxes have to lie inside the geometry they stand for. Triangles crossing the near plane are dropped
+  and boxes crossing it are visible, so that the test errs on the visible side, except for pixels only partially
+  covered by an occluder, which are covered as a whole if their center is.
+*/
+class OcclusionCuller
+{
+public:
+	static const int TILE_WIDTH = 8; //!< Pixels of a tile row, rasterized at once, width of the buffer is a multiple of it
+	static const int TILE_HEIGHT = 4; //!< Rows of a tile, height of the buffer is a multiple of it
+	static const int BAND_HEIGHT = 32; //!< Rows rasterized by one job, multiple of TILE_HEIGHT
+
+	/** \brief Allocates depth buffer. The whole viewport is mapped onto it, whatever its aspect ratio.
+	*   \param width  Width in pixels, rounded up to a multiple of TILE_WIDTH
+	*   \param height Height in pixels, rounded up to a multiple of TILE_HEIGHT
+	*/
+	void createBuffer(int width, int height);
+
+	int getWidth() const;
+	int getHeight() const;
+
+	/** \brief Starts a frame: drops occluders of the last one. */
+	void beginFrame(const glm::mat4& viewProjection);
+
+	/** \brief Adds local-space box of an occluder, its triangles are projected to the screen right away. */
+	void addOccluderBox(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	size_t getNumOccluderTriangles() const;
+
+	/** \brief Gets number of bands, every one of them has to be rasterized before any test. */
+	size_t getNumBands() const;
+
+	/** \brief Clears band of rows and rasterizes the occluders into it, bands can be rasterized by different threads. */
+	void rasterizeBand(size_t band);
+
+	/** \brief Tests local-space box of an object against the rasterized occluders, from any thread.
+	*   \return False if the occluders hide the whole box, true if it may be visible.
+	*/
+	bool isVisible(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	/** \brief Frees the depth buffer. */
+	void deleteBuffer();
+
+private:
+	//! Occluder triangle in buffer pixels, counter-clockwise
+	struct ScreenTriangle
+	{
+		glm::vec3 vertices[3]; //! x, y in pixels, z = NDC depth
+		int minX, maxX, minY, maxY; //! Pixels whose centers may be covered, inclusive, within the buffer
+	};
+
+	glm::mat4 _viewProjection = glm::mat4(1.0f);
+	int _width = 0;
+	int _height = 0;
+	std::vector<ScreenTriangle> _triangles;
+	std::vector<float> _depth; //! Nearest occluder depth of every pixel, 1 where there is none
+	std::vector<float> _tileMaxDepth; //! Farthest depth of every tile
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+// STL
+#include <string>
+
+#include <glad/glad.h>
+
+/**
+  Framebuffer object with RGBA8 color and 24-bit depth / 8-bit stencil renderbuffers, used as the render
+  target when there is no window (headless mode). Also reads back color buffers into image files.
+*/
+class OffscreenFramebuffer
+{
+public:
+	/** \brief Creates framebuffer of given size.
+	*   \return True if the framebuffer is complete or false otherwise.
+	*/
+	bool createFramebuffer(GLsizei width, GLsizei height);
+
+	/** \brief Binds the framebuffer for both drawing and reading and sets viewport to its size. */
+	void bindFramebuffer() const;
+
+	GLsizei getWidth() const;
+	GLsizei getHeight() const;
+
+	/** \brief Deletes framebuffer and its renderbuffers. */
+	void deleteFramebuffer();
+
+	/** \brief Reads color buffer of the currently bound read framebuffer and writes it as binary PPM (P6, 8-bit RGB).
+	*          Waits for the GPU to finish rendering.
+	*   \param path   Path of the output file
+	*   \param width  Width of the read area, in pixels
+	*   \param height Height of the read area, in pixels
+	*   \return True if the file has been written or false otherwise.
+	*/
+	static bool writePPM(const std::string& path, GLsizei width, GLsizei height);
+
+private:
+	GLuint _framebufferID = 0;
+	GLuint _colorRenderbufferID = 0;
+	GLuint _depthRenderbufferID = 0;
+	GLsizei _width = 0;
+	GLsizei _height = 0;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+/**
+  Scoped CPU profiler. Zones are marked by PROFILE_SCOPE("name") / PROFILE_FUNCTION() and recorded into
+  per-thread buffers without locking. Once per frame PROFILE_END_FRAME() gathers them into rolling
+  per-zone statistics and a Chrome trace (chrome://tracing, https://ui.perfetto.dev).
+
+  Profiler is compiled in for debug builds (_DEBUG) or when ENABLE_PROFILER is defined, otherwise all the macros
+  expand to nothing and no profiler code or data is present in the binary.
+*/
+
+#ifndef PROFILER_ENABLED
+#if defined(_DEBUG) || defined(ENABLE_PROFILER)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+#endif
+
+#if PROFILER_ENABLED
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+  One finished zone.
+*/
+struct ProfilerEvent
+{
+	const char* name; //!< Zone name, must be a string literal (only the pointer is stored)
+	int64_t startNanoseconds; //!< Start time, relative to profiler creation
+	int64_t endNanoseconds; //!< End time, relative to profiler creation
+	uint32_t threadIndex; //!< Index of the recording thread (in order of their first zone)
+	uint32_t depth; //!< Nesting depth of the zone in its thread
+};
+
+/**
+  Rolling statistics of one zone, over the last WINDOW_SIZE occurrences.
+*/
+struct ProfilerZoneSummary
+{
+	const char* name;
+	size_t totalCount; //!< All occurrences since start
+	double averageMilliseconds;
+	double p50Milliseconds;
+	double p95Milliseconds;
+	double p99Milliseconds;
+	double maxMilliseconds;
+};
+
+/**
+  Buffer of events of one thread. Written only by its thread and read only by Profiler::endFrame,
+  the write index is the only shared variable (single producer, single consumer ring).
+*/
+struct ProfilerThreadBuffer
+{
+	static const size_t CAPACITY = 1 << 14; //!< Events, that can be recorded between two endFrame calls
+
+	ProfilerEvent events[CAPACITY];
+	std::atomic<uint64_t> writeIndex{ 0 }; //!< Number of events written so far
+	uint64_t readIndex = 0; //!< Number of events gathered so far (consumer side only)
+	uint32_t threadIndex = 0;
+	uint32_t depth = 0; //!< Current zone nesting (producer side only)
+};
+
+class Profiler
+{
+public:
+	static const size_t WINDOW_SIZE = 512; //!< How many last occurrences of each zone the percentiles are computed from
+	static const size_t MAX_TRACE_EVENTS = 1 << 20; //!< Trace stops growing after this many events, statistics go on
+	static const uint32_t GPU_THREAD_INDEX = 0xFFFF; //!< Thread index of the trace track with GPU zones
+
+	/** \brief Gets the profiler (created on first use). */
+	static Profiler& getInstance();
+
+	/** \brief Gets current time in nanoseconds, relative to profiler creation. */
+	int64_t now() const;
+
+	/** \brief Gets event buffer of the calling thread, registers the thread on first call. */
+	ProfilerThreadBuffer& getThreadBuffer();
+
+	/** \brief Gathers events recorded by all threads since last call, updates statistics and trace. */
+	void endFrame();
+
+	/** \brief Adds event measured elsewhere (e.g. GPU zone converted to profiler time) to the trace only. */
+	void addTraceEvent(const ProfilerEvent& event);
+
+	/** \brief Gets rolling statistics of all zones seen so far, sorted by name. */
+	std::vector<ProfilerZoneSummary> getSummary() const;
+
+	/** \brief Prints rolling statistics as a table. */
+	void printSummary(std::ostream& stream) const;
+
+	/** \brief Writes gathered events as Chrome trace JSON.
+	*   \param path Path of the output file
+	*   \return True if the file has been written or false otherwise.
+	*/
+	bool writeChromeTrace(const std::string& path) const;
+
+	/** \brief Gets number of events lost because a thread buffer overflowed between two endFrame calls. */
+	size_t getNumLostEvents() const;
+
+private:
+	struct NameLess
+	{
+		bool operator()(const char* a, const char* b) const { return strcmp(a, b) < 0; }
+	};
+
+	struct ZoneWindow
+	{
+		std::vector<int64_t> durations; //! Ring of last WINDOW_SIZE durations, in nanoseconds
+		size_t totalCount = 0;
+	};
+
+	Profiler();
+
+	int64_t _startTime; //! Creation time of the profiler, in steady clock nanoseconds
+
+	mutable std::mutex _threadsMutex; //! Guards list of thread buffers and the trace (taken when a thread registers, in endFrame and addTraceEvent)
+	std::vector<std::unique_ptr<ProfilerThreadBuffer>> _threadBuffers; //! Owned here, so they outlive their threads
+
+	std::map<const char*, ZoneWindow, NameLess> _zones; //! Keyed by name content, same literal may have more addresses
+	std::vector<ProfilerEvent> _traceEvents;
+	size_t _numLostEvents = 0;
+};
+
+/**
+  Records a zone from its construction to its destruction.
+*/
+class ProfilerScope
+{
+public:
+	explicit ProfilerScope(const char* name);
+	~ProfilerScope();
+
+	ProfilerScope(const ProfilerScope&) = delete;
+	ProfilerScope& operator=(const ProfilerScope&) = delete;
+
+private:
+	const char* _name;
+	int64_t _start;
+	ProfilerThreadBuffer& _buffer;
+};
+
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
+#define PROFILE_SCOPE(name) ProfilerScope PROFILER_CONCAT(profilerScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_END_FRAME() Profiler::getInstance().endFrame()
+#define PROFILE_PRINT_SUMMARY(stream) Profiler::getInstance().printSummary(stream)
+#define PROFILE_WRITE_TRACE(path) Profiler::getInstance().writeChromeTrace(path)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_END_FRAME()
+#define PROFILE_PRINT_SUMMARY(stream)
+#define PROFILE_WRITE_TRACE(path)
+
+#endif
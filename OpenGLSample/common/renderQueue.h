@@ -0,0 +1,244 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Project
+#include "gpuProfiler.h"
+#include "instanceBuffer.h"
+
+/**
+  Render passes, executed in this order.
+*/
+enum RenderPass
+{
+	RENDER_PASS_UNLIT = 0, //!< Emissive geometry, e.g. the light window
+	RENDER_PASS_OPAQUE = 1, //!< Lit geometry, sorted by state and then front to back
+	RENDER_PASS_TRANSPARENT = 2 //!< Blended geometry, sorted back to front
+};
+
+/**
+  Program used by draw packets, together with locations of its per-draw uniforms.
+*/
+struct RenderProgram
+{
+	GLuint programID = 0;
+	GLint mvpLocation = -1; //!< Location of "MVP", -1 if program does not have it
+	GLint modelLocation = -1; //!< Location of "model", -1 if program does not have it
+	GLenum textureTarget = GL_TEXTURE_2D; //!< Target the texture of its packets is bound to (GL_TEXTURE_2D_ARRAY for texture arrays)
+};
+
+/**
+  One draw call with all the state it needs. Packets are collected during the frame,
+  sorted by their key and executed at once. Matrices of single draws are kept aside
+  in the command buffer, so that packets stay small for sorting and merging.
+*/
+struct DrawPacket
+{
+	uint64_t sortKey; //!< Pass | program | texture | VAO | depth, pass | depth | program | texture | VAO for blended packets, see RenderQueue::makeSortKey
+	const RenderProgram* program;
+	GLuint vao;
+	GLuint texture; //!< Diffuse texture bound to unit 0, 0 to keep whatever is bound
+	GLenum mode; //!< Primitive type (GL_TRIANGLES, GL_TRIANGLE_STRIP...)
+	GLint first; //!< First vertex, for non-indexed draws
+	GLsizei count; //!< Number of vertices or indices, number of commands for multi-draw-indirect
+	GLenum indexType; //!< Index type for indexed draws, 0 for glDrawArrays
+	uintptr_t indexByteOffset; //!< Byte offset of first index in the element buffer, of first command for multi-draw-indirect
+	GLuint indirectBuffer; //!< Buffer with DrawElementsIndirectCommand records for multi-draw-indirect, 0 for direct draws
+	const InstanceBuffer* instances; //!< Instance buffer of instanced draws, nullptr for single draws
+	GLuint firstInstance; //!< First instance of the drawn range in the instance buffer
+	GLsizei numInstances; //!< Number of drawn instances, 0 for single draws
+	const char* timingGroup; //!< GPU timing group (see RenderQueue::setTimingGroup), nullptr if not timed
+	uint32_t matrices; //!< Index of DrawMatrices in the command buffer, NO_MATRICES for instanced draws
+};
+
+/**
+  Per-draw matrices of a single (non-instanced) draw packet.
+*/
+struct DrawMatrices
+{
+	glm::mat4 model;
+	glm::mat4 MVP;
+};
+
+/**
+  Counters of the last executed frame.
+*/
+struct RenderQueueStats
+{
+	size_t numDraws = 0;
+	size_t numInstances = 0; //!< Instances drawn by instanced packets
+	size_t numTriangles = 0; //!< Triangles of all draws (triangle primitive types only), except indirect ones generated on the GPU
+	size_t numProgramBinds = 0;
+	size_t numVAOBinds = 0;
+	size_t numTextureBinds = 0;
+	size_t numSkippedBinds = 0; //!< State changes avoided because the state was already set
+};
+
+/**
+  Draw packets recorded by one thread. Every recording job gets its own command buffer, so that packets
+  are written without locking. Buffers only compute keys and matrices, they never call OpenGL.
+*/
+class RenderCommandBuffer
+{
+public:
+	static const int DEPTH_BITS = 20; //!< Precision of quantized view distance in the sort key
+	static const uint32_t NO_MATRICES = 0xFFFFFFFF;
+
+	/** \brief Drops all packets and sets camera of the frame.
+	*   \param viewProjection  Projection * view matrix of the frame, used to compute MVP of every packet
+	*   \param cameraPosition  Camera position, used for depth sorting
+	*   \param farPlane        Distance at which the depth part of the key saturates
+	*/
+	void reset(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float farPlane);
+
+	/** \brief Sets GPU timing group of packets submitted from now on, nullptr to stop timing them. reset clears it.
+	*   \param name Group name, must be a string literal (only the pointer is stored)
+	*/
+	void setTimingGroup(const char* name);
+
+	/** \brief Adds non-indexed draw (glDrawArrays) to the buffer. */
+	void submitArrays(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLint first, GLsizei count, const glm::mat4& model);
+
+	/** \brief Adds indexed draw (glDrawElements) to the buffer. */
+	void submitElements(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const glm::mat4& model);
+
+	/** \brief Adds instanced non-indexed draw (glDrawArraysInstanced) of a contiguous range of instances to the buffer.
+	*          Program of the packet has to read model matrix and material from instance attributes.
+	*          In RENDER_PASS_TRANSPARENT every instance becomes a packet of its own, to be sorted back to front.
+	*/
+	void submitArraysInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLint first, GLsizei count, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances);
+
+	/** \brief Adds instanced indexed draw (glDrawElementsInstanced) of a contiguous range of instances to the buffer. */
+	void submitElementsInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances);
+
+	/** \brief Adds indexed multi-draw-indirect (glMultiDrawElementsIndirect, OpenGL 4.3) of consecutive commands to the buffer.
+	*          Commands are written on the GPU, so the packet is sorted as if it was at the origin and its triangles are not counted.
+	*   \param indirectBuffer     Buffer with DrawElementsIndirectCommand records
+	*   \param commandByteOffset  Byte offset of the first drawn command
+	*   \param numCommands        Number of drawn commands
+	*/
+	void submitElementsIndirect(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLenum indexType, GLuint indirectBuffer, uintptr_t commandByteOffset, GLsizei numCommands);
+
+	/** \brief Gets number of recorded packets. */
+	size_t getNumPackets() const;
+
+	const DrawPacket& getPacket(size_t index) const;
+	const DrawMatrices& getMatrices(uint32_t index) const;
+
+private:
+	std::vector<DrawPacket> _packets; //! Packets in submission order
+	std::vector<DrawMatrices> _matrices; //! Matrices of single draws
+
+	glm::mat4 _viewProjection = glm::mat4(1.0f);
+	glm::vec3 _cameraPosition = glm::vec3(0.0f);
+	float _farPlane = 100.0f;
+	const char* _timingGroup = nullptr; //! Timing group stamped into submitted packets
+
+	DrawPacket& addPacket(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture, const glm::mat4& model, bool hasMatrices);
+	DrawPacket& addInstancedPacket(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances);
+	static GLsizei getInstancesPerPacket(RenderPass pass, GLsizei numInstances);
+	uint32_t quantizeDepth(RenderPass pass, const glm::mat4& model) const;
+};
+
+/**
+  Collects draw packets of a frame from one or more command buffers, merges and sorts them with a radix sort
+  on their 64-bit keys and executes them on the OpenGL thread, binding program, VAO and texture only when they really change.
+  Submit methods of the queue itself record into command buffer 0.
+*/
+class RenderQueue
+{
+public:
+	static const int DEPTH_BITS = RenderCommandBuffer::DEPTH_BITS;
+
+	/** \brief Starts a new frame, drops all packets of the previous one.
+	*   \param viewProjection    Projection * view matrix of the frame, used to compute MVP of every packet
+	*   \param cameraPosition    Camera position, used for depth sorting
+	*   \param farPlane          Distance at which the depth part of the key saturates
+	*   \param numCommandBuffers Command buffers recorded in this frame, at least 1
+	*/
+	void beginFrame(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float farPlane, size_t numCommandBuffers = 1);
+
+	/** \brief Gets command buffer, that one recording job fills. Packets of buffers with lower index come first among equal keys. */
+	RenderCommandBuffer& getCommandBuffer(size_t index);
+
+	/** \brief Gets number of command buffers of this frame. */
+	size_t getNumCommandBuffers() const;
+
+	/** \brief Sets timing group of command buffer 0. */
+	void setTimingGroup(const char* name);
+
+	/** \brief Adds non-indexed draw to command buffer 0. */
+	void submitArrays(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLint first, GLsizei count, const glm::mat4& model);
+
+	/** \brief Adds indexed draw to command buffer 0. */
+	void submitElements(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const glm::mat4& model);
+
+	/** \brief Adds instanced non-indexed draw to command buffer 0. */
+	void submitArraysInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLint first, GLsizei count, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances);
+
+	/** \brief Adds instanced indexed draw to command buffer 0. */
+	void submitElementsInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances);
+
+	/** \brief Adds indexed multi-draw-indirect to command buffer 0. */
+	void submitElementsIndirect(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+		GLenum mode, GLenum indexType, GLuint indirectBuffer, uintptr_t commandByteOffset, GLsizei numCommands);
+
+	/** \brief Merges packets of all command buffers and sorts them by their keys (stable LSD radix sort). */
+	void sort();
+
+	/** \brief Issues all packets in sorted order, skipping redundant binds. Texture unit 0 is left active.
+	*   \param gpuProfiler If given, every render pass and every run of packets of one timing group
+	*                      within it are measured as GPU zones
+	*/
+	void execute(GPUProfiler* gpuProfiler = nullptr);
+
+	/** \brief Gets number of packets submitted in this frame, in all command buffers. */
+	size_t getNumPackets() const;
+
+	/** \brief Gets packet at given position of the sorted order (valid after sort). */
+	const DrawPacket& getSortedPacket(size_t index) const;
+
+	/** \brief Gets counters of the last execute call. */
+	const RenderQueueStats& getStats() const;
+
+	/** \brief Builds sort key. Higher fields take precedence: pass (4 bits), program (8 bits),
+	*          texture (16 bits), VAO (16 bits) and quantized depth (DEPTH_BITS bits). RENDER_PASS_TRANSPARENT puts
+	*          the depth right below the pass, so blended packets are drawn back to front whatever their state.
+	*          OpenGL names are truncated to their field width, which only affects sorting quality, never correctness.
+	*/
+	static uint64_t makeSortKey(RenderPass pass, GLuint programID, GLuint texture, GLuint vao, uint32_t depth);
+
+	/** \brief Gets number of triangles drawn by given primitive type and vertex (index) count, 0 for points and lines. */
+	static size_t getNumTriangles(GLenum mode, GLsizei count);
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t commandBuffer;
+		uint32_t packetIndex;
+	};
+
+	std::vector<RenderCommandBuffer> _commandBuffers; //! Kept between frames, so that their memory is reused
+	size_t _numCommandBuffers = 1; //! Command buffers used in current frame
+	std::vector<SortEntry> _sorted; //! Keys with packet locations, sorted by sort()
+	std::vector<SortEntry> _sortScratch; //! Ping-pong buffer of the radix sort
+	bool _isSorted = false;
+
+	RenderQueueStats _stats;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Project
+#include "mappedFile.h"
+
+/**
+  Scene description in two forms with the same content:
+
+  Text form (.scene) is for authoring, one statement per line, '#' starts a comment:
+    specular <path>                          texture bound to unit 1 for all lit objects
+    texture <name> <path>
+    mesh <name> plane <dimension>
+    mesh <name> cube | container
+    mesh <name> cylinder <radius> <slices> <height>
+    mesh <name> torus <innerRadius> <outerRadius>
+    mesh <name> sphere <radius> <sectors> <stacks>
+    material <uScale> <vScale> <shininess>   materials are indexed in order of appearance, at most MAX_MATERIALS of them
+    light <x> <y> <z> ambient <r g b> diffuse <r g b> specular <r g b> attenuation <constant linear quadratic>
+    object <mesh|-> <texture|-> [name <name>] [parent <name>] [pass unlit|opaque|transparent] [group <name>] [material <index>]
+           [translate <x y z>] [rotate <degrees> <x y z>] [scale <x y z>]...
+  Transforms of an object are applied in the given order, like successive glm::translate / rotate / scale calls,
+  and are relative to the parent object, which has to be named and defined earlier. Objects without a mesh
+  are transform nodes only, they group objects moving together. Radii and sizes have to be positive, plane dimension
+  an integer from 2 to MAX_PLANE_DIMENSION, slices and sectors integers from 3 and stacks from 2 to MAX_SEGMENTS.
+
+  Binary form (.sceneb) is baked from the text form and memory-mapped at load: header followed by arrays
+  of fixed-size records and a string table. Records are used in place, loading does not parse or copy anything.
+  Objects are stored sorted by pass, group, mesh and texture, so that objects drawn together are contiguous.
+  Parents may therefore follow their children in the object array.
+*/
+
+enum ScenePrimitive : uint32_t
+{
+	SCENE_PRIMITIVE_PLANE = 0, //!< parameters: dimension
+	SCENE_PRIMITIVE_CUBE = 1,
+	SCENE_PRIMITIVE_CONTAINER = 2, //!< Cube with container texture mapping
+	SCENE_PRIMITIVE_CYLINDER = 3, //!< parameters: radius, slices, height
+	SCENE_PRIMITIVE_TORUS = 4, //!< parameters: inner radius, outer radius
+	SCENE_PRIMITIVE_SPHERE = 5 //!< parameters: radius, sectors, stacks
+};
+
+enum ScenePass : uint32_t
+{
+	SCENE_PASS_UNLIT = 0, //!< Same values as RenderPass
+	SCENE_PASS_OPAQUE = 1,
+	SCENE_PASS_TRANSPARENT = 2
+};
+
+struct SceneFileHeader
+{
+	char magic[4]; //!< "SCNB"
+	uint32_t version;
+	uint32_t numMeshes;
+	uint32_t numTextures;
+	uint32_t numMaterials;
+	uint32_t numLights;
+	uint32_t numObjects;
+	uint32_t meshesOffset; //!< Byte offsets of the arrays from the beginning of the file
+	uint32_t texturesOffset;
+	uint32_t materialsOffset;
+	uint32_t lightsOffset;
+	uint32_t objectsOffset;
+	uint32_t stringsOffset;
+	uint32_t stringsSize;
+	uint32_t specularTexturePath; //!< String offset, NO_STRING if there is none
+};
+
+struct SceneMeshRecord
+{
+	uint32_t name; //!< String offset
+	uint32_t primitive; //!< ScenePrimitive
+	float parameters[4];
+};
+
+struct SceneTextureRecord
+{
+	uint32_t name; //!< String offset
+	uint32_t path; //!< String offset
+};
+
+struct SceneMaterialRecord
+{
+	float uvScale[2];
+	float shininess;
+	float padding;
+};
+
+struct SceneLightRecord
+{
+	float position[4];
+	float ambient[4];
+	float diffuse[4];
+	float specular[4];
+	float attenuation[4]; //!< constant, linear, quadratic
+};
+
+struct SceneObjectRecord
+{
+	float model[16]; //!< Column-major model matrix, relative to the parent
+	uint32_t mesh; //!< Mesh index, NO_MESH for transform nodes
+	uint32_t texture; //!< Texture index, NO_TEXTURE to keep the bound texture
+	uint32_t pass; //!< ScenePass
+	uint32_t group; //!< String offset of the timing group name, NO_STRING if there is none
+	uint32_t material; //!< Material index
+	uint32_t parent; //!< Parent object index, NO_PARENT for root objects
+	uint32_t padding[2];
+};
+
+/**
+  Scene loaded from the text form (records owned) or from the binary form (records mapped from the file).
+  Either way it is accessed through the same record arrays.
+*/
+class SceneFile
+{
+public:
+	static const uint32_t VERSION = 2;
+	static const uint32_t NO_STRING = 0xFFFFFFFF;
+	static const uint32_t NO_TEXTURE = 0xFFFFFFFF;
+	static const uint32_t NO_MESH = 0xFFFFFFFF;
+	static const uint32_t NO_PARENT = 0xFFFFFFFF;
+	static const int MAX_SEGMENTS = 4096; //!< Largest slice, sector or stack count of a mesh
+	static const int MAX_PLANE_DIMENSION = 256; //!< Largest plane dimension, vertices of a plane take 16-bit indices
+
+	/** \brief Loads scene, binary form if the path ends with ".sceneb" or text form otherwise.
+	*   \return True if the scene has been loaded or false otherwise.
+	*/
+	bool loadScene(const std::string& path);
+
+	/** \brief Parses text form of the scene. */
+	bool loadText(const std::string& path);
+
+	/** \brief Maps binary form of the scene and validates its header and record references. */
+	bool loadBinary(const std::string& path);
+
+	/** \brief Writes loaded scene in the binary form. */
+	bool saveBinary(const std::string& path) const;
+
+	uint32_t getNumMeshes() const;
+	const SceneMeshRecord& getMesh(uint32_t index) const;
+
+	uint32_t getNumTextures() const;
+	const SceneTextureRecord& getTexture(uint32_t index) const;
+
+	uint32_t getNumMaterials() const;
+	const SceneMaterialRecord& getMaterial(uint32_t index) const;
+
+	uint32_t getNumLights() const;
+	const SceneLightRecord& getLight(uint32_t index) const;
+
+	uint32_t getNumObjects() const;
+	const SceneObjectRecord* getObjects() const;
+
+	/** \brief Gets string from the string table, nullptr for NO_STRING. Strings live as long as the scene. */
+	const char* getString(uint32_t offset) const;
+
+	/** \brief Gets path of the specular texture, nullptr if the scene has none. */
+	const char* getSpecularTexturePath() const;
+
+	/** \brief Drops the scene (unmaps the binary form). */
+	void clear();
+
+private:
+	SceneFileHeader _header = {};
+	const SceneMeshRecord* _meshes = nullptr;
+	const SceneTextureRecord* _textures = nullptr;
+	const SceneMaterialRecord* _materials = nullptr;
+	const SceneLightRecord* _lights = nullptr;
+	const SceneObjectRecord* _objects = nullptr;
+	const char* _strings = nullptr;
+
+	MappedFile _mappedFile; //! Binary form
+
+	// Text form
+	std::vector<SceneMeshRecord> _ownedMeshes;
+	std::vector<SceneTextureRecord> _ownedTextures;
+	std::vector<SceneMaterialRecord> _ownedMaterials;
+	std::vector<SceneLightRecord> _ownedLights;
+	std::vector<SceneObjectRecord> _ownedObjects;
+	std::vector<char> _ownedStrings;
+	std::unordered_map<std::string, uint32_t> _ownedStringOffsets; //! Offset of every string in _ownedStrings
+
+	uint32_t addString(const std::string& text);
+	void pointToOwnedRecords();
+	bool validate(const std::string& path) const;
+};
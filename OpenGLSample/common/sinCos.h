@@ -0,0 +1,50 @@
+#pragma once
+
+// STL
+#include <cstddef>
+
+/**
+  Sines and cosines of whole arrays of angles, for tessellation of parametric meshes. Angles are reduced
+  to [-pi/4, pi/4] by a three-part multiple of pi/4 and both functions are evaluated by the minimax polynomials
+  of Cephes sinf and cosf, 8 angles at once: one AVX instruction when the CPU supports AVX (checked once, at run time,
+  the AVX kernel is compiled for it without /arch:AVX or -mavx), two SSE2 instructions otherwise. Last angles of an array
+  go through the same batch padded, so results do not depend on the kernel or on where the angle is in the array
+  (--bench-meshes checks, that all supported kernels agree bit for bit). Error is within 2 ulp for |angle| < 8192.
+*/
+class SinCos
+{
+public:
+	static const int BATCH_SIZE = 8; //!< Angles computed at once
+
+	//! Implementations of the batch, KERNEL_SSE2 is compiled only for x86 and x64
+	enum Kernel
+	{
+		KERNEL_SCALAR,
+		KERNEL_SSE2,
+		KERNEL_AVX,
+		NUM_KERNELS
+	};
+
+	/** \brief Gets the fastest kernel supported by the compiler and the CPU, used by all functions without kernel parameter. */
+	static Kernel getKernel();
+
+	/** \brief Checks, that the kernel is compiled in and the CPU can run it. */
+	static bool isKernelSupported(Kernel kernel);
+
+	static const char* getKernelName(Kernel kernel);
+
+	/** \brief Computes sines and cosines of given angles, in radians, output arrays may not overlap them. */
+	static void compute(const float* angles, size_t count, float* sines, float* cosines);
+
+	/** \brief Computes the same as compute above by given kernel, which must be supported (see isKernelSupported). */
+	static void compute(Kernel kernel, const float* angles, size_t count, float* sines, float* cosines);
+
+	/** \brief Computes sines and cosines of angles firstAngle + i * angleStep, i from 0 to count - 1. */
+	static void computeSteps(float firstAngle, float angleStep, size_t count, float* sines, float* cosines);
+
+	/** \brief Computes sines and cosines of boundaries of circle segments, angle 2 * pi * i / numSegments.
+	*   \param sines   Receives numSegments + 1 values, the last one repeats the first exactly, to close the circle
+	*   \param cosines Receives numSegments + 1 values as well
+	*/
+	static void computeCircle(int numSegments, float* sines, float* cosines);
+};
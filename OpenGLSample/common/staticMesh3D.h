@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vertexBufferObject.h"
+#include "bounds.h"
 
 
 namespace static_meshes_3D {
@@ -47,6 +48,16 @@ public:
 	*/
 	int getVertexByteSize() const;
 
+	/** \brief  Gets vertex array object of the mesh, so that its draws can be queued.
+	*   \return VAO ID from OpenGL.
+	*/
+	GLuint getVAO() const;
+
+	/** \brief  Gets bounding volumes of the mesh in its local space, for culling.
+	*   \return Bounds computed when the mesh was initialized.
+	*/
+	const Bounds& getBounds() const;
+
 protected:
 	bool _hasPositions = false; //!< Flag telling, if we have vertex positions
 	bool _hasTextureCoordinates = false; //!< Flag telling, if we have texture coordinates
@@ -55,6 +66,7 @@ protected:
 	bool _isInitialized = false; //!< Is mesh initialized flag
 	GLuint _vao = 0; //!< VAO ID from OpenGL
 	VertexBufferObject _vbo; //!< Our VBO wrapper class holding static mesh data
+	Bounds _bounds; //!< Local space bounds, set by initializeData
 
 	/** \brief  Initializes vertex data. */
 	virtual void initializeData() {};
@@ -0,0 +1,80 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+  Where an image of the texture array pool ended up: array texture and layer within it.
+*/
+struct TextureLayer
+{
+	GLuint arrayID = 0; //!< OpenGL assigned ID of the GL_TEXTURE_2D_ARRAY, 0 until the arrays are created
+	GLint layer = 0; //!< Layer of the image in the array
+};
+
+/**
+  Images packed into layers of GL_TEXTURE_2D_ARRAY textures, so that objects with different images can share
+  one bound texture and one draw, with the layer selected per instance. Every image is resampled on import to its
+  size class (nearest power of two in each dimension, at most MAX_LAYER_SIZE), images of the same size class and
+  number of channels become layers of one array. Identical files are imported only once.
+*/
+class TextureArrayPool
+{
+public:
+	static const int MAX_LAYER_SIZE = 2048; //!< Larger images are downsampled to this size
+	static const uint32_t NO_IMAGE = 0xFFFFFFFF;
+
+	/** \brief Decodes image file and resamples it to its size class, can be called only before createArrays.
+	*   \param path Path to the image file
+	*   \return Index of the image, or NO_IMAGE, if the file cannot be read or decoded.
+	*/
+	uint32_t addImage(const std::string& path);
+
+	/** \brief Creates one array texture with mipmaps per size class and uploads the imported images as its layers.
+	*          Decoded images are freed, no more images can be added.
+	*/
+	void createArrays();
+
+	/** \brief Gets array texture and layer of an imported image, array ID is valid after createArrays. */
+	const TextureLayer& getLayer(uint32_t image) const;
+
+	size_t getNumImages() const;
+	size_t getNumArrays() const;
+
+	/** \brief Gets size class of an image dimension: nearest power of two, clamped to MAX_LAYER_SIZE. */
+	static int getLayerSize(int size);
+
+	/** \brief Deletes the array textures and all images. */
+	void deleteArrays();
+
+private:
+	//! Images of one size class and number of channels, layers of one array texture
+	struct ArrayClass
+	{
+		int width = 0;
+		int height = 0;
+		int numComponents = 0;
+		GLuint arrayID = 0;
+		std::vector<uint32_t> images; //! Image of every layer
+	};
+
+	//! File an image has been imported from, to compare content of files with the same hash
+	struct ImageFile
+	{
+		std::string path;
+		size_t size = 0;
+	};
+
+	std::vector<TextureLayer> _layers; //! Layer of every image
+	std::vector<std::vector<unsigned char>> _pixels; //! Resampled pixels of every image, until the arrays are created
+	std::vector<ArrayClass> _classes;
+	std::unordered_map<std::string, uint32_t> _imagesByPath;
+	std::vector<ImageFile> _imageFiles; //! File of every image
+	std::unordered_multimap<uint64_t, uint32_t> _imagesByContent; //! Images by content hash, to find same content under another path
+	bool _areArraysCreated = false;
+};
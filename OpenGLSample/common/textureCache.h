@@ -0,0 +1,72 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+/**
+  OpenGL 2D texture owned by the texture cache. GL texture is deleted, when the last handle goes away,
+  so all handles must be released while the OpenGL context still exists.
+*/
+struct Texture
+{
+	GLuint textureID = 0; //!< OpenGL assigned texture ID
+	int width = 0;
+	int height = 0;
+	int numComponents = 0; //!< Number of color channels of the source image
+	uint64_t contentHash = 0; //!< Hash of the encoded file content
+	size_t contentSize = 0; //!< Size of the encoded file, in bytes
+	std::string contentPath; //!< File the texture has been decoded from, compared with files of equal hash
+
+	Texture() = default;
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	~Texture();
+};
+
+//! Shared, reference-counted handle to a cached texture
+typedef std::shared_ptr<const Texture> TextureHandle;
+
+/**
+  Loads textures from image files, keyed both by path and by content hash, so that every image
+  is decoded and uploaded only once, even if it is referenced by several paths. Files of equal hash
+  share a texture only if their bytes are equal as well. Cache keeps only weak
+  references, texture lives as long as someone holds its handle.
+*/
+class TextureCache
+{
+public:
+	/** \brief Gets texture of given image file, decodes and uploads it only if it is not loaded yet.
+	*   \param path Path to the image file
+	*   \return Handle to the texture, or empty handle, if the file cannot be read or decoded.
+	*/
+	TextureHandle load(const std::string& path);
+
+	/** \brief Removes entries of textures, that are not referenced anymore. */
+	void collectGarbage();
+
+	/** \brief Gets number of textures, that are currently alive. */
+	size_t getNumTextures() const;
+
+	/** \brief Gets number of images decoded so far. */
+	size_t getNumDecodes() const;
+
+	/** \brief Gets number of loads served by an already existing texture (by path or by content). */
+	size_t getNumHits() const;
+
+	/** \brief Computes 64-bit FNV-1a hash of given data. */
+	static uint64_t hashContent(const unsigned char* data, size_t size);
+
+private:
+	std::unordered_map<std::string, std::weak_ptr<const Texture>> _texturesByPath; //! Fast path, avoids reading the file again
+	std::unordered_multimap<uint64_t, std::weak_ptr<const Texture>> _texturesByContent; //! Same image under different paths, several textures if hashes collide
+
+	size_t _numDecodes = 0;
+	size_t _numHits = 0;
+
+	static TextureHandle createTexture(const unsigned char* fileData, size_t fileSize, uint64_t contentHash, const std::string& path);
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+  Parent-relative transforms of scene nodes, stored as structure of arrays (parents, local and world matrices).
+  Parents always precede their children, so world matrices are brought up to date by one linear pass, that starts
+  at the first dirty node and recomputes only nodes, whose local matrix or parent world matrix has changed.
+  Static scenes therefore cost nothing per frame and a moved node updates its whole subtree in that single pass.
+*/
+class TransformHierarchy
+{
+public:
+	static const uint32_t NO_PARENT = 0xFFFFFFFF;
+
+	/** \brief Adds node, its world matrix is computed by the next update.
+	*   \param parent      Index of the parent node, it has to be added before. NO_PARENT for root nodes
+	*   \param localMatrix Transform relative to the parent
+	*   \return Index of the added node.
+	*/
+	uint32_t addNode(uint32_t parent, const glm::mat4& localMatrix);
+
+	/** \brief Changes transform of the node relative to its parent, marks the node dirty. */
+	void setLocalMatrix(uint32_t node, const glm::mat4& localMatrix);
+
+	const glm::mat4& getLocalMatrix(uint32_t node) const;
+
+	/** \brief Gets world matrix of the node, as computed by the last update. */
+	const glm::mat4& getWorldMatrix(uint32_t node) const;
+
+	uint32_t getParent(uint32_t node) const;
+
+	uint32_t getNumNodes() const;
+
+	/** \brief Recomputes world matrices of dirty nodes and all their descendants.
+	*   \return Number of recomputed world matrices.
+	*/
+	size_t update();
+
+	/** \brief Gets nodes, whose world matrices have been recomputed by the last update, in increasing order. */
+	const std::vector<uint32_t>& getChangedNodes() const;
+
+	/** \brief Removes all nodes. */
+	void clear();
+
+private:
+	std::vector<uint32_t> _parents;
+	std::vector<glm::mat4> _localMatrices;
+	std::vector<glm::mat4> _worldMatrices;
+	std::vector<uint8_t> _isDirty; //! Local matrix has changed since the last update
+	std::vector<uint8_t> _hasChanged; //! World matrix has been recomputed by the last update
+
+	std::vector<uint32_t> _changedNodes; //! Nodes with _hasChanged set
+	uint32_t _firstDirtyNode = NO_PARENT; //! Lowest dirty node, NO_PARENT if there is none
+};
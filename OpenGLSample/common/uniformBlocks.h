@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/**
+  Uniform blocks shared by the scene programs. C++ structs mirror the std140 layout
+  of the GLSL declarations below, so they can be copied into UniformBufferObject as they are.
+*/
+
+const GLuint FRAME_BLOCK_BINDING = 0; //!< Binding point of per-frame block (camera and light clusters)
+const GLuint MATERIAL_BLOCK_BINDING = 1; //!< Binding point of per-material block
+
+// Sizes used by both C++ and GLSL are macros, so that GLSL_VALUE can paste them into shader sources
+#define GLSL_STRINGIFY(value) #value
+#define GLSL_VALUE(value) GLSL_STRINGIFY(value) //!< String literal of the expanded macro value
+
+#define MAX_MATERIALS_VALUE 8
+const int MAX_MATERIALS = MAX_MATERIALS_VALUE; //!< Size of material array in MaterialBlock
+
+// Point light, as stored in the light texture buffer of LightClusters (every vec3 is stored as vec4)
+struct LightBlockData
+{
+	glm::vec4 position; // xyz = world position
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+	glm::vec4 attenuation; // x = constant, y = linear, z = quadratic
+};
+
+// Camera and light cluster grid, written once per frame
+struct FrameBlockData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 viewPosition; // xyz = camera position
+	glm::vec4 clusterCounts; // xyz = light clusters along the viewport width, height and view depth
+	glm::vec4 clusterDepth; // x = scale, y = bias: depth slice of a fragment is log(view depth) * x + y
+};
+
+// Surface parameters of one material
+struct MaterialData
+{
+	glm::vec2 uvScale;
+	GLfloat shininess;
+	GLfloat padding;
+};
+
+// All materials, indexed by material index of instances (single draws use material 0)
+struct MaterialBlockData
+{
+	MaterialData materials[MAX_MATERIALS];
+};
+
+// GLSL declarations of the blocks, to be pasted into shader sources right after #version
+#define FRAME_BLOCK_GLSL \
+"layout (std140) uniform FrameBlock {\n" \
+"    mat4 view;\n" \
+"    mat4 projection;\n" \
+"    vec4 viewPosition;\n" \
+"    vec4 clusterCounts;\n" \
+"    vec4 clusterDepth;\n" \
+"};\n"
+
+#define MATERIAL_BLOCK_GLSL \
+"struct Material {\n" \
+"    vec2 uvScale;\n" \
+"    float shininess;\n" \
+"};\n" \
+"layout (std140) uniform MaterialBlock {\n" \
+"    Material materials[" GLSL_VALUE(MAX_MATERIALS_VALUE) "];\n" \
+"};\n"
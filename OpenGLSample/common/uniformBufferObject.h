@@ -0,0 +1,78 @@
+#pragma once
+
+// STL
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+  Wraps OpenGL's uniform buffer object bound to a fixed binding point. Data are staged in an in-memory
+  copy and only uploaded when something really changed (dirty flag), so that static blocks cost nothing per frame.
+*/
+
+class UniformBufferObject
+{
+public:
+	/** \brief Creates a new UBO with given size and attaches it to the uniform binding point.
+	*   \param bindingPoint  Index of the uniform buffer binding point, shared by all programs using the block
+	*   \param sizeBytes     Block size, in bytes (must match std140 layout of the GLSL block)
+	*/
+	void createUBO(GLuint bindingPoint, size_t sizeBytes);
+
+	/** \brief Connects uniform block of given program to the binding point of this UBO.
+	*   \param programID Linked shader program
+	*   \param blockName Name of the uniform block in GLSL
+	*   \return True if the program has such block or false otherwise.
+	*/
+	bool bindToProgram(GLuint programID, const char* blockName) const;
+
+	/** \brief Writes raw data to the in-memory block, marks block dirty only if the data differ.
+	*   \param ptrData       Pointer to the raw data
+	*   \param dataSizeBytes Size of the written data (in bytes)
+	*   \param offset        Byte offset inside the block
+	*/
+	void setRawData(const void* ptrData, size_t dataSizeBytes, size_t offset = 0);
+
+	/** \brief Writes whole block from a struct mirroring its std140 layout.
+	*   \param block Block data
+	*/
+	template<typename T>
+	void setData(const T& block)
+	{
+		setRawData(&block, sizeof(T));
+	}
+
+	/** \brief Uploads in-memory block to the GPU through mapped buffer, if it has been changed since last upload.
+	*   \return True if the upload took place or false otherwise.
+	*/
+	bool uploadIfDirty();
+
+	/** \brief Checks, if the in-memory block has changes, that have not been uploaded yet.
+	*   \return True if it has or false otherwise.
+	*/
+	bool isDirty() const;
+
+	/** \brief Gets number of uploads done so far. */
+	size_t getNumUploads() const;
+
+	/** \brief Gets OpenGL-assigned buffer ID.
+	*   \return Buffer ID.
+	*/
+	GLuint getBufferID() const;
+
+	/** \brief Gets binding point of this UBO. */
+	GLuint getBindingPoint() const;
+
+	/** \brief Deletes UBO and frees memory and internal structures. */
+	void deleteUBO();
+
+private:
+	GLuint _bufferID = 0; //! OpenGL assigned buffer ID
+	GLuint _bindingPoint = 0; //! Uniform buffer binding point
+
+	std::vector<unsigned char> _rawData; //! In-memory copy of the block
+	size_t _numUploads = 0; //! How many times the block has been uploaded
+
+	bool _isBufferCreated = false;
+	bool _isDirty = false; //! Flag telling, if in-memory data differ from GPU data
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+// STL
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+/** \brief Hashes uniform name with FNV-1a. Being constexpr, keys written as uniformKey("MVP") are resolved
+*          by the compiler, so render code never hashes or compares strings.
+*   \param name Uniform name as it appears in GLSL (e.g. "light1.position" or "lights[0]")
+*   \return 32-bit hashed key
+*/
+constexpr uint32_t uniformKey(const char* name, uint32_t hash = 2166136261u)
+{
+	return *name == '\0' ? hash : uniformKey(name + 1, (hash ^ static_cast<uint8_t>(*name)) * 16777619u);
+}
+
+/**
+  Reflection of active uniforms of a linked shader program. All locations are queried once
+  after linking, afterwards they are looked up by hashed key or kept around as plain GLint handles.
+*/
+class UniformTable
+{
+public:
+	/** \brief Enumerates active uniforms of the program (GL_ACTIVE_UNIFORMS) and caches their locations.
+	*   \param programID Successfully linked shader program
+	*/
+	void reflectProgram(GLuint programID);
+
+	/** \brief Gets location of uniform by its hashed name.
+	*   \param key Key created with uniformKey
+	*   \return Uniform location, or -1 if uniform is not active (glUniform* ignores -1 silently)
+	*/
+	GLint getLocation(uint32_t key) const;
+
+	/** \brief Gets location of uniform by its name. Hashes at runtime, so meant for setup code only.
+	*   \param name Uniform name
+	*   \return Uniform location, or -1 if uniform is not active
+	*/
+	GLint getLocation(const char* name) const;
+
+	/** \brief Checks, if program has active uniform with given key.
+	*   \return True if it has or false otherwise.
+	*/
+	bool hasUniform(uint32_t key) const;
+
+	/** \brief Gets ID of the reflected program.
+	*   \return Program ID, or 0 if nothing has been reflected yet.
+	*/
+	GLuint getProgramID() const;
+
+	/** \brief Gets number of cached uniform locations (array elements are counted separately).
+	*   \return Number of cached locations.
+	*/
+	size_t getNumUniforms() const;
+
+private:
+	struct Entry
+	{
+		uint32_t key; //! Hashed uniform name
+		GLint location; //! Location assigned by the linker
+	};
+
+	GLuint _programID = 0; //! Reflected program ID
+	std::vector<Entry> _entries; //! Cached locations, sorted by key for binary search
+
+	void addEntry(const char* name, GLint location);
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+// STL
+#include <cstddef>
+
+/**
+  Counts bytes sent from the CPU to the GPU (buffer and texture uploads, per-draw uniforms), so that
+  per-frame upload traffic can be reported. Classes doing uploads add their bytes, the frame loop resets it.
+*/
+class UploadCounter
+{
+public:
+	/** \brief Gets the counter of the application. */
+	static UploadCounter& getInstance();
+
+	/** \brief Adds uploaded bytes. */
+	void addBytes(size_t numBytes);
+
+	/** \brief Gets bytes uploaded since the last reset. */
+	size_t getNumBytes() const;
+
+	/** \brief Resets counter (e.g. at the beginning of a frame). */
+	void reset();
+
+private:
+	UploadCounter() = default;
+
+	size_t _numBytes = 0;
+};
@@ -1,9 +1,10 @@
 #pragma once
 
 // STL
+#include <cstddef>
 #include <vector>
 
-#include <glad\glad.h>
+#include <glad/glad.h>
 
 /**
   Wraps OpenGL's vertex buffer object to a higher level class.
@@ -15,7 +16,7 @@ public:
 	/** \brief Creates a new VBO, with optional reserved buffer size.
 	*   \param size Buffer size reservation, in bytes (so that memory allocations don't take place while adding data)
 	*/
-	void createVBO(uint32_t reserveSizeBytes = 0);
+	void createVBO(size_t reserveSizeBytes = 0);
 
 	/** \brief Binds this vertex buffer object (makes current).
 	*   \param bufferType Type of the bound buffer (usually GL_ARRAY_BUFFER, but can be also GL_ELEMENT_BUFFER for instance)
@@ -27,7 +28,7 @@ public:
 	*   \param dataSize Size of the added data (in bytes)
 	*   \param repeat How many times to repeat same data in the buffer (default is 1)
 	*/
-	void addRawData(const void* ptrData, uint32_t dataSizeBytes, int repeat = 1);
+	void addRawData(const void* ptrData, size_t dataSizeBytes, int repeat = 1);
 
 	/** \brief Adds arbitrary data to the in-memory buffer, before they get uploaded.
 	*   \param ptrData Data to be added
@@ -39,6 +40,19 @@ public:
 		addRawData(&obj, sizeof(T), repeat);
 	}
 
+	/** \brief Appends space for data to the in-memory buffer, so that generators can write it in place.
+	*   \param dataSizeBytes Size of the appended data (in bytes)
+	*   \return Pointer, where the data should be written, valid until more data are added.
+	*/
+	void* allocateRawData(size_t dataSizeBytes);
+
+	/** \brief Allocates space for count objects of type T in the in-memory buffer, see allocateRawData. */
+	template<typename T>
+	T* allocateData(size_t count)
+	{
+		return static_cast<T*>(allocateRawData(sizeof(T) * count));
+	}
+
 	/** \brief Gets pointer to the data from in-memory buffer (only before uploading them).
 	*   \return Pointer to the raw data.
 	*/
@@ -49,42 +63,63 @@ public:
 	*/
 	void uploadDataToGPU(GLenum usageHint);
 
-	void* mapBufferToMemory(GLenum usageHint) const;
-
-	void* mapSubBufferToMemory(GLenum usageHint, size_t offset, size_t length) const;
-
-	void unmapBuffer() const;
-
-	GLuint getBufferID() const;
-
-	/** \brief Maps buffer data to a memory pointer.
-	*   \param usageHint Hint for OpenGL, how is the data intended to be used (GL_STATIC_DRAW, GL_DYNAMIC_DRAW)
+	/** \brief Maps buffer data to a memory pointer (buffer must be bound).
+	*   \param usageHint Access to the mapped data (GL_READ_ONLY, GL_WRITE_ONLY, GL_READ_WRITE)
 	*   \return Pointer to the mapped data, or nullptr, if something fails.
 	*/
-	void* mapBufferToMemory(GLenum usageHint);
+	void* mapBufferToMemory(GLenum usageHint) const;
 
-	/** \brief Maps buffer sub-data to a memory pointer.
-	*   \param  usageHint Hint for OpenGL, how is the data intended to be used (GL_READ_ONLY, GL_WRITE_ONLY...`)
+	/** \brief Maps buffer sub-data to a memory pointer (buffer must be bound).
+	*   \param  usageHint Access bits of the mapped range (GL_MAP_READ_BIT, GL_MAP_WRITE_BIT...)
 	*   \param  offset    Byte offset in buffer, where to start
 	*   \param  length    Byte length of the mapped data
 	*   \return Pointer to the mapped data, or nullptr, if something fails.
 	*/
-	void* mapSubBufferToMemory(GLenum usageHint, uint32_t offset, uint32_t length);
+	void* mapSubBufferToMemory(GLenum usageHint, size_t offset, size_t length) const;
 
-	//* \brief Unmaps buffer (must have been mapped previously).
-	void unmapBuffer();
+	/** \brief Unmaps buffer (must have been mapped previously). */
+	void unmapBuffer() const;
 
 	/** \brief Gets OpenGL-assigned buffer ID.
 	*   \return Buffer ID.
 	*/
-	GLuint getBufferID();
+	GLuint getBufferID() const;
 
 	/** \brief Gets buffer size, in bytes.
 	*   \return Buffer size in bytes.
 	*/
-	uint32_t getBufferSize();
+	size_t getBufferSize();
+
+	/** \brief Creates VBO as a streaming ring buffer, split into regions written by consecutive frames.
+	*          Region is not written again until the GPU has finished all commands issued while it was current,
+	*          so CPU never overwrites data in flight and never stalls the driver by re-allocating storage.
+	*   \param regionSizeBytes Size of one region (maximum of data written in one frame), in bytes
+	*   \param numRegions      Number of regions, i.e. how many frames can be in flight
+	*   \param bufferType      Type of the buffer (GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER...)
+	*/
+	void createStreamingVBO(size_t regionSizeBytes, int numRegions = 3, GLenum bufferType = GL_ARRAY_BUFFER);
 
-	//* \brief Deletes VBO and frees memory and internal structures.
+	/** \brief Moves to the next region (waits, if the GPU still reads from it) and maps it for writing.
+	*          Called once per frame, before any allocateStreamingData.
+	*   \return True if the region has been mapped or false otherwise.
+	*/
+	bool beginStreamingRegion();
+
+	/** \brief Allocates space in the current region and returns pointer, where the data should be written.
+	*   \param sizeBytes    Size of the data, in bytes
+	*   \param alignment    Required alignment of the data start (e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+	*   \param bufferOffset Returns byte offset of the data from the beginning of the whole buffer
+	*   \return Pointer to the mapped memory, or nullptr, if the region is full or not mapped.
+	*/
+	void* allocateStreamingData(size_t sizeBytes, size_t alignment, size_t& bufferOffset);
+
+	/** \brief Unmaps current region, so that the data written so far can be used by draw calls. */
+	void endStreamingRegion();
+
+	/** \brief Gets how many times beginStreamingRegion had to wait for the GPU. */
+	size_t getNumStreamingWaits() const;
+
+	/** \brief Deletes VBO and frees memory and internal structures. */
 	void deleteVBO();
 
 private:
@@ -93,8 +128,17 @@ private:
 
 	std::vector<unsigned char> _rawData; //! In-memory raw data buffer, used to gather the data for VBO.
 	size_t _bytesAdded = 0; //! Number of bytes added to the buffer so far
-	uint32_t _uploadedDataSize; //! Holds buffer data size after uploading to GPU
+	size_t _uploadedDataSize = 0; //! Holds buffer data size after uploading to GPU
 
 	bool _isBufferCreated = false;
 	bool _isDataUploaded = false; //! Flag telling, if data has been uploaded to GPU already.
+
+	// Streaming ring buffer
+	bool _isStreaming = false;
+	size_t _regionSizeBytes = 0; //! Size of one ring region, in bytes
+	int _currentRegion = -1; //! Region written in current frame, -1 before first frame
+	std::vector<GLsync> _regionFences; //! Fences signalled when the GPU is done with the region
+	unsigned char* _ptrMappedRegion = nullptr; //! Mapped current region, nullptr if not mapped
+	size_t _regionBytesUsed = 0; //! Bytes allocated in current region
+	size_t _numStreamingWaits = 0; //! How many times the CPU had to wait for a region
 };
\ No newline at end of file
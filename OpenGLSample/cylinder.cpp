@@ -1,12 +1,14 @@
 // STL
+#include <algorithm>
 #include <vector>
 
 // GLM
 #include <glm/glm.hpp>
-#include <glm/gtc/constants.hpp>
 
 // Project
 #include "cylinder.h"
+#include "common/glStateCache.h"
+#include "common/sinCos.h"
 
 
 
@@ -36,12 +38,26 @@ namespace static_meshes_3D {
 		return _height;
 	}
 
+	int Cylinder::getNumVerticesSide() const
+	{
+		return _numVerticesSide;
+	}
+
+	int Cylinder::getNumVerticesTopBottom() const
+	{
+		return _numVerticesTopBottom;
+	}
+
 	void Cylinder::initializeData()
 	{
 		if (_isInitialized) {
 			return;
 		}
 
+		// Bounds are known analytically, the sphere passes through the rims of both covers
+		_bounds = makeBoxBounds(glm::vec3(-_radius, -_height / 2.0f, -_radius), glm::vec3(_radius, _height / 2.0f, _radius));
+		_bounds.sphereRadius = glm::length(glm::vec2(_radius, _height / 2.0f));
+
 		// Calculate and cache numbers of vertices
 		_numVerticesSide = (_numSlices + 1) * 2;
 		_numVerticesTopBottom = _numSlices + 2;
@@ -49,58 +65,39 @@ namespace static_meshes_3D {
 
 		// Generate VAO and VBO for vertex attributes
 		glGenVertexArrays(1, &_vao);
-		glBindVertexArray(_vao);
+		GLStateCache::getInstance().bindVertexArray(_vao);
 		_vbo.createVBO(getVertexByteSize() * _numVerticesTotal);
 
 		// Pre-calculate sines / cosines for given number of slices
-		const auto sliceAngleStep = 2.0f * glm::pi<float>() / float(_numSlices);
-		auto currentSliceAngle = 0.0f;
-		std::vector<float> sines, cosines;
-		for (auto i = 0; i <= _numSlices; i++)
-		{
-			sines.push_back(sin(currentSliceAngle));
-			cosines.push_back(cos(currentSliceAngle));
-
-			// Update slice angle
-			currentSliceAngle += sliceAngleStep;
-		}
+		std::vector<float> sines(_numSlices + 1), cosines(_numSlices + 1);
+		SinCos::computeCircle(_numSlices, sines.data(), cosines.data());
 
+		// Attributes are written in place: side, top cover and bottom cover of every attribute, one block after another
 		if (hasPositions())
 		{
-			// Pre-calculate X and Z coordinates
-			std::vector<float> x;
-			std::vector<float> z;
-			for (auto i = 0; i <= _numSlices; i++)
-			{
-				x.push_back(cosines[i] * _radius);
-				z.push_back(sines[i] * _radius);
-			}
+			const auto halfHeight = _height / 2.0f;
+			auto positions = _vbo.allocateData<glm::vec3>(_numVerticesTotal);
 
 			// Add cylinder side vertices
 			for (auto i = 0; i <= _numSlices; i++)
 			{
-				const auto topPosition = glm::vec3(x[i], _height / 2.0f, z[i]);
-				const auto bottomPosition = glm::vec3(x[i], -_height / 2.0f, z[i]);
-				_vbo.addRawData(&topPosition, sizeof(glm::vec3));
-				_vbo.addRawData(&bottomPosition, sizeof(glm::vec3));
-			}
-
-			// Add top cylinder cover
-			glm::vec3 topCenterPosition(0.0f, _height / 2.0f, 0.0f);
-			_vbo.addRawData(&topCenterPosition, sizeof(glm::vec3));
-			for (auto i = 0; i <= _numSlices; i++)
-			{
-				const auto topPosition = glm::vec3(x[i], _height / 2.0f, z[i]);
-				_vbo.addRawData(&topPosition, sizeof(glm::vec3));
+				const auto x = cosines[i] * _radius;
+				const auto z = sines[i] * _radius;
+				positions[i * 2] = glm::vec3(x, halfHeight, z);
+				positions[i * 2 + 1] = glm::vec3(x, -halfHeight, z);
 			}
 
-			// Add bottom cylinder cover
-			glm::vec3 bottomCenterPosition(0.0f, -_height / 2.0f, 0.0f);
-			_vbo.addRawData(&bottomCenterPosition, sizeof(glm::vec3));
+			// Add top and bottom cylinder cover
+			auto topPositions = positions + _numVerticesSide;
+			auto bottomPositions = topPositions + _numVerticesTopBottom;
+			topPositions[0] = glm::vec3(0.0f, halfHeight, 0.0f);
+			bottomPositions[0] = glm::vec3(0.0f, -halfHeight, 0.0f);
 			for (auto i = 0; i <= _numSlices; i++)
 			{
-				const auto bottomPosition = glm::vec3(x[i], -_height / 2.0f, -z[i]);
-				_vbo.addRawData(&bottomPosition, sizeof(glm::vec3));
+				const auto x = cosines[i] * _radius;
+				const auto z = sines[i] * _radius;
+				topPositions[i + 1] = glm::vec3(x, halfHeight, z);
+				bottomPositions[i + 1] = glm::vec3(x, -halfHeight, -z);
 			}
 		}
 
@@ -109,42 +106,43 @@ namespace static_meshes_3D {
 			// Pre-calculate step size in texture coordinate U
 			// I have decided to map the texture twice around cylinder, looks fine
 			const auto sliceTextureStepU = 2.0f / float(_numSlices);
+			auto textureCoordinates = _vbo.allocateData<glm::vec2>(_numVerticesTotal);
 
 			auto currentSliceTexCoordU = 0.0f;
 			for (auto i = 0; i <= _numSlices; i++)
 			{
-				_vbo.addData(glm::vec2(currentSliceTexCoordU, 1.0f));
-				_vbo.addData(glm::vec2(currentSliceTexCoordU, 0.0f));
+				textureCoordinates[i * 2] = glm::vec2(currentSliceTexCoordU, 1.0f);
+				textureCoordinates[i * 2 + 1] = glm::vec2(currentSliceTexCoordU, 0.0f);
 
 				// Update texture coordinate of current slice 
 				currentSliceTexCoordU += sliceTextureStepU;
 			}
 
-			// Generate circle texture coordinates for cylinder top cover
-			glm::vec2 topBottomCenterTexCoord(0.5f, 0.5f);
-			_vbo.addData(topBottomCenterTexCoord);
-			for (auto i = 0; i <= _numSlices; i++) {
-				_vbo.addData(glm::vec2(topBottomCenterTexCoord.x + sines[i] * 0.5f, topBottomCenterTexCoord.y + cosines[i] * 0.5f));
-			}
-
-			// Generate circle texture coordinates for cylinder bottom cover
-			_vbo.addData(topBottomCenterTexCoord);
-			for (auto i = 0; i <= _numSlices; i++) {
-				_vbo.addData(glm::vec2(topBottomCenterTexCoord.x + sines[i] * 0.5f, topBottomCenterTexCoord.y - cosines[i] * 0.5f));
+			// Generate circle texture coordinates for cylinder top and bottom cover
+			const glm::vec2 topBottomCenterTexCoord(0.5f, 0.5f);
+			auto topTextureCoordinates = textureCoordinates + _numVerticesSide;
+			auto bottomTextureCoordinates = topTextureCoordinates + _numVerticesTopBottom;
+			topTextureCoordinates[0] = topBottomCenterTexCoord;
+			bottomTextureCoordinates[0] = topBottomCenterTexCoord;
+			for (auto i = 0; i <= _numSlices; i++)
+			{
+				topTextureCoordinates[i + 1] = glm::vec2(topBottomCenterTexCoord.x + sines[i] * 0.5f, topBottomCenterTexCoord.y + cosines[i] * 0.5f);
+				bottomTextureCoordinates[i + 1] = glm::vec2(topBottomCenterTexCoord.x + sines[i] * 0.5f, topBottomCenterTexCoord.y - cosines[i] * 0.5f);
 			}
 		}
 
 		if (hasNormals())
 		{
-			for (auto i = 0; i <= _numSlices; i++) {
-				_vbo.addData(glm::vec3(cosines[i], 0.0f, sines[i]), 2);
+			auto normals = _vbo.allocateData<glm::vec3>(_numVerticesTotal);
+			for (auto i = 0; i <= _numSlices; i++)
+			{
+				normals[i * 2] = glm::vec3(cosines[i], 0.0f, sines[i]);
+				normals[i * 2 + 1] = normals[i * 2];
 			}
 
-			// Add normal for every vertex of cylinder top cover
-			_vbo.addData(glm::vec3(0.0f, 1.0f, 0.0f), _numVerticesTopBottom);
-
-			// Add normal for every vertex of cylinder bottom cover
-			_vbo.addData(glm::vec3(0.0f, -1.0f, 0.0f), _numVerticesTopBottom);
+			// Add normal for every vertex of cylinder top and bottom cover
+			std::fill_n(normals + _numVerticesSide, _numVerticesTopBottom, glm::vec3(0.0f, 1.0f, 0.0f));
+			std::fill_n(normals + _numVerticesSide + _numVerticesTopBottom, _numVerticesTopBottom, glm::vec3(0.0f, -1.0f, 0.0f));
 		}
 
 		// Finally upload data to the GPU
@@ -161,7 +159,7 @@ namespace static_meshes_3D {
 			return;
 		}
 
-		glBindVertexArray(_vao);
+		GLStateCache::getInstance().bindVertexArray(_vao);
 
 		// Render cylinder side first
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, _numVerticesSide);
@@ -180,7 +178,7 @@ namespace static_meshes_3D {
 		}
 
 		// Just render all points as they are stored in the VBO
-		glBindVertexArray(_vao);
+		GLStateCache::getInstance().bindVertexArray(_vao);
 		glDrawArrays(GL_POINTS, 0, _numVerticesTotal);
 	}
 
@@ -30,6 +30,16 @@ namespace static_meshes_3D {
 		 */
 		float getHeight() const;
 
+		/**
+		 * Gets number of vertices of the side triangle strip (starts at vertex 0).
+		 */
+		int getNumVerticesSide() const;
+
+		/**
+		 * Gets number of vertices of one cover triangle fan (top starts right after side, bottom after top).
+		 */
+		int getNumVerticesTopBottom() const;
+
 	private:
 		float _radius; // Cylinder radius (distance from the center of cylinder to surface)
 		int _numSlices; // Number of cylinder slices
@@ -0,0 +1,210 @@
+// STL
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+// Project
+#include "common/frustumCuller.h"
+#include "common/profiler.h"
+
+const int FrustumCuller::BATCH_SIZE;
+
+void FrustumCuller::setNumObjects(size_t numObjects)
+{
+    // Padding objects are tested too, their results are dropped
+    const auto paddedSize = (numObjects + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+    for (auto array : { &_boxCenterX, &_boxCenterY, &_boxCenterZ, &_boxExtentX, &_boxExtentY, &_boxExtentZ,
+        &_sphereCenterX, &_sphereCenterY, &_sphereCenterZ, &_sphereRadius }) {
+        array->resize(paddedSize, 0.0f);
+    }
+    _numObjects = numObjects;
+}
+
+size_t FrustumCuller::getNumObjects() const
+{
+    return _numObjects;
+}
+
+void FrustumCuller::setBounds(uint32_t index, const Bounds& worldBounds)
+{
+    const auto center = (worldBounds.boxMin + worldBounds.boxMax) * 0.5f;
+    const auto extent = (worldBounds.boxMax - worldBounds.boxMin) * 0.5f;
+    _boxCenterX[index] = center.x;
+    _boxCenterY[index] = center.y;
+    _boxCenterZ[index] = center.z;
+    _boxExtentX[index] = extent.x;
+    _boxExtentY[index] = extent.y;
+    _boxExtentZ[index] = extent.z;
+    _sphereCenterX[index] = worldBounds.sphereCenter.x;
+    _sphereCenterY[index] = worldBounds.sphereCenter.y;
+    _sphereCenterZ[index] = worldBounds.sphereCenter.z;
+    _sphereRadius[index] = worldBounds.sphereRadius;
+}
+
+void FrustumCuller::setFrustum(const glm::mat4& viewProjection)
+{
+    // Rows of the (column-major) matrix
+    const auto row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    const auto row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    const auto row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    const auto row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    _planes[0] = row3 + row0; // Left
+    _planes[1] = row3 - row0; // Right
+    _planes[2] = row3 + row1; // Bottom
+    _planes[3] = row3 - row1; // Top
+    _planes[4] = row3 + row2; // Near
+    _planes[5] = row3 - row2; // Far
+
+    // Normalized planes give true distances, which the sphere radius is compared to
+    for (auto& plane : _planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+const glm::vec4* FrustumCuller::getPlanes() const
+{
+    return _planes;
+}
+
+const std::vector<uint32_t>& FrustumCuller::cull()
+{
+    PROFILE_SCOPE("FrustumCuller::cull");
+    _visibleObjects.clear();
+    cullRange(0, _numObjects, _visibleObjects);
+    return _visibleObjects;
+}
+
+void FrustumCuller::cullRange(size_t firstObject, size_t numObjects, std::vector<uint32_t>& visibleObjects) const
+{
+    // Batches stay aligned, lanes outside the range are dropped
+    const auto lastObject = std::min(firstObject + numObjects, _numObjects);
+    for (size_t base = firstObject - firstObject % BATCH_SIZE; base < lastObject; base += BATCH_SIZE)
+    {
+        unsigned int visibleMask = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+        const auto zero = _mm256_setzero_ps();
+        const auto boxCenterX = _mm256_loadu_ps(&_boxCenterX[base]);
+        const auto boxCenterY = _mm256_loadu_ps(&_boxCenterY[base]);
+        const auto boxCenterZ = _mm256_loadu_ps(&_boxCenterZ[base]);
+        const auto boxExtentX = _mm256_loadu_ps(&_boxExtentX[base]);
+        const auto boxExtentY = _mm256_loadu_ps(&_boxExtentY[base]);
+        const auto boxExtentZ = _mm256_loadu_ps(&_boxExtentZ[base]);
+        const auto sphereCenterX = _mm256_loadu_ps(&_sphereCenterX[base]);
+        const auto sphereCenterY = _mm256_loadu_ps(&_sphereCenterY[base]);
+        const auto sphereCenterZ = _mm256_loadu_ps(&_sphereCenterZ[base]);
+        const auto sphereRadius = _mm256_loadu_ps(&_sphereRadius[base]);
+
+        auto outside = zero;
+        for (const auto& plane : _planes)
+        {
+            const auto normalX = _mm256_set1_ps(plane.x);
+            const auto normalY = _mm256_set1_ps(plane.y);
+            const auto normalZ = _mm256_set1_ps(plane.z);
+            const auto distance = _mm256_set1_ps(plane.w);
+
+            // Box: signed distance of its center plus projection of its extent onto the normal
+            auto boxDistance = _mm256_add_ps(_mm256_mul_ps(normalX, boxCenterX), distance);
+            boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(normalY, boxCenterY));
+            boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(normalZ, boxCenterZ));
+            boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.x)), boxExtentX));
+            boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.y)), boxExtentY));
+            boxDistance = _mm256_add_ps(boxDistance, _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane.z)), boxExtentZ));
+
+            // Sphere: signed distance of its center plus radius
+            auto sphereDistance = _mm256_add_ps(_mm256_mul_ps(normalX, sphereCenterX), distance);
+            sphereDistance = _mm256_add_ps(sphereDistance, _mm256_mul_ps(normalY, sphereCenterY));
+            sphereDistance = _mm256_add_ps(sphereDistance, _mm256_mul_ps(normalZ, sphereCenterZ));
+            sphereDistance = _mm256_add_ps(sphereDistance, sphereRadius);
+
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(boxDistance, zero, _CMP_LT_OQ));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(sphereDistance, zero, _CMP_LT_OQ));
+        }
+        visibleMask = ~static_cast<unsigned int>(_mm256_movemask_ps(outside)) & 0xFF;
+#elif defined(FRUSTUM_CULLER_SSE)
+        // Batch of 8 as two halves of 4
+        for (size_t half = 0; half < 2; half++)
+        {
+            const auto first = base + half * 4;
+            const auto zero = _mm_setzero_ps();
+            const auto boxCenterX = _mm_loadu_ps(&_boxCenterX[first]);
+            const auto boxCenterY = _mm_loadu_ps(&_boxCenterY[first]);
+            const auto boxCenterZ = _mm_loadu_ps(&_boxCenterZ[first]);
+            const auto boxExtentX = _mm_loadu_ps(&_boxExtentX[first]);
+            const auto boxExtentY = _mm_loadu_ps(&_boxExtentY[first]);
+            const auto boxExtentZ = _mm_loadu_ps(&_boxExtentZ[first]);
+            const auto sphereCenterX = _mm_loadu_ps(&_sphereCenterX[first]);
+            const auto sphereCenterY = _mm_loadu_ps(&_sphereCenterY[first]);
+            const auto sphereCenterZ = _mm_loadu_ps(&_sphereCenterZ[first]);
+            const auto sphereRadius = _mm_loadu_ps(&_sphereRadius[first]);
+
+            auto outside = zero;
+            for (const auto& plane : _planes)
+            {
+                const auto normalX = _mm_set1_ps(plane.x);
+                const auto normalY = _mm_set1_ps(plane.y);
+                const auto normalZ = _mm_set1_ps(plane.z);
+                const auto distance = _mm_set1_ps(plane.w);
+
+                auto boxDistance = _mm_add_ps(_mm_mul_ps(normalX, boxCenterX), distance);
+                boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(normalY, boxCenterY));
+                boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(normalZ, boxCenterZ));
+                boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), boxExtentX));
+                boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), boxExtentY));
+                boxDistance = _mm_add_ps(boxDistance, _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), boxExtentZ));
+
+                auto sphereDistance = _mm_add_ps(_mm_mul_ps(normalX, sphereCenterX), distance);
+                sphereDistance = _mm_add_ps(sphereDistance, _mm_mul_ps(normalY, sphereCenterY));
+                sphereDistance = _mm_add_ps(sphereDistance, _mm_mul_ps(normalZ, sphereCenterZ));
+                sphereDistance = _mm_add_ps(sphereDistance, sphereRadius);
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(boxDistance, zero));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(sphereDistance, zero));
+            }
+            visibleMask |= (~static_cast<unsigned int>(_mm_movemask_ps(outside)) & 0xF) << (half * 4);
+        }
+#else
+        for (int lane = 0; lane < BATCH_SIZE; lane++)
+        {
+            if (isVisible(static_cast<uint32_t>(base + lane))) {
+                visibleMask |= 1u << lane;
+            }
+        }
+#endif
+
+        for (int lane = 0; lane < BATCH_SIZE && base + lane < lastObject; lane++)
+        {
+            if ((visibleMask & (1u << lane)) && base + lane >= firstObject) {
+                visibleObjects.push_back(static_cast<uint32_t>(base + lane));
+            }
+        }
+    }
+}
+
+glm::vec4 FrustumCuller::getSphere(uint32_t index) const
+{
+    return glm::vec4(_sphereCenterX[index], _sphereCenterY[index], _sphereCenterZ[index], _sphereRadius[index]);
+}
+
+bool FrustumCuller::isVisible(uint32_t index) const
+{
+    for (const auto& plane : _planes)
+    {
+        const auto boxDistance = plane.x * _boxCenterX[index] + plane.w + plane.y * _boxCenterY[index] + plane.z * _boxCenterZ[index]
+            + std::fabs(plane.x) * _boxExtentX[index] + std::fabs(plane.y) * _boxExtentY[index] + std::fabs(plane.z) * _boxExtentZ[index];
+        const auto sphereDistance = plane.x * _sphereCenterX[index] + plane.w + plane.y * _sphereCenterY[index] + plane.z * _sphereCenterZ[index]
+            + _sphereRadius[index];
+        if (boxDistance < 0.0f || sphereDistance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
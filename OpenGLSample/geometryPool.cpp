@@ -0,0 +1,240 @@
+// STL
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+// Project
+#include "common/geometryPool.h"
+#include "common/glStateCache.h"
+#include "common/uploadCounter.h"
+
+const GLuint GeometryPool::POSITION_ATTRIBUTE_INDEX;
+const GLuint GeometryPool::TEXTURE_COORDINATE_ATTRIBUTE_INDEX;
+const GLuint GeometryPool::NORMAL_ATTRIBUTE_INDEX;
+
+void GeometryPool::beginMesh()
+{
+    PoolMesh mesh;
+    mesh.firstIndex = static_cast<GLuint>(_indices.size());
+    mesh.baseVertex = static_cast<GLint>(_vertices.size());
+    _meshes.push_back(mesh);
+}
+
+bool GeometryPool::addDraw(GLuint vao, GLenum mode, GLint first, GLsizei count, GLenum indexType, uintptr_t indexByteOffset)
+{
+    if (_isPoolCreated || _meshes.empty())
+    {
+        std::cerr << "Draws can be added only between beginMesh and endMesh, before the geometry pool is created!" << std::endl;
+        return false;
+    }
+    if (mode != GL_TRIANGLES && mode != GL_TRIANGLE_STRIP && mode != GL_TRIANGLE_FAN)
+    {
+        std::cerr << "Geometry pool does not support primitive type " << mode << "!" << std::endl;
+        return false;
+    }
+    if (count <= 0) {
+        return true;
+    }
+
+    auto& glState = GLStateCache::getInstance();
+    glState.bindVertexArray(vao);
+
+    // Vertices of the draw in drawing order
+    std::vector<GLuint> drawVertices(count);
+    if (indexType == 0)
+    {
+        for (GLsizei i = 0; i < count; i++) {
+            drawVertices[i] = static_cast<GLuint>(first + i);
+        }
+    }
+    else
+    {
+        const size_t indexSize = indexType == GL_UNSIGNED_INT ? 4 : indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+        GLint elementBufferID = 0;
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBufferID);
+        _bufferData.resize(count * indexSize);
+        glState.bindBuffer(GL_COPY_READ_BUFFER, static_cast<GLuint>(elementBufferID));
+        glGetBufferSubData(GL_COPY_READ_BUFFER, indexByteOffset, _bufferData.size(), _bufferData.data());
+        for (GLsizei i = 0; i < count; i++)
+        {
+            uint32_t index32 = 0;
+            uint16_t index16 = 0;
+            switch (indexSize)
+            {
+            case 4: memcpy(&index32, &_bufferData[i * 4], 4); break;
+            case 2: memcpy(&index16, &_bufferData[i * 2], 2); index32 = index16; break;
+            default: index32 = _bufferData[i]; break;
+            }
+            drawVertices[i] = index32;
+        }
+    }
+
+    // Only the range of vertices the draw references is copied
+    const auto range = std::minmax_element(drawVertices.begin(), drawVertices.end());
+    const auto firstVertex = *range.first;
+    const auto numVertices = *range.second - firstVertex + 1;
+    std::vector<glm::vec4> positions, textureCoordinates, normals;
+    if (!readAttribute(POSITION_ATTRIBUTE_INDEX, firstVertex, numVertices, positions)
+        || !readAttribute(TEXTURE_COORDINATE_ATTRIBUTE_INDEX, firstVertex, numVertices, textureCoordinates)
+        || !readAttribute(NORMAL_ATTRIBUTE_INDEX, firstVertex, numVertices, normals)) {
+        return false;
+    }
+
+    const auto drawBaseVertex = static_cast<GLuint>(_vertices.size() - _meshes.back().baseVertex);
+    for (GLuint i = 0; i < numVertices; i++) {
+        _vertices.push_back({ glm::vec3(positions[i]), glm::vec2(textureCoordinates[i].x, textureCoordinates[i].y), glm::vec3(normals[i]) });
+    }
+
+    // Triangle lists, with the vertex order of OpenGL's strip and fan decomposition
+    auto addTriangle = [&](GLsizei a, GLsizei b, GLsizei c)
+    {
+        _indices.push_back(drawBaseVertex + drawVertices[a] - firstVertex);
+        _indices.push_back(drawBaseVertex + drawVertices[b] - firstVertex);
+        _indices.push_back(drawBaseVertex + drawVertices[c] - firstVertex);
+    };
+    switch (mode)
+    {
+    case GL_TRIANGLES:
+        for (GLsizei i = 0; i + 2 < count; i += 3) {
+            addTriangle(i, i + 1, i + 2);
+        }
+        break;
+    case GL_TRIANGLE_STRIP:
+        for (GLsizei i = 0; i + 2 < count; i++)
+        {
+            if (i % 2 == 0) {
+                addTriangle(i, i + 1, i + 2);
+            }
+            else {
+                addTriangle(i + 1, i, i + 2);
+            }
+        }
+        break;
+    default:
+        for (GLsizei i = 0; i + 2 < count; i++) {
+            addTriangle(0, i + 1, i + 2);
+        }
+        break;
+    }
+    return true;
+}
+
+uint32_t GeometryPool::endMesh()
+{
+    auto& mesh = _meshes.back();
+    mesh.numIndices = static_cast<GLuint>(_indices.size()) - mesh.firstIndex;
+    return static_cast<uint32_t>(_meshes.size() - 1);
+}
+
+void GeometryPool::createPool()
+{
+    if (_isPoolCreated)
+    {
+        std::cerr << "This geometry pool is already created! You need to delete it before re-creating it!" << std::endl;
+        return;
+    }
+
+    auto& glState = GLStateCache::getInstance();
+    glGenVertexArrays(1, &_vao);
+    glGenBuffers(1, &_vertexBufferID);
+    glGenBuffers(1, &_indexBufferID);
+
+    glState.bindVertexArray(_vao);
+    glState.bindBuffer(GL_ARRAY_BUFFER, _vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(PoolVertex), _vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBufferID); // Element buffer is state of the VAO
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(GLuint), _indices.data(), GL_STATIC_DRAW);
+    UploadCounter::getInstance().addBytes(_vertices.size() * sizeof(PoolVertex) + _indices.size() * sizeof(GLuint));
+
+    const auto stride = static_cast<GLsizei>(sizeof(PoolVertex));
+    glEnableVertexAttribArray(POSITION_ATTRIBUTE_INDEX);
+    glVertexAttribPointer(POSITION_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(PoolVertex, position)));
+    glEnableVertexAttribArray(TEXTURE_COORDINATE_ATTRIBUTE_INDEX);
+    glVertexAttribPointer(TEXTURE_COORDINATE_ATTRIBUTE_INDEX, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(PoolVertex, textureCoordinate)));
+    glEnableVertexAttribArray(NORMAL_ATTRIBUTE_INDEX);
+    glVertexAttribPointer(NORMAL_ATTRIBUTE_INDEX, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(PoolVertex, normal)));
+
+    _vertices = std::vector<PoolVertex>();
+    _indices = std::vector<GLuint>();
+    _bufferData = std::vector<uint8_t>();
+    _isPoolCreated = true;
+}
+
+size_t GeometryPool::getNumMeshes() const
+{
+    return _meshes.size();
+}
+
+const PoolMesh& GeometryPool::getMesh(uint32_t index) const
+{
+    return _meshes[index];
+}
+
+GLuint GeometryPool::getVAO() const
+{
+    return _vao;
+}
+
+void GeometryPool::deletePool()
+{
+    if (_isPoolCreated)
+    {
+        auto& glState = GLStateCache::getInstance();
+        glDeleteVertexArrays(1, &_vao);
+        glDeleteBuffers(1, &_vertexBufferID);
+        glDeleteBuffers(1, &_indexBufferID);
+        glState.forgetVertexArray(_vao);
+        glState.forgetBuffer(_vertexBufferID);
+        glState.forgetBuffer(_indexBufferID);
+        _isPoolCreated = false;
+    }
+
+    _meshes.clear();
+    _vertices.clear();
+    _indices.clear();
+}
+
+bool GeometryPool::readAttribute(GLuint attributeIndex, GLuint firstVertex, GLuint numVertices, std::vector<glm::vec4>& values)
+{
+    GLint isEnabled = 0;
+    glGetVertexAttribiv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &isEnabled);
+    if (!isEnabled)
+    {
+        // Disabled attribute reads the same value for every vertex
+        glm::vec4 value;
+        glGetVertexAttribfv(attributeIndex, GL_CURRENT_VERTEX_ATTRIB, &value.x);
+        values.assign(numVertices, value);
+        return true;
+    }
+
+    GLint bufferID = 0, size = 0, stride = 0, type = 0, isInteger = 0;
+    void* pointer = nullptr;
+    glGetVertexAttribiv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &bufferID);
+    glGetVertexAttribiv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_SIZE, &size);
+    glGetVertexAttribiv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+    glGetVertexAttribiv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+    glGetVertexAttribiv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &isInteger);
+    glGetVertexAttribPointerv(attributeIndex, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+    if (type != GL_FLOAT || isInteger || size < 1 || size > 4)
+    {
+        std::cerr << "Geometry pool supports only float vertex attributes, attribute " << attributeIndex << " has type " << type << "!" << std::endl;
+        return false;
+    }
+
+    const auto elementSize = static_cast<size_t>(size) * sizeof(float);
+    const auto vertexStride = stride != 0 ? static_cast<size_t>(stride) : elementSize;
+    const auto offset = reinterpret_cast<uintptr_t>(pointer) + firstVertex * vertexStride;
+    _bufferData.resize((numVertices - 1) * vertexStride + elementSize);
+    GLStateCache::getInstance().bindBuffer(GL_COPY_READ_BUFFER, static_cast<GLuint>(bufferID));
+    glGetBufferSubData(GL_COPY_READ_BUFFER, offset, _bufferData.size(), _bufferData.data());
+
+    values.resize(numVertices);
+    for (GLuint i = 0; i < numVertices; i++)
+    {
+        glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+        memcpy(&value.x, &_bufferData[i * vertexStride], elementSize);
+        values[i] = value;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+// STL
+#include <cstring>
+
+// Project
+#include "common/geometryRegistry.h"
+#include "common/profiler.h"
+
+bool GeometryKey::operator==(const GeometryKey& other) const
+{
+    return primitive == other.primitive
+        && tessellation[0] == other.tessellation[0]
+        && tessellation[1] == other.tessellation[1]
+        && shape == other.shape
+        && attributes == other.attributes;
+}
+
+size_t GeometryRegistry::KeyHash::operator()(const GeometryKey& key) const
+{
+    uint32_t words[5] = { key.primitive, static_cast<uint32_t>(key.tessellation[0]), static_cast<uint32_t>(key.tessellation[1]), 0, key.attributes };
+    std::memcpy(&words[3], &key.shape, sizeof(float));
+
+    uint64_t hash = 14695981039346656037ull;
+    for (const uint32_t word : words)
+    {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+GeometryHandle GeometryRegistry::acquire(const GeometryKey& key, const Factory& createGeometry)
+{
+    PROFILE_SCOPE("GeometryRegistry::acquire");
+    auto it = _geometries.find(key);
+    if (it != _geometries.end())
+    {
+        if (auto geometry = it->second.lock())
+        {
+            _numHits++;
+            return geometry;
+        }
+    }
+
+    auto geometry = std::make_shared<SharedGeometry>();
+    if (!createGeometry(*geometry)) {
+        return GeometryHandle();
+    }
+    _numCreations++;
+    _geometries[key] = geometry;
+    return geometry;
+}
+
+void GeometryRegistry::collectGarbage()
+{
+    for (auto it = _geometries.begin(); it != _geometries.end();)
+    {
+        if (it->second.expired()) {
+            it = _geometries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+size_t GeometryRegistry::getNumGeometries() const
+{
+    size_t numGeometries = 0;
+    for (const auto& entry : _geometries)
+    {
+        if (!entry.second.expired()) {
+            numGeometries++;
+        }
+    }
+    return numGeometries;
+}
+
+size_t GeometryRegistry::getNumCreations() const
+{
+    return _numCreations;
+}
+
+size_t GeometryRegistry::getNumHits() const
+{
+    return _numHits;
+}
@@ -0,0 +1,246 @@
+// Project
+#include "common/glStateCache.h"
+
+GLStateCache& GLStateCache::getInstance()
+{
+    // The application uses a single OpenGL context
+    static GLStateCache instance;
+    return instance;
+}
+
+GLStateCache::GLStateCache()
+{
+    invalidate();
+}
+
+void GLStateCache::useProgram(GLuint programID)
+{
+    if (_programID == programID)
+    {
+        _stats.numSkippedBinds++;
+        return;
+    }
+
+    glUseProgram(programID);
+    _programID = programID;
+    _stats.numBinds++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (_vao == vao)
+    {
+        _stats.numSkippedBinds++;
+        return;
+    }
+
+    glBindVertexArray(vao);
+    _vao = vao;
+    _stats.numBinds++;
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint bufferID)
+{
+    const auto targetIndex = getBufferTargetIndex(target);
+    if (targetIndex >= 0 && _buffers[targetIndex] == bufferID)
+    {
+        _stats.numSkippedBinds++;
+        return;
+    }
+
+    glBindBuffer(target, bufferID);
+    if (targetIndex >= 0) {
+        _buffers[targetIndex] = bufferID;
+    }
+    _stats.numBinds++;
+}
+
+void GLStateCache::activeTexture(GLenum unit)
+{
+    if (_activeTextureUnit == unit)
+    {
+        _stats.numSkippedBinds++;
+        return;
+    }
+
+    glActiveTexture(unit);
+    _activeTextureUnit = unit;
+    _stats.numBinds++;
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint textureID)
+{
+    const auto unitIndex = _activeTextureUnit - GL_TEXTURE0;
+    const auto isShadowed = _activeTextureUnit != UNKNOWN && unitIndex < MAX_TEXTURE_UNITS;
+    if (isShadowed && _textures[unitIndex].target == target && _textures[unitIndex].textureID == textureID)
+    {
+        _stats.numSkippedBinds++;
+        return;
+    }
+
+    glBindTexture(target, textureID);
+    if (isShadowed) {
+        _textures[unitIndex] = { target, textureID };
+    }
+    _stats.numBinds++;
+}
+
+void GLStateCache::bindTextureToUnit(GLuint unit, GLenum target, GLuint textureID)
+{
+    if (unit < MAX_TEXTURE_UNITS && _textures[unit].target == target && _textures[unit].textureID == textureID)
+    {
+        _stats.numSkippedBinds++;
+        return;
+    }
+
+    activeTexture(GL_TEXTURE0 + unit);
+    bindTexture(target, textureID);
+}
+
+void GLStateCache::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLStateCache::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLStateCache::blendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+    if (_blendSourceFactor == sourceFactor && _blendDestinationFactor == destinationFactor)
+    {
+        _stats.numSkippedStateChanges++;
+        return;
+    }
+
+    glBlendFunc(sourceFactor, destinationFactor);
+    _blendSourceFactor = sourceFactor;
+    _blendDestinationFactor = destinationFactor;
+    _stats.numStateChanges++;
+}
+
+void GLStateCache::depthFunc(GLenum function)
+{
+    if (_depthFunction == function)
+    {
+        _stats.numSkippedStateChanges++;
+        return;
+    }
+
+    glDepthFunc(function);
+    _depthFunction = function;
+    _stats.numStateChanges++;
+}
+
+void GLStateCache::depthMask(GLboolean flag)
+{
+    if (_depthMask == flag)
+    {
+        _stats.numSkippedStateChanges++;
+        return;
+    }
+
+    glDepthMask(flag);
+    _depthMask = flag;
+    _stats.numStateChanges++;
+}
+
+void GLStateCache::invalidate()
+{
+    _programID = UNKNOWN;
+    _vao = UNKNOWN;
+    for (auto& bufferID : _buffers) {
+        bufferID = UNKNOWN;
+    }
+    _activeTextureUnit = UNKNOWN;
+    for (auto& binding : _textures) {
+        binding = { UNKNOWN, UNKNOWN };
+    }
+    _capabilities.clear();
+    _blendSourceFactor = UNKNOWN;
+    _blendDestinationFactor = UNKNOWN;
+    _depthFunction = UNKNOWN;
+    _depthMask = UNKNOWN;
+}
+
+void GLStateCache::forgetProgram(GLuint programID)
+{
+    if (_programID == programID) {
+        _programID = UNKNOWN;
+    }
+}
+
+void GLStateCache::forgetVertexArray(GLuint vao)
+{
+    if (_vao == vao) {
+        _vao = UNKNOWN;
+    }
+}
+
+void GLStateCache::forgetBuffer(GLuint bufferID)
+{
+    for (auto& boundBufferID : _buffers)
+    {
+        if (boundBufferID == bufferID) {
+            boundBufferID = UNKNOWN;
+        }
+    }
+}
+
+void GLStateCache::forgetTexture(GLuint textureID)
+{
+    for (auto& binding : _textures)
+    {
+        if (binding.textureID == textureID) {
+            binding = { UNKNOWN, UNKNOWN };
+        }
+    }
+}
+
+const GLStateCacheStats& GLStateCache::getStats() const
+{
+    return _stats;
+}
+
+void GLStateCache::resetStats()
+{
+    _stats = GLStateCacheStats();
+}
+
+int GLStateCache::getBufferTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_UNIFORM_BUFFER: return 1;
+    case GL_COPY_READ_BUFFER: return 2;
+    case GL_COPY_WRITE_BUFFER: return 3;
+    case GL_PIXEL_PACK_BUFFER: return 4;
+    case GL_PIXEL_UNPACK_BUFFER: return 5;
+    case GL_DRAW_INDIRECT_BUFFER: return 6;
+    case GL_SHADER_STORAGE_BUFFER: return 7;
+    case GL_DISPATCH_INDIRECT_BUFFER: return 8;
+    default: return -1; // GL_ELEMENT_ARRAY_BUFFER belongs to VAO, others are not shadowed
+    }
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+    auto it = _capabilities.find(capability);
+    if (it != _capabilities.end() && it->second == enabled)
+    {
+        _stats.numSkippedStateChanges++;
+        return;
+    }
+
+    if (enabled) {
+        glEnable(capability);
+    }
+    else {
+        glDisable(capability);
+    }
+    _capabilities[capability] = enabled;
+    _stats.numStateChanges++;
+}
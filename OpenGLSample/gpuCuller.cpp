@@ -0,0 +1,282 @@
+// STL
+#include <algorithm>
+#include <iostream>
+
+// Project
+#include "common/gpuCuller.h"
+#include "common/glStateCache.h"
+#include "common/profiler.h"
+#include "common/uniformTable.h"
+#include "common/uploadCounter.h"
+
+const GLuint GpuCuller::OBJECT_BUFFER_BINDING;
+const GLuint GpuCuller::COMMAND_BUFFER_BINDING;
+const GLuint GpuCuller::OBJECT_ID_BUFFER_BINDING;
+const GLuint GpuCuller::OBJECT_ID_ATTRIBUTE_INDEX;
+const GLuint GpuCuller::WORK_GROUP_SIZE;
+const GLuint GpuCuller::NO_COMMAND;
+
+namespace {
+
+// Same test as FrustumCuller: object is culled when its box or its sphere is completely behind one of the planes.
+// Visible object takes next slot in the object ID range of its command.
+const char* CULL_SHADER_SOURCE = "#version 430 core\n"
+GPU_OBJECT_BUFFER_GLSL
+"layout (local_size_x = 64) in;\n"
+"struct DrawCommand {\n"
+"    uint count;\n"
+"    uint instanceCount;\n"
+"    uint firstIndex;\n"
+"    int baseVertex;\n"
+"    uint baseInstance;\n"
+"};\n"
+"layout (std430, binding = 1) buffer DrawCommandBuffer {\n"
+"    DrawCommand commands[];\n"
+"};\n"
+"layout (std430, binding = 2) writeonly buffer ObjectIdBuffer {\n"
+"    uint objectIds[];\n"
+"};\n"
+"uniform vec4 frustumPlanes[6];\n"
+"uniform uint numObjects;\n"
+"void main() {\n"
+"    uint index = gl_GlobalInvocationID.x;\n"
+"    if (index >= numObjects || objects[index].command == 0xFFFFFFFFu) {\n"
+"        return;\n"
+"    }\n"
+"    vec3 boxCenter = objects[index].boxCenter.xyz;\n"
+"    vec3 boxExtent = objects[index].boxExtent.xyz;\n"
+"    vec4 sphere = objects[index].sphere;\n"
+"    for (int i = 0; i < 6; i++) {\n"
+"        vec4 plane = frustumPlanes[i];\n"
+"        float boxDistance = dot(plane.xyz, boxCenter) + plane.w + dot(abs(plane.xyz), boxExtent);\n"
+"        float sphereDistance = dot(plane.xyz, sphere.xyz) + plane.w + sphere.w;\n"
+"        if (boxDistance < 0.0 || sphereDistance < 0.0) {\n"
+"            return;\n"
+"        }\n"
+"    }\n"
+"    uint command = objects[index].command;\n"
+"    uint slot = atomicAdd(commands[command].instanceCount, 1u);\n"
+"    objectIds[commands[command].baseInstance + slot] = index;\n"
+"}\n";
+
+} // namespace
+
+bool GpuCuller::isSupported()
+{
+    GLint majorVersion = 0, minorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    return majorVersion > 4 || (majorVersion == 4 && minorVersion >= 3);
+}
+
+GLuint GpuCuller::addCommand(const PoolMesh& mesh, GLuint maxInstances)
+{
+    if (_isCullerCreated)
+    {
+        std::cerr << "Commands cannot be added to GPU culler, that is already created!" << std::endl;
+        return NO_COMMAND;
+    }
+
+    DrawElementsIndirectCommand command = {};
+    command.count = mesh.numIndices;
+    command.instanceCount = 0;
+    command.firstIndex = mesh.firstIndex;
+    command.baseVertex = mesh.baseVertex;
+    command.baseInstance = _numObjectIds;
+    _commands.push_back(command);
+    _numObjectIds += maxInstances;
+    return static_cast<GLuint>(_commands.size() - 1);
+}
+
+void GpuCuller::setNumObjects(size_t numObjects)
+{
+    GpuObjectData object = {};
+    object.model = glm::mat4(1.0f);
+    object.command = NO_COMMAND;
+    _objects.resize(numObjects, object);
+    if (numObjects > 0)
+    {
+        markDirty(0);
+        markDirty(numObjects - 1);
+    }
+}
+
+void GpuCuller::setObjectCommand(uint32_t index, GLuint command, GLint materialIndex, GLint textureLayer)
+{
+    _objects[index].command = command;
+    _objects[index].materialIndex = materialIndex;
+    _objects[index].textureLayer = textureLayer;
+    markDirty(index);
+}
+
+void GpuCuller::setObjectTransform(uint32_t index, const glm::mat4& model, const Bounds& worldBounds)
+{
+    auto& object = _objects[index];
+    object.model = model;
+    object.boxCenter = glm::vec4((worldBounds.boxMin + worldBounds.boxMax) * 0.5f, 0.0f);
+    object.boxExtent = glm::vec4((worldBounds.boxMax - worldBounds.boxMin) * 0.5f, 0.0f);
+    object.sphere = glm::vec4(worldBounds.sphereCenter, worldBounds.sphereRadius);
+    markDirty(index);
+}
+
+bool GpuCuller::createCuller(GLuint vao)
+{
+    if (_isCullerCreated)
+    {
+        std::cerr << "This GPU culler is already created! You need to delete it before re-creating it!" << std::endl;
+        return false;
+    }
+
+    // Culling shader
+    const auto shaderID = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(shaderID, 1, &CULL_SHADER_SOURCE, nullptr);
+    glCompileShader(shaderID);
+    GLint isCompiled = 0;
+    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &isCompiled);
+    if (!isCompiled)
+    {
+        GLchar infoLog[512];
+        glGetShaderInfoLog(shaderID, sizeof(infoLog), nullptr, infoLog);
+        std::cerr << "Cannot compile GPU culling shader: " << infoLog << std::endl;
+        glDeleteShader(shaderID);
+        return false;
+    }
+
+    _programID = glCreateProgram();
+    glAttachShader(_programID, shaderID);
+    glLinkProgram(_programID);
+    glDeleteShader(shaderID);
+    GLint isLinked = 0;
+    glGetProgramiv(_programID, GL_LINK_STATUS, &isLinked);
+    if (!isLinked)
+    {
+        GLchar infoLog[512];
+        glGetProgramInfoLog(_programID, sizeof(infoLog), nullptr, infoLog);
+        std::cerr << "Cannot link GPU culling shader: " << infoLog << std::endl;
+        glDeleteProgram(_programID);
+        _programID = 0;
+        return false;
+    }
+    UniformTable uniforms;
+    uniforms.reflectProgram(_programID);
+    _planesLocation = uniforms.getLocation(uniformKey("frustumPlanes"));
+    _numObjectsLocation = uniforms.getLocation(uniformKey("numObjects"));
+
+    // Buffers, the binding points are global state and keep the buffers for both culling and drawing
+    auto& glState = GLStateCache::getInstance();
+    glGenBuffers(1, &_objectBufferID);
+    glGenBuffers(1, &_commandBufferID);
+    glGenBuffers(1, &_commandTemplateBufferID);
+    glGenBuffers(1, &_objectIdBufferID);
+
+    const auto objectsSizeBytes = std::max<size_t>(_objects.size(), 1) * sizeof(GpuObjectData);
+    const auto commandsSizeBytes = std::max<size_t>(_commands.size(), 1) * sizeof(DrawElementsIndirectCommand);
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, _objectBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, objectsSizeBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BUFFER_BINDING, _objectBufferID);
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, _commandBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, commandsSizeBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BUFFER_BINDING, _commandBufferID);
+    glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, _objectIdBufferID);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<GLuint>(_numObjectIds, 1) * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_ID_BUFFER_BINDING, _objectIdBufferID);
+    glState.bindBuffer(GL_COPY_READ_BUFFER, _commandTemplateBufferID);
+    glBufferData(GL_COPY_READ_BUFFER, commandsSizeBytes, _commands.data(), GL_STATIC_DRAW);
+    UploadCounter::getInstance().addBytes(_commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    // Object ID of every drawn instance, base instance of the command offsets it to the range of the command
+    glState.bindVertexArray(vao);
+    glState.bindBuffer(GL_ARRAY_BUFFER, _objectIdBufferID);
+    glEnableVertexAttribArray(OBJECT_ID_ATTRIBUTE_INDEX);
+    glVertexAttribIPointer(OBJECT_ID_ATTRIBUTE_INDEX, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+    glVertexAttribDivisor(OBJECT_ID_ATTRIBUTE_INDEX, 1);
+
+    _isCullerCreated = true;
+    return true;
+}
+
+void GpuCuller::cull(const glm::vec4* planes)
+{
+    if (!_isCullerCreated || _commands.empty()) {
+        return;
+    }
+
+    PROFILE_SCOPE("GPU cull");
+    auto& glState = GLStateCache::getInstance();
+    if (_dirtyBegin != _dirtyEnd)
+    {
+        // Only the range covering changed objects is sent, e.g. one moved subtree
+        const auto offsetBytes = _dirtyBegin * sizeof(GpuObjectData);
+        const auto dataSizeBytes = (_dirtyEnd - _dirtyBegin) * sizeof(GpuObjectData);
+        glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, _objectBufferID);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetBytes, dataSizeBytes, _objects.data() + _dirtyBegin);
+        UploadCounter::getInstance().addBytes(dataSizeBytes);
+        _dirtyBegin = 0;
+        _dirtyEnd = 0;
+    }
+
+    // Instance counts start from zero, the copy stays on the GPU
+    glState.bindBuffer(GL_COPY_READ_BUFFER, _commandTemplateBufferID);
+    glState.bindBuffer(GL_COPY_WRITE_BUFFER, _commandBufferID);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, _commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    const auto numObjects = static_cast<GLuint>(_objects.size());
+    glState.useProgram(_programID);
+    glUniform4fv(_planesLocation, 6, &planes[0].x);
+    glUniform1ui(_numObjectsLocation, numObjects);
+    glDispatchCompute((numObjects + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1);
+
+    // Commands are read by indirect draws, object IDs as vertex attributes
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+GLuint GpuCuller::getCommandBufferID() const
+{
+    return _commandBufferID;
+}
+
+size_t GpuCuller::getNumCommands() const
+{
+    return _commands.size();
+}
+
+bool GpuCuller::isCreated() const
+{
+    return _isCullerCreated;
+}
+
+void GpuCuller::deleteCuller()
+{
+    if (_isCullerCreated)
+    {
+        auto& glState = GLStateCache::getInstance();
+        glDeleteProgram(_programID);
+        glState.forgetProgram(_programID);
+        const GLuint buffers[] = { _objectBufferID, _commandBufferID, _commandTemplateBufferID, _objectIdBufferID };
+        glDeleteBuffers(4, buffers);
+        for (const auto bufferID : buffers) {
+            glState.forgetBuffer(bufferID);
+        }
+        _programID = 0;
+        _isCullerCreated = false;
+    }
+
+    _commands.clear();
+    _objects.clear();
+    _numObjectIds = 0;
+    _dirtyBegin = 0;
+    _dirtyEnd = 0;
+}
+
+void GpuCuller::markDirty(size_t index)
+{
+    if (_dirtyBegin == _dirtyEnd)
+    {
+        _dirtyBegin = index;
+        _dirtyEnd = index + 1;
+        return;
+    }
+
+    _dirtyBegin = std::min(_dirtyBegin, index);
+    _dirtyEnd = std::max(_dirtyEnd, index + 1);
+}
@@ -0,0 +1,268 @@
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// Project
+#include "common/gpuProfiler.h"
+#include "common/profiler.h"
+
+namespace {
+
+// Same clock as CPU profiler zones, so that both end up on one timeline
+int64_t cpuNanoseconds()
+{
+#if PROFILER_ENABLED
+    return Profiler::getInstance().now();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+} // namespace
+
+bool GPUProfiler::NameLess::operator()(const char* a, const char* b) const
+{
+    return strcmp(a, b) < 0;
+}
+
+bool GPUProfiler::createGPUProfiler()
+{
+    if (_isCreated) {
+        return true;
+    }
+
+    GLint counterBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+    if (counterBits == 0)
+    {
+        std::cerr << "GPU timestamp queries are not supported, GPU profiler is disabled!" << std::endl;
+        return false;
+    }
+
+    for (auto& frame : _frames) {
+        glGenQueries(MAX_QUERIES_PER_FRAME, frame.queries);
+    }
+    calibrate();
+    _isCreated = true;
+    return true;
+}
+
+void GPUProfiler::beginFrame()
+{
+    if (!_isCreated) {
+        return;
+    }
+
+    // Read finished frames oldest first, the oldest one is the set, that is going to be reused now
+    const auto nextFrame = (_currentFrame + 1) % NUM_FRAMES;
+    for (auto i = 0; i < NUM_FRAMES; i++)
+    {
+        auto& frame = _frames[(nextFrame + i) % NUM_FRAMES];
+        if (frame.isPending && !readFrame(frame)) {
+            break;
+        }
+    }
+
+    auto& frame = _frames[nextFrame];
+    if (frame.isPending)
+    {
+        // Waiting for the results would stall the CPU, losing one frame of statistics is cheaper
+        frame.isPending = false;
+        _numDroppedFrames++;
+    }
+
+    calibrate();
+    _currentFrame = nextFrame;
+    frame.numUsedQueries = 0;
+    frame.zones.clear();
+    _openZones.clear();
+}
+
+void GPUProfiler::endFrame()
+{
+    if (!_isCreated || _currentFrame < 0) {
+        return;
+    }
+
+    while (!_openZones.empty()) {
+        endZone();
+    }
+
+    _frames[_currentFrame].isPending = _frames[_currentFrame].numUsedQueries > 0;
+}
+
+void GPUProfiler::beginZone(const char* name)
+{
+    if (!_isCreated || _currentFrame < 0) {
+        return;
+    }
+
+    // Keep a query for the end of every open zone, so that the zone can always be closed
+    auto& frame = _frames[_currentFrame];
+    if (frame.numUsedQueries + static_cast<int>(_openZones.size()) + 2 > MAX_QUERIES_PER_FRAME)
+    {
+        _openZones.push_back(-1);
+        return;
+    }
+
+    Zone zone;
+    zone.name = name;
+    zone.beginQuery = issueTimestamp();
+    zone.endQuery = -1;
+    zone.depth = static_cast<uint32_t>(_openZones.size());
+    _openZones.push_back(static_cast<int>(frame.zones.size()));
+    frame.zones.push_back(zone);
+}
+
+void GPUProfiler::endZone()
+{
+    if (!_isCreated || _currentFrame < 0 || _openZones.empty()) {
+        return;
+    }
+
+    const auto zoneIndex = _openZones.back();
+    _openZones.pop_back();
+    if (zoneIndex >= 0) {
+        _frames[_currentFrame].zones[zoneIndex].endQuery = issueTimestamp();
+    }
+}
+
+std::vector<GPUZoneSummary> GPUProfiler::getSummary() const
+{
+    std::vector<GPUZoneSummary> result;
+    std::vector<int64_t> sorted;
+    for (const auto& zone : _zones)
+    {
+        const auto& window = zone.second;
+        if (window.durations.empty()) {
+            continue;
+        }
+
+        sorted = window.durations;
+        std::sort(sorted.begin(), sorted.end());
+        int64_t sum = 0;
+        for (const auto duration : sorted) {
+            sum += duration;
+        }
+
+        GPUZoneSummary summary;
+        summary.name = zone.first;
+        summary.numFrames = window.numFrames;
+        summary.averageMilliseconds = sum / 1.0e6 / sorted.size();
+        summary.p50Milliseconds = sorted[(sorted.size() - 1) / 2] / 1.0e6;
+        summary.p95Milliseconds = sorted[static_cast<size_t>(0.95 * (sorted.size() - 1) + 0.5)] / 1.0e6;
+        summary.maxMilliseconds = sorted.back() / 1.0e6;
+        result.push_back(summary);
+    }
+
+    return result;
+}
+
+void GPUProfiler::printSummary(std::ostream& stream) const
+{
+    const auto flags = stream.flags();
+    stream << std::left << std::setw(32) << "gpu zone" << std::right
+        << std::setw(10) << "frames" << std::setw(10) << "avg ms" << std::setw(10) << "p50 ms"
+        << std::setw(10) << "p95 ms" << std::setw(10) << "max ms" << std::endl;
+
+    stream << std::fixed << std::setprecision(3);
+    for (const auto& zone : getSummary())
+    {
+        stream << std::left << std::setw(32) << zone.name << std::right
+            << std::setw(10) << zone.numFrames << std::setw(10) << zone.averageMilliseconds
+            << std::setw(10) << zone.p50Milliseconds << std::setw(10) << zone.p95Milliseconds
+            << std::setw(10) << zone.maxMilliseconds << std::endl;
+    }
+    if (_numDroppedFrames > 0) {
+        stream << _numDroppedFrames << " frames dropped (query results not ready in time)" << std::endl;
+    }
+    stream.flags(flags);
+}
+
+size_t GPUProfiler::getNumDroppedFrames() const
+{
+    return _numDroppedFrames;
+}
+
+void GPUProfiler::deleteGPUProfiler()
+{
+    if (!_isCreated) {
+        return;
+    }
+
+    for (auto& frame : _frames)
+    {
+        glDeleteQueries(MAX_QUERIES_PER_FRAME, frame.queries);
+        frame.isPending = false;
+    }
+    _currentFrame = -1;
+    _isCreated = false;
+}
+
+void GPUProfiler::calibrate()
+{
+    // GL_TIMESTAMP state is the GPU time now, without waiting for issued commands
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    _gpuToCPUOffset = cpuNanoseconds() - gpuTime;
+}
+
+bool GPUProfiler::readFrame(FrameQueries& frame)
+{
+    // Queries complete in issue order, so the last one being available means all of them are
+    GLuint isAvailable = GL_FALSE;
+    glGetQueryObjectuiv(frame.queries[frame.numUsedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+    if (isAvailable == GL_FALSE) {
+        return false;
+    }
+
+    GLuint64 timestamps[MAX_QUERIES_PER_FRAME];
+    for (auto i = 0; i < frame.numUsedQueries; i++) {
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    // Same zone may occur several times in a frame (e.g. a draw group split by sorting), its times are summed
+    std::map<const char*, int64_t, NameLess> frameDurations;
+    for (const auto& zone : frame.zones)
+    {
+        const auto begin = static_cast<int64_t>(timestamps[zone.beginQuery]);
+        const auto end = static_cast<int64_t>(timestamps[zone.endQuery]);
+        frameDurations[zone.name] += end - begin;
+
+#if PROFILER_ENABLED
+        ProfilerEvent event;
+        event.name = zone.name;
+        event.startNanoseconds = begin + _gpuToCPUOffset;
+        event.endNanoseconds = end + _gpuToCPUOffset;
+        event.threadIndex = Profiler::GPU_THREAD_INDEX;
+        event.depth = zone.depth;
+        Profiler::getInstance().addTraceEvent(event);
+#endif
+    }
+
+    for (const auto& duration : frameDurations)
+    {
+        auto& window = _zones[duration.first];
+        if (window.durations.size() < WINDOW_SIZE) {
+            window.durations.push_back(duration.second);
+        }
+        else {
+            window.durations[window.numFrames % WINDOW_SIZE] = duration.second;
+        }
+        window.numFrames++;
+    }
+
+    frame.isPending = false;
+    return true;
+}
+
+int GPUProfiler::issueTimestamp()
+{
+    auto& frame = _frames[_currentFrame];
+    const auto queryIndex = frame.numUsedQueries++;
+    glQueryCounter(frame.queries[queryIndex], GL_TIMESTAMP);
+    return queryIndex;
+}
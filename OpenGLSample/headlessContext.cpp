@@ -0,0 +1,108 @@
+// STL
+#include <iostream>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// Project
+#include "common/headlessContext.h"
+
+#ifdef HEADLESS_EGL
+
+bool HeadlessContext::createContext(int majorVersion, int minorVersion)
+{
+    // Surfaceless platform needs neither X11 nor Wayland nor a DRM device
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay != nullptr) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+    {
+        std::cerr << "Cannot initialize EGL display (error 0x" << std::hex << eglGetError() << std::dec << ")!" << std::endl;
+        return false;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "EGL display does not support desktop OpenGL!" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &numConfigs);
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    // Surfaceless contexts do not need a config (EGL_KHR_no_config_context)
+    EGLContext context = eglCreateContext(display, numConfigs > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cerr << "Cannot create OpenGL " << majorVersion << "." << minorVersion << " core context (error 0x"
+            << std::hex << eglGetError() << std::dec << ")!" << std::endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        std::cerr << "Cannot make surfaceless OpenGL context current!" << std::endl;
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    _display = display;
+    _context = context;
+    return true;
+}
+
+void* HeadlessContext::getProcAddress(const char* name)
+{
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+void HeadlessContext::deleteContext()
+{
+    if (_context == nullptr) {
+        return;
+    }
+
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(_display, _context);
+    eglTerminate(_display);
+    _display = nullptr;
+    _context = nullptr;
+}
+
+#else
+
+bool HeadlessContext::createContext(int /*majorVersion*/, int /*minorVersion*/)
+{
+    std::cerr << "Headless rendering is not available, build with HEADLESS_EGL defined and link libEGL!" << std::endl;
+    return false;
+}
+
+void* HeadlessContext::getProcAddress(const char* /*name*/)
+{
+    return nullptr;
+}
+
+void HeadlessContext::deleteContext() {}
+
+#endif // HEADLESS_EGL
@@ -0,0 +1,211 @@
+// STL
+#include <algorithm>
+#include <iostream>
+#include <cstddef>
+#include <cstring>
+
+// Project
+#include "common/instanceBuffer.h"
+#include "common/glStateCache.h"
+
+const int InstanceBuffer::MODEL_ATTRIBUTE_INDEX    = 3;
+const int InstanceBuffer::MATERIAL_ATTRIBUTE_INDEX = 7;
+const int InstanceBuffer::TEXTURE_LAYER_ATTRIBUTE_INDEX = 8;
+const int InstanceBuffer::NUM_STREAMING_REGIONS;
+
+void InstanceBuffer::createInstanceBuffer(size_t reserveInstances)
+{
+    if (_isBufferCreated)
+    {
+        std::cerr << "This instance buffer is already created! You need to delete it before re-creating it!" << std::endl;
+        return;
+    }
+
+    _instances.reserve(reserveInstances);
+    _regionCapacity = std::max<size_t>(reserveInstances, 1);
+    _ringBuffer.createStreamingVBO(_regionCapacity * sizeof(InstanceData), NUM_STREAMING_REGIONS);
+
+    _isBufferCreated = true;
+}
+
+GLuint InstanceBuffer::addInstance(const glm::mat4& model, GLint materialIndex, GLint textureLayer)
+{
+    InstanceData instance = {};
+    instance.model = model;
+    instance.materialIndex = materialIndex;
+    instance.textureLayer = textureLayer;
+    _instances.push_back(instance);
+
+    const auto index = static_cast<GLuint>(_instances.size() - 1);
+    markDirty(index);
+    return index;
+}
+
+InstanceRange InstanceBuffer::beginRange() const
+{
+    InstanceRange range;
+    range.firstInstance = getNumInstances();
+    return range;
+}
+
+void InstanceBuffer::endRange(InstanceRange& range) const
+{
+    range.numInstances = static_cast<GLsizei>(getNumInstances() - range.firstInstance);
+}
+
+InstanceRange InstanceBuffer::addInstances(GLsizei numInstances)
+{
+    InstanceRange range = beginRange();
+    if (numInstances <= 0) {
+        return range;
+    }
+
+    _instances.resize(_instances.size() + numInstances, InstanceData());
+    endRange(range);
+    markDirty(range.firstInstance);
+    markDirty(range.firstInstance + range.numInstances - 1);
+    return range;
+}
+
+void InstanceBuffer::fillInstance(GLuint index, const glm::mat4& model, GLint materialIndex, GLint textureLayer)
+{
+    _instances[index].model = model;
+    _instances[index].materialIndex = materialIndex;
+    _instances[index].textureLayer = textureLayer;
+}
+
+void InstanceBuffer::setInstance(GLuint index, const glm::mat4& model, GLint materialIndex, GLint textureLayer)
+{
+    if (index >= _instances.size())
+    {
+        std::cerr << "Instance " << index << " does not exist in instance buffer " << getBufferID() << "!" << std::endl;
+        return;
+    }
+
+    _instances[index].model = model;
+    _instances[index].materialIndex = materialIndex;
+    _instances[index].textureLayer = textureLayer;
+    markDirty(index);
+}
+
+void InstanceBuffer::clear()
+{
+    _instances.clear();
+    _dirtyBegin = 0;
+    _dirtyEnd = 0;
+}
+
+const InstanceData& InstanceBuffer::getInstance(GLuint index) const
+{
+    return _instances[index];
+}
+
+GLuint InstanceBuffer::getNumInstances() const
+{
+    return static_cast<GLuint>(_instances.size());
+}
+
+bool InstanceBuffer::uploadIfDirty()
+{
+    if (!_isBufferCreated || _dirtyBegin == _dirtyEnd) {
+        return false;
+    }
+
+    if (_instances.size() > _regionCapacity)
+    {
+        // Ring with larger regions, capacity is preserved when instances are cleared and re-added.
+        // Old ring is deleted only after the draws issued so far, OpenGL keeps its storage until then.
+        _ringBuffer.deleteVBO();
+        _regionCapacity = _instances.capacity();
+        _ringBuffer.createStreamingVBO(_regionCapacity * sizeof(InstanceData), NUM_STREAMING_REGIONS);
+    }
+
+    // Region of the previous upload may still be read by the GPU, so the whole set goes to the next one
+    const auto dataSizeBytes = _instances.size() * sizeof(InstanceData);
+    void* ptrRegion = nullptr;
+    if (_ringBuffer.beginStreamingRegion()) {
+        ptrRegion = _ringBuffer.allocateStreamingData(dataSizeBytes, sizeof(glm::vec4), _uploadedOffset);
+    }
+    if (ptrRegion == nullptr)
+    {
+        _ringBuffer.endStreamingRegion();
+        std::cerr << "Cannot upload " << _instances.size() << " instances to instance buffer " << getBufferID() << "!" << std::endl;
+        return false;
+    }
+    memcpy(ptrRegion, _instances.data(), dataSizeBytes);
+    _ringBuffer.endStreamingRegion();
+
+    _dirtyBegin = 0;
+    _dirtyEnd = 0;
+    return true;
+}
+
+void InstanceBuffer::setInstanceAttributesPointers(GLuint firstInstance) const
+{
+    if (!_isBufferCreated) {
+        return;
+    }
+
+    const auto stride = static_cast<GLsizei>(sizeof(InstanceData));
+    const auto baseOffset = _uploadedOffset + static_cast<size_t>(firstInstance) * sizeof(InstanceData);
+
+    GLStateCache::getInstance().bindBuffer(GL_ARRAY_BUFFER, getBufferID());
+
+    // Matrix takes four consecutive attributes, one per column
+    for (int column = 0; column < 4; column++)
+    {
+        const auto attributeIndex = MODEL_ATTRIBUTE_INDEX + column;
+        const auto offset = baseOffset + offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+        glEnableVertexAttribArray(attributeIndex);
+        glVertexAttribPointer(attributeIndex, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+        glVertexAttribDivisor(attributeIndex, 1);
+    }
+
+    const auto materialOffset = baseOffset + offsetof(InstanceData, materialIndex);
+    glEnableVertexAttribArray(MATERIAL_ATTRIBUTE_INDEX);
+    glVertexAttribIPointer(MATERIAL_ATTRIBUTE_INDEX, 1, GL_INT, stride, reinterpret_cast<void*>(materialOffset));
+    glVertexAttribDivisor(MATERIAL_ATTRIBUTE_INDEX, 1);
+
+    const auto textureLayerOffset = baseOffset + offsetof(InstanceData, textureLayer);
+    glEnableVertexAttribArray(TEXTURE_LAYER_ATTRIBUTE_INDEX);
+    glVertexAttribIPointer(TEXTURE_LAYER_ATTRIBUTE_INDEX, 1, GL_INT, stride, reinterpret_cast<void*>(textureLayerOffset));
+    glVertexAttribDivisor(TEXTURE_LAYER_ATTRIBUTE_INDEX, 1);
+}
+
+GLuint InstanceBuffer::getBufferID() const
+{
+    return _ringBuffer.getBufferID();
+}
+
+size_t InstanceBuffer::getNumStreamingWaits() const
+{
+    return _ringBuffer.getNumStreamingWaits();
+}
+
+void InstanceBuffer::deleteInstanceBuffer()
+{
+    if (!_isBufferCreated) {
+        return;
+    }
+
+    _ringBuffer.deleteVBO();
+    _instances.clear();
+    _regionCapacity = 0;
+    _uploadedOffset = 0;
+    _isBufferCreated = false;
+    _dirtyBegin = 0;
+    _dirtyEnd = 0;
+}
+
+void InstanceBuffer::markDirty(size_t index)
+{
+    if (_dirtyBegin == _dirtyEnd)
+    {
+        _dirtyBegin = index;
+        _dirtyEnd = index + 1;
+        return;
+    }
+
+    _dirtyBegin = std::min(_dirtyBegin, index);
+    _dirtyEnd = std::max(_dirtyEnd, index + 1);
+}
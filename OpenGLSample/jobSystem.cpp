@@ -0,0 +1,146 @@
+// STL
+#include <algorithm>
+
+// Project
+#include "common/jobSystem.h"
+#include "common/profiler.h"
+
+const size_t JobSystem::MIN_BAND_ITEMS;
+const uint32_t JobSystem::BANDS_PER_THREAD;
+
+JobSystem& JobSystem::getInstance()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+void JobSystem::start(uint32_t numThreads)
+{
+    stop();
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _isStopping = false;
+    for (uint32_t i = 1; i < numThreads; i++) {
+        _workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+void JobSystem::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _isStopping = true;
+    }
+    _startCondition.notify_all();
+
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+uint32_t JobSystem::getNumThreads() const
+{
+    return static_cast<uint32_t>(_workers.size()) + 1;
+}
+
+void JobSystem::run(uint32_t numJobs, const std::function<void(uint32_t)>& job)
+{
+    if (numJobs == 0) {
+        return;
+    }
+
+    // Single job, or no workers to share with
+    if (numJobs == 1 || _workers.empty())
+    {
+        for (uint32_t i = 0; i < numJobs; i++) {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &job;
+        _numJobs = numJobs;
+        _nextJob = 0;
+        _runIndex++;
+    }
+    _startCondition.notify_all();
+
+    runJobs(job, numJobs);
+
+    // All jobs are taken now, wait for the workers still running theirs. A worker waking up later sees no jobs left.
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finishCondition.wait(lock, [this] { return _numActiveWorkers == 0; });
+    _job = nullptr;
+    _numJobs = 0;
+}
+
+void JobSystem::runBands(size_t numRows, size_t itemsPerRow, const std::function<void(size_t, size_t)>& job)
+{
+    if (numRows == 0) {
+        return;
+    }
+
+    const auto rowsPerMinBand = std::max<size_t>(MIN_BAND_ITEMS / std::max<size_t>(itemsPerRow, 1), 1);
+    const auto numBands = std::min<size_t>(getNumJobs(numRows, rowsPerMinBand), getNumThreads() * BANDS_PER_THREAD);
+    if (numBands <= 1)
+    {
+        job(0, numRows);
+        return;
+    }
+
+    const auto rowsPerBand = (numRows + numBands - 1) / numBands;
+    run(getNumJobs(numRows, rowsPerBand), [&](uint32_t band) {
+        const auto firstRow = band * rowsPerBand;
+        job(firstRow, std::min(firstRow + rowsPerBand, numRows));
+    });
+}
+
+uint32_t JobSystem::getNumJobs(size_t numItems, size_t itemsPerJob)
+{
+    return static_cast<uint32_t>((numItems + itemsPerJob - 1) / itemsPerJob);
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::workerLoop()
+{
+    uint64_t lastRunIndex = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _startCondition.wait(lock, [&] { return _isStopping || (_runIndex != lastRunIndex && _job != nullptr); });
+        if (_isStopping) {
+            return;
+        }
+
+        lastRunIndex = _runIndex;
+        const auto* job = _job;
+        const auto numJobs = _numJobs;
+        _numActiveWorkers++;
+        lock.unlock();
+
+        runJobs(*job, numJobs);
+
+        lock.lock();
+        _numActiveWorkers--;
+        if (_numActiveWorkers == 0) {
+            _finishCondition.notify_all();
+        }
+    }
+}
+
+void JobSystem::runJobs(const std::function<void(uint32_t)>& job, uint32_t numJobs)
+{
+    PROFILE_SCOPE("Jobs");
+    for (auto jobIndex = _nextJob.fetch_add(1); jobIndex < numJobs; jobIndex = _nextJob.fetch_add(1)) {
+        job(jobIndex);
+    }
+}
@@ -0,0 +1,332 @@
+// STL
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define LIGHT_CLUSTERS_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE
+#endif
+
+// Project
+#include "common/lightClusters.h"
+#include "common/glStateCache.h"
+#include "common/profiler.h"
+#include "common/uploadCounter.h"
+
+const int LightClusters::CLUSTERS_X;
+const int LightClusters::CLUSTERS_Y;
+const int LightClusters::CLUSTERS_Z;
+const int LightClusters::BATCH_SIZE;
+const int LightClusters::TEXELS_PER_LIGHT;
+static_assert(sizeof(LightBlockData) == LightClusters::TEXELS_PER_LIGHT * sizeof(glm::vec4), "Light texture buffer needs TEXELS_PER_LIGHT texels per light");
+
+bool LightClusters::createClusters()
+{
+    if (_areClustersCreated)
+    {
+        std::cerr << "These light clusters are already created! You need to delete them before re-creating them!" << std::endl;
+        return false;
+    }
+
+    const std::pair<TextureBuffer*, GLenum> textureBuffers[] = { { &_grid, GL_RG32UI }, { &_indices, GL_R32UI }, { &_lights, GL_RGBA32F } };
+    for (const auto& textureBuffer : textureBuffers)
+    {
+        glGenBuffers(1, &textureBuffer.first->bufferID);
+        fillTextureBuffer(*textureBuffer.first, nullptr, 0);
+        glGenTextures(1, &textureBuffer.first->textureID);
+        GLStateCache::getInstance().bindTexture(GL_TEXTURE_BUFFER, textureBuffer.first->textureID);
+        glTexBuffer(GL_TEXTURE_BUFFER, textureBuffer.second, textureBuffer.first->bufferID);
+    }
+
+    const auto numClusters = static_cast<size_t>(CLUSTERS_X) * CLUSTERS_Y * CLUSTERS_Z;
+    for (auto array : { &_clusterMinX, &_clusterMinY, &_clusterMinZ, &_clusterMaxX, &_clusterMaxY, &_clusterMaxZ }) {
+        array->assign(numClusters, 0.0f);
+    }
+    _clusterLights.resize(numClusters);
+    _areClustersCreated = true;
+    return true;
+}
+
+void LightClusters::setLights(const std::vector<LightBlockData>& lights, float cutoffIntensity)
+{
+    _lightSpheres.clear();
+    for (const auto& light : lights) {
+        _lightSpheres.push_back(glm::vec4(glm::vec3(light.position), getLightRadius(light, cutoffIntensity)));
+    }
+    for (auto array : { &_lightCenterX, &_lightCenterY, &_lightCenterZ, &_lightRadius }) {
+        array->assign(lights.size(), 0.0f);
+    }
+
+    fillTextureBuffer(_lights, lights.data(), lights.size() * sizeof(LightBlockData));
+    UploadCounter::getInstance().addBytes(lights.size() * sizeof(LightBlockData));
+}
+
+size_t LightClusters::getNumLights() const
+{
+    return _lightSpheres.size();
+}
+
+float LightClusters::getLightRadius(const LightBlockData& light, float cutoffIntensity)
+{
+    // Ambient is attenuated as well, so the brightest of all colors decides
+    const auto intensity = std::max({ light.ambient.r, light.ambient.g, light.ambient.b, light.diffuse.r, light.diffuse.g, light.diffuse.b,
+        light.specular.r, light.specular.g, light.specular.b });
+    if (intensity <= 0.0f) {
+        return 0.0f;
+    }
+
+    // constant + linear * d + quadratic * d^2 = intensity / cutoff
+    const auto constant = light.attenuation.x - intensity / std::max(cutoffIntensity, std::numeric_limits<float>::min());
+    const auto linear = light.attenuation.y;
+    const auto quadratic = light.attenuation.z;
+    if (constant >= 0.0f) {
+        return 0.0f;
+    }
+    if (quadratic > 0.0f) {
+        return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * constant)) / (2.0f * quadratic);
+    }
+    if (linear > 0.0f) {
+        return -constant / linear;
+    }
+    return std::numeric_limits<float>::max(); // No falloff, the light reaches everywhere
+}
+
+void LightClusters::setView(const glm::mat4& view, const glm::mat4& projection)
+{
+    if (projection != _projection) {
+        buildClusterBoxes(projection);
+    }
+
+    for (size_t i = 0; i < _lightSpheres.size(); i++)
+    {
+        const auto center = view * glm::vec4(glm::vec3(_lightSpheres[i]), 1.0f);
+        _lightCenterX[i] = center.x;
+        _lightCenterY[i] = center.y;
+        _lightCenterZ[i] = center.z;
+        _lightRadius[i] = _lightSpheres[i].w;
+    }
+}
+
+glm::vec4 LightClusters::getClusterCounts() const
+{
+    return glm::vec4(static_cast<float>(CLUSTERS_X), static_cast<float>(CLUSTERS_Y), static_cast<float>(CLUSTERS_Z), 0.0f);
+}
+
+glm::vec4 LightClusters::getClusterDepth() const
+{
+    return glm::vec4(_depthScale, _depthBias, 0.0f, 0.0f);
+}
+
+void LightClusters::buildClusterBoxes(const glm::mat4& projection)
+{
+    _projection = projection;
+
+    // View depth of NDC depth: ndc = (P22 * z + P32) / (P23 * z + P33), depth = -z
+    const auto& p = projection;
+    auto getViewDepth = [&p](float ndc) { return -(ndc * p[3][3] - p[3][2]) / (p[2][2] - ndc * p[2][3]); };
+    const auto nearDepth = getViewDepth(-1.0f);
+    const auto farDepth = getViewDepth(1.0f);
+
+    // Logarithmic slices need a positive near depth, nearer fragments (orthographic projection) fall into the first slice
+    const auto logNear = std::max(nearDepth, farDepth * 1e-4f);
+    for (int slice = 0; slice <= CLUSTERS_Z; slice++) {
+        _sliceDepths[slice] = logNear * std::pow(farDepth / logNear, static_cast<float>(slice) / CLUSTERS_Z);
+    }
+    _sliceDepths[0] = nearDepth;
+    _depthScale = CLUSTERS_Z / std::log(farDepth / logNear);
+    _depthBias = -std::log(logNear) * _depthScale;
+
+    // View-space point at NDC x, y and view depth, for projections without skew of x and y by the depth
+    auto unproject = [&p](float ndcX, float ndcY, float depth) {
+        const auto z = -depth;
+        const auto w = p[2][3] * z + p[3][3];
+        return glm::vec3((ndcX * w - p[2][0] * z - p[3][0]) / p[0][0], (ndcY * w - p[2][1] * z - p[3][1]) / p[1][1], z);
+    };
+
+    for (int slice = 0; slice < CLUSTERS_Z; slice++)
+    {
+        for (int y = 0; y < CLUSTERS_Y; y++)
+        {
+            for (int x = 0; x < CLUSTERS_X; x++)
+            {
+                glm::vec3 boxMin(std::numeric_limits<float>::max());
+                glm::vec3 boxMax(-std::numeric_limits<float>::max());
+                for (int corner = 0; corner < 8; corner++)
+                {
+                    const auto ndcX = -1.0f + 2.0f * (x + (corner & 1)) / CLUSTERS_X;
+                    const auto ndcY = -1.0f + 2.0f * (y + ((corner >> 1) & 1)) / CLUSTERS_Y;
+                    const auto point = unproject(ndcX, ndcY, _sliceDepths[slice + (corner >> 2)]);
+                    boxMin = glm::min(boxMin, point);
+                    boxMax = glm::max(boxMax, point);
+                }
+
+                const auto cluster = (static_cast<size_t>(slice) * CLUSTERS_Y + y) * CLUSTERS_X + x;
+                _clusterMinX[cluster] = boxMin.x;
+                _clusterMinY[cluster] = boxMin.y;
+                _clusterMinZ[cluster] = boxMin.z;
+                _clusterMaxX[cluster] = boxMax.x;
+                _clusterMaxY[cluster] = boxMax.y;
+                _clusterMaxZ[cluster] = boxMax.z;
+            }
+        }
+    }
+}
+
+void LightClusters::assignSlice(size_t slice)
+{
+    const size_t clustersPerSlice = static_cast<size_t>(CLUSTERS_X) * CLUSTERS_Y;
+    const auto firstCluster = slice * clustersPerSlice;
+    for (size_t cluster = firstCluster; cluster < firstCluster + clustersPerSlice; cluster++) {
+        _clusterLights[cluster].clear();
+    }
+
+    // Lights in increasing order, so that every list is sorted
+    const auto sliceNearZ = -_sliceDepths[slice];
+    const auto sliceFarZ = -_sliceDepths[slice + 1];
+    for (size_t light = 0; light < _lightSpheres.size(); light++)
+    {
+        const auto centerX = _lightCenterX[light];
+        const auto centerY = _lightCenterY[light];
+        const auto centerZ = _lightCenterZ[light];
+        const auto radius = _lightRadius[light];
+        if (centerZ - radius > sliceNearZ || centerZ + radius < sliceFarZ) {
+            continue;
+        }
+        const auto radiusSquared = radius * radius;
+
+        for (auto base = firstCluster; base < firstCluster + clustersPerSlice; base += BATCH_SIZE)
+        {
+            unsigned int insideMask = 0;
+
+#if defined(LIGHT_CLUSTERS_AVX)
+            // Squared distance of the sphere center from the box, sum of its distances outside the box along every axis
+            const auto zero = _mm256_setzero_ps();
+            auto getOutside = [zero](const float* boxMin, const float* boxMax, float center) {
+                const auto centerValue = _mm256_set1_ps(center);
+                const auto below = _mm256_sub_ps(_mm256_loadu_ps(boxMin), centerValue);
+                const auto above = _mm256_sub_ps(centerValue, _mm256_loadu_ps(boxMax));
+                const auto outside = _mm256_max_ps(_mm256_max_ps(below, above), zero);
+                return _mm256_mul_ps(outside, outside);
+            };
+            auto distanceSquared = getOutside(&_clusterMinX[base], &_clusterMaxX[base], centerX);
+            distanceSquared = _mm256_add_ps(distanceSquared, getOutside(&_clusterMinY[base], &_clusterMaxY[base], centerY));
+            distanceSquared = _mm256_add_ps(distanceSquared, getOutside(&_clusterMinZ[base], &_clusterMaxZ[base], centerZ));
+            insideMask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, _mm256_set1_ps(radiusSquared), _CMP_LE_OQ)));
+#elif defined(LIGHT_CLUSTERS_SSE)
+            // Batch of 8 as two halves of 4
+            for (size_t half = 0; half < 2; half++)
+            {
+                const auto first = base + half * 4;
+                const auto zero = _mm_setzero_ps();
+                auto getOutside = [zero](const float* boxMin, const float* boxMax, float center) {
+                    const auto centerValue = _mm_set1_ps(center);
+                    const auto below = _mm_sub_ps(_mm_loadu_ps(boxMin), centerValue);
+                    const auto above = _mm_sub_ps(centerValue, _mm_loadu_ps(boxMax));
+                    const auto outside = _mm_max_ps(_mm_max_ps(below, above), zero);
+                    return _mm_mul_ps(outside, outside);
+                };
+                auto distanceSquared = getOutside(&_clusterMinX[first], &_clusterMaxX[first], centerX);
+                distanceSquared = _mm_add_ps(distanceSquared, getOutside(&_clusterMinY[first], &_clusterMaxY[first], centerY));
+                distanceSquared = _mm_add_ps(distanceSquared, getOutside(&_clusterMinZ[first], &_clusterMaxZ[first], centerZ));
+                insideMask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_set1_ps(radiusSquared)))) << (half * 4);
+            }
+#else
+            for (int lane = 0; lane < BATCH_SIZE; lane++)
+            {
+                const auto cluster = base + lane;
+                const auto outsideX = std::max(std::max(_clusterMinX[cluster] - centerX, centerX - _clusterMaxX[cluster]), 0.0f);
+                const auto outsideY = std::max(std::max(_clusterMinY[cluster] - centerY, centerY - _clusterMaxY[cluster]), 0.0f);
+                const auto outsideZ = std::max(std::max(_clusterMinZ[cluster] - centerZ, centerZ - _clusterMaxZ[cluster]), 0.0f);
+                if (outsideX * outsideX + outsideY * outsideY + outsideZ * outsideZ <= radiusSquared) {
+                    insideMask |= 1u << lane;
+                }
+            }
+#endif
+
+            for (int lane = 0; lane < BATCH_SIZE; lane++)
+            {
+                if (insideMask & (1u << lane)) {
+                    _clusterLights[base + lane].push_back(static_cast<uint32_t>(light));
+                }
+            }
+        }
+    }
+}
+
+void LightClusters::uploadClusters()
+{
+    PROFILE_SCOPE("LightClusters::uploadClusters");
+    const auto numClusters = _clusterLights.size();
+    std::vector<GLuint> gridData(numClusters * 2);
+    std::vector<GLuint> indexData;
+    indexData.reserve(_indexData.size());
+    for (size_t cluster = 0; cluster < numClusters; cluster++)
+    {
+        gridData[cluster * 2] = static_cast<GLuint>(indexData.size());
+        gridData[cluster * 2 + 1] = static_cast<GLuint>(_clusterLights[cluster].size());
+        indexData.insert(indexData.end(), _clusterLights[cluster].begin(), _clusterLights[cluster].end());
+    }
+    if (gridData == _gridData && indexData == _indexData) {
+        return;
+    }
+
+    _gridData.swap(gridData);
+    _indexData.swap(indexData);
+    fillTextureBuffer(_grid, _gridData.data(), _gridData.size() * sizeof(GLuint));
+    fillTextureBuffer(_indices, _indexData.data(), _indexData.size() * sizeof(GLuint));
+    UploadCounter::getInstance().addBytes((_gridData.size() + _indexData.size()) * sizeof(GLuint));
+}
+
+size_t LightClusters::getNumLightIndices() const
+{
+    return _indexData.size();
+}
+
+void LightClusters::bindTextures(GLuint gridUnit, GLuint indexUnit, GLuint lightUnit) const
+{
+    auto& glState = GLStateCache::getInstance();
+    glState.bindTextureToUnit(gridUnit, GL_TEXTURE_BUFFER, _grid.textureID);
+    glState.bindTextureToUnit(indexUnit, GL_TEXTURE_BUFFER, _indices.textureID);
+    glState.bindTextureToUnit(lightUnit, GL_TEXTURE_BUFFER, _lights.textureID);
+}
+
+void LightClusters::fillTextureBuffer(const TextureBuffer& textureBuffer, const void* data, size_t numBytes)
+{
+    // Empty buffers get one texel, as a texture buffer cannot view an empty data store
+    glBindBuffer(GL_TEXTURE_BUFFER, textureBuffer.bufferID);
+    glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(numBytes, sizeof(glm::vec4)), nullptr, GL_DYNAMIC_DRAW);
+    if (numBytes > 0) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, numBytes, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::deleteClusters()
+{
+    auto& glState = GLStateCache::getInstance();
+    for (auto textureBuffer : { &_grid, &_indices, &_lights })
+    {
+        if (textureBuffer->textureID != 0)
+        {
+            glDeleteTextures(1, &textureBuffer->textureID);
+            glState.forgetTexture(textureBuffer->textureID);
+        }
+        if (textureBuffer->bufferID != 0) {
+            glDeleteBuffers(1, &textureBuffer->bufferID);
+        }
+        *textureBuffer = TextureBuffer();
+    }
+
+    _lightSpheres.clear();
+    _clusterLights.clear();
+    _gridData.clear();
+    _indexData.clear();
+    _projection = glm::mat4(0.0f);
+    _areClustersCreated = false;
+}
@@ -0,0 +1,56 @@
+// STL
+#include <algorithm>
+
+// Project
+#include "common/lodSelector.h"
+
+const uint32_t LodSelector::MAX_LEVELS;
+
+void LodSelector::setView(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight)
+{
+    // Perspective projection divides by the view depth (w = -z), orthographic one keeps w = 1
+    _cameraPosition = cameraPosition;
+    _isPerspective = projection[3][3] == 0.0f;
+    _pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+}
+
+void LodSelector::setPixelError(float threshold, float hysteresis)
+{
+    _threshold = std::max(threshold, 0.0f);
+    _hysteresis = std::min(std::max(hysteresis, 0.0f), 1.0f);
+}
+
+float LodSelector::getPixelError() const
+{
+    return _threshold;
+}
+
+float LodSelector::getProjectedError(float worldError, const glm::vec3& sphereCenter, float sphereRadius) const
+{
+    if (!_isPerspective) {
+        return worldError * _pixelsPerUnit;
+    }
+
+    // Camera inside the sphere sees the error at the near plane scale, as large as it gets
+    const auto distance = std::max(glm::length(sphereCenter - _cameraPosition) - sphereRadius, 0.1f);
+    return worldError * _pixelsPerUnit / distance;
+}
+
+uint32_t LodSelector::selectLevel(const float* levelErrors, uint32_t numLevels, float errorScale,
+    const glm::vec3& sphereCenter, float sphereRadius, uint32_t currentLevel) const
+{
+    if (numLevels <= 1) {
+        return 0;
+    }
+
+    const auto pixelsPerError = getProjectedError(errorScale, sphereCenter, sphereRadius);
+    auto level = std::min(currentLevel, numLevels - 1);
+    while (level > 0 && levelErrors[level] * pixelsPerError > _threshold) {
+        level--;
+    }
+    while (level + 1 < numLevels && levelErrors[level + 1] * pixelsPerError <= _threshold * (1.0f - _hysteresis)) {
+        level++;
+    }
+
+    return level;
+}
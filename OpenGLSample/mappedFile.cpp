@@ -0,0 +1,136 @@
+// STL
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Project
+#include "common/mappedFile.h"
+
+MappedFile::~MappedFile()
+{
+    closeFile();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::openFile(const std::string& path)
+{
+    closeFile();
+
+    auto fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Cannot open file " << path << "!" << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        std::cerr << "File " << path << " is empty!" << std::endl;
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    auto mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    auto data = mappingHandle != nullptr ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (data == nullptr)
+    {
+        std::cerr << "Cannot map file " << path << " to memory!" << std::endl;
+        if (mappingHandle != nullptr) {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    _fileHandle = fileHandle;
+    _mappingHandle = mappingHandle;
+    _data = static_cast<const unsigned char*>(data);
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::closeFile()
+{
+    if (_data != nullptr) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mappingHandle != nullptr) {
+        CloseHandle(_mappingHandle);
+    }
+    if (_fileHandle != nullptr) {
+        CloseHandle(_fileHandle);
+    }
+
+    _data = nullptr;
+    _size = 0;
+    _fileHandle = nullptr;
+    _mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::openFile(const std::string& path)
+{
+    closeFile();
+
+    const auto fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        std::cerr << "Cannot open file " << path << "!" << std::endl;
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+        std::cerr << "File " << path << " is empty!" << std::endl;
+        close(fileDescriptor);
+        return false;
+    }
+
+    // Mapping stays valid after the descriptor is closed
+    auto data = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "Cannot map file " << path << " to memory!" << std::endl;
+        return false;
+    }
+
+    _data = static_cast<const unsigned char*>(data);
+    _size = static_cast<size_t>(fileStatus.st_size);
+    return true;
+}
+
+void MappedFile::closeFile()
+{
+    if (_data != nullptr) {
+        munmap(const_cast<unsigned char*>(_data), _size);
+    }
+
+    _data = nullptr;
+    _size = 0;
+}
+
+#endif // _WIN32
+
+const unsigned char* MappedFile::getData() const
+{
+    return _data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return _size;
+}
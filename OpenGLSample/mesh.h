@@ -7,6 +7,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.h"
+#include "common/glStateCache.h"
+#include "common/bounds.h"
 
 #include <string>
 #include <vector>
@@ -38,6 +40,8 @@ public:
 	vector<unsigned int> indices;
 	vector<Texture>      textures;
 	unsigned int VAO;
+	// local space bounds, for culling
+	Bounds bounds;
 
 	// constructor
 	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -45,6 +49,8 @@ public:
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
+		if (!this->vertices.empty())
+			bounds = computeBounds(&this->vertices[0].Position.x, this->vertices.size(), sizeof(Vertex) / sizeof(float));
 
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
 		setupMesh();
@@ -53,14 +59,44 @@ public:
 	// render the mesh
 	void Draw(Shader &shader)
 	{
-		// bind appropriate textures
+		// sampler names only have to be built when the mesh is drawn with a new program
+		if (samplerProgram != shader.ID)
+			resolveSamplerLocations(shader);
+
+		// bind appropriate textures, units already holding the texture are left alone
+		auto& glState = GLStateCache::getInstance();
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			// set the sampler to the correct texture unit
+			glUniform1i(samplerLocations[i], i);
+			glState.bindTextureToUnit(i, GL_TEXTURE_2D, textures[i].id);
+		}
+
+		// draw mesh
+		glState.bindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+
+		// always good practice to set everything back to defaults once configured.
+		glState.activeTexture(GL_TEXTURE0);
+	}
+
+private:
+	// render data 
+	unsigned int VBO, EBO;
+	// sampler uniform location of every texture, valid for samplerProgram
+	vector<GLint> samplerLocations;
+	unsigned int samplerProgram = 0;
+
+	// looks up sampler uniforms (diffuse_textureN, ...) of the given shader for all textures
+	void resolveSamplerLocations(const Shader &shader)
+	{
 		unsigned int diffuseNr = 1;
 		unsigned int specularNr = 1;
 		unsigned int normalNr = 1;
 		unsigned int heightNr = 1;
+		samplerLocations.resize(textures.size());
 		for (unsigned int i = 0; i < textures.size(); i++)
 		{
-			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
 			// retrieve texture number (the N in diffuse_textureN)
 			string number;
 			string name = textures[i].type;
@@ -73,25 +109,11 @@ public:
 			else if (name == "texture_height")
 				number = std::to_string(heightNr++); // transfer unsigned int to stream
 
-			// now set the sampler to the correct texture unit
-			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			// and finally bind the texture
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			samplerLocations[i] = shader.uniformLocation(name + number);
 		}
-
-		// draw mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
-		// always good practice to set everything back to defaults once configured.
-		glActiveTexture(GL_TEXTURE0);
+		samplerProgram = shader.ID;
 	}
 
-private:
-	// render data 
-	unsigned int VBO, EBO;
-
 	// initializes all the buffer objects/arrays
 	void setupMesh()
 	{
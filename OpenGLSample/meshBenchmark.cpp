@@ -0,0 +1,124 @@
+// STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+// Project
+#include "common/meshBenchmark.h"
+#include "common/sinCos.h"
+#include "cylinder.h"
+#include "torus.h"
+#include "Sphere.h"
+
+namespace
+{
+    const int MIN_SEGMENTS = 64;
+    const int MAX_SEGMENTS = 4096;
+    const int CROSS_SEGMENTS = 32; //! Stacks of the spheres and segments around the tube of the tori
+    const int NUM_RUNS = 5; //! Best run is reported
+    const size_t TABLE_ANGLES_PER_RUN = 1 << 20; //! Circles are computed repeatedly, until a run has this many angles
+    const size_t CHECKED_ANGLES = (1 << 20) + 5; //! Angles compared between kernels, the last 5 go through the padded batch
+    const float MAX_CHECKED_ANGLE = 8192.0f;
+
+    // Best wall time of one call of the function, in milliseconds
+    template<typename Function>
+    double measure(size_t numRepetitions, const Function& function)
+    {
+        auto bestMilliseconds = std::numeric_limits<double>::max();
+        for (auto run = 0; run < NUM_RUNS; run++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < numRepetitions; i++) {
+                function();
+            }
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            bestMilliseconds = std::min(bestMilliseconds, elapsed.count() / numRepetitions);
+        }
+        return bestMilliseconds;
+    }
+
+    void printRow(std::ostream& stream, const char* name, int numSegments, size_t numVertices, double milliseconds)
+    {
+        stream << std::left << std::setw(32) << name << std::right << std::setw(10) << numSegments << std::setw(12) << numVertices
+            << std::setw(12) << std::fixed << std::setprecision(4) << milliseconds
+            << std::setw(12) << std::setprecision(2) << milliseconds * 1e6 / numVertices << std::endl;
+    }
+
+    // Compares results of every supported SinCos kernel with the scalar one, over pseudo-random angles of the accurate range
+    bool checkSinCosKernels(std::ostream& stream)
+    {
+        std::vector<float> angles(CHECKED_ANGLES);
+        uint32_t state = 12345;
+        for (auto& angle : angles)
+        {
+            state = state * 1664525u + 1013904223u;
+            angle = (static_cast<float>(state >> 8) / (1 << 24) * 2.0f - 1.0f) * MAX_CHECKED_ANGLE;
+        }
+
+        std::vector<float> referenceSines(CHECKED_ANGLES), referenceCosines(CHECKED_ANGLES);
+        SinCos::compute(SinCos::KERNEL_SCALAR, angles.data(), angles.size(), referenceSines.data(), referenceCosines.data());
+
+        auto allAgree = true;
+        std::vector<float> sines(CHECKED_ANGLES), cosines(CHECKED_ANGLES);
+        for (auto kernelIndex = 0; kernelIndex < SinCos::NUM_KERNELS; kernelIndex++)
+        {
+            const auto kernel = static_cast<SinCos::Kernel>(kernelIndex);
+            if (kernel == SinCos::KERNEL_SCALAR || !SinCos::isKernelSupported(kernel)) {
+                continue;
+            }
+
+            SinCos::compute(kernel, angles.data(), angles.size(), sines.data(), cosines.data());
+            const auto agrees = std::memcmp(sines.data(), referenceSines.data(), sines.size() * sizeof(float)) == 0
+                && std::memcmp(cosines.data(), referenceCosines.data(), cosines.size() * sizeof(float)) == 0;
+            stream << "SinCos " << SinCos::getKernelName(kernel) << " kernel " << (agrees ? "agrees" : "DOES NOT agree")
+                << " with the scalar kernel bit for bit, " << CHECKED_ANGLES << " angles" << std::endl;
+            allAgree = allAgree && agrees;
+        }
+        return allAgree;
+    }
+}
+
+bool runMeshBenchmark(std::ostream& stream)
+{
+    stream << "SinCos kernel: " << SinCos::getKernelName(SinCos::getKernel()) << std::endl;
+    const auto kernelsAgree = checkSinCosKernels(stream);
+    stream << std::endl;
+
+    stream << std::left << std::setw(32) << "generation" << std::right << std::setw(10) << "segments" << std::setw(12) << "vertices"
+        << std::setw(12) << "best ms" << std::setw(12) << "ns/vertex" << std::endl;
+
+    for (auto numSegments = MIN_SEGMENTS; numSegments <= MAX_SEGMENTS; numSegments *= 4)
+    {
+        // Trigonometric tables alone, the vectorized kernel against the C library
+        std::vector<float> sines(numSegments + 1), cosines(numSegments + 1);
+        const auto numCircles = std::max<size_t>(TABLE_ANGLES_PER_RUN / numSegments, 1);
+        printRow(stream, "SinCos::computeCircle", numSegments, numSegments + 1, measure(numCircles, [&]() {
+            SinCos::computeCircle(numSegments, sines.data(), cosines.data());
+        }));
+        printRow(stream, "std::sin / std::cos", numSegments, numSegments + 1, measure(numCircles, [&]() {
+            const auto angleStep = 2.0f * 3.14159265358979f / numSegments;
+            for (auto i = 0; i <= numSegments; i++)
+            {
+                sines[i] = std::sin(i * angleStep);
+                cosines[i] = std::cos(i * angleStep);
+            }
+        }));
+
+        // Whole meshes, generated and uploaded
+        printRow(stream, "Cylinder", numSegments, (numSegments + 1) * 2 + (numSegments + 2) * 2, measure(1, [&]() {
+            static_meshes_3D::Cylinder cylinder(1.0f, numSegments, 1.0f);
+        }));
+        printRow(stream, "Sphere, 32 stacks", numSegments, static_cast<size_t>(numSegments + 1) * (CROSS_SEGMENTS + 1), measure(1, [&]() {
+            Sphere sphere(1.0f, numSegments, CROSS_SEGMENTS);
+        }));
+        printRow(stream, "Torus, 32 tube segments", numSegments, static_cast<size_t>(numSegments + 1) * (CROSS_SEGMENTS + 1), measure(1, [&]() {
+            static_meshes_3D::Torus torus(0.25f, 1.0f, CROSS_SEGMENTS, numSegments);
+        }));
+    }
+    return kernelsAgree;
+}
@@ -0,0 +1,288 @@
+// STL
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OCCLUSION_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE
+#endif
+
+// Project
+#include "common/occlusionCuller.h"
+
+const int OcclusionCuller::TILE_WIDTH;
+const int OcclusionCuller::TILE_HEIGHT;
+const int OcclusionCuller::BAND_HEIGHT;
+
+namespace
+{
+    // Corner i of a box takes its x, y, z from boxMax where bit 0, 1, 2 of i is set
+    void getBoxCorners(const glm::mat4& modelViewProjection, const glm::vec3& boxMin, const glm::vec3& boxMax, glm::vec4* corners)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            const glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+            corners[i] = modelViewProjection * glm::vec4(corner, 1.0f);
+        }
+    }
+
+    // Two triangles per box face, any winding
+    const int BOX_TRIANGLES[12][3] = {
+        { 0, 2, 6 }, { 0, 6, 4 }, { 1, 3, 7 }, { 1, 7, 5 },
+        { 0, 1, 5 }, { 0, 5, 4 }, { 2, 3, 7 }, { 2, 7, 6 },
+        { 0, 1, 3 }, { 0, 3, 2 }, { 4, 5, 7 }, { 4, 7, 6 }
+    };
+
+    // In front of the near plane, or behind the camera
+    bool isNearClipped(const glm::vec4& clip)
+    {
+        return clip.w <= 0.0f || clip.z < -clip.w;
+    }
+}
+
+void OcclusionCuller::createBuffer(int width, int height)
+{
+    _width = (std::max(width, 1) + TILE_WIDTH - 1) / TILE_WIDTH * TILE_WIDTH;
+    _height = (std::max(height, 1) + TILE_HEIGHT - 1) / TILE_HEIGHT * TILE_HEIGHT;
+    _depth.assign(static_cast<size_t>(_width) * _height, 1.0f);
+    _tileMaxDepth.assign(static_cast<size_t>(_width / TILE_WIDTH) * (_height / TILE_HEIGHT), 1.0f);
+}
+
+int OcclusionCuller::getWidth() const
+{
+    return _width;
+}
+
+int OcclusionCuller::getHeight() const
+{
+    return _height;
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+{
+    _viewProjection = viewProjection;
+    _triangles.clear();
+}
+
+void OcclusionCuller::addOccluderBox(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec4 corners[8];
+    getBoxCorners(_viewProjection * model, boxMin, boxMax, corners);
+
+    for (const auto& indices : BOX_TRIANGLES)
+    {
+        // Clipping would keep the part beyond the near plane, dropping the triangle only lets more objects through
+        if (isNearClipped(corners[indices[0]]) || isNearClipped(corners[indices[1]]) || isNearClipped(corners[indices[2]])) {
+            continue;
+        }
+
+        ScreenTriangle triangle;
+        for (int i = 0; i < 3; i++)
+        {
+            const auto& clip = corners[indices[i]];
+            triangle.vertices[i] = glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * _width, (clip.y / clip.w * 0.5f + 0.5f) * _height, clip.z / clip.w);
+        }
+
+        // Counter-clockwise, so that the inside is where all edge functions are positive
+        const auto edge1 = triangle.vertices[1] - triangle.vertices[0];
+        const auto edge2 = triangle.vertices[2] - triangle.vertices[0];
+        const auto area = edge1.x * edge2.y - edge2.x * edge1.y;
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            std::swap(triangle.vertices[1], triangle.vertices[2]);
+        }
+
+        // Pixels with the center inside the bounding rectangle
+        const auto& v = triangle.vertices;
+        triangle.minX = std::max(static_cast<int>(std::ceil(std::min({ v[0].x, v[1].x, v[2].x }) - 0.5f)), 0);
+        triangle.maxX = std::min(static_cast<int>(std::floor(std::max({ v[0].x, v[1].x, v[2].x }) - 0.5f)), _width - 1);
+        triangle.minY = std::max(static_cast<int>(std::ceil(std::min({ v[0].y, v[1].y, v[2].y }) - 0.5f)), 0);
+        triangle.maxY = std::min(static_cast<int>(std::floor(std::max({ v[0].y, v[1].y, v[2].y }) - 0.5f)), _height - 1);
+        if (triangle.minX <= triangle.maxX && triangle.minY <= triangle.maxY) {
+            _triangles.push_back(triangle);
+        }
+    }
+}
+
+size_t OcclusionCuller::getNumOccluderTriangles() const
+{
+    return _triangles.size();
+}
+
+size_t OcclusionCuller::getNumBands() const
+{
+    return static_cast<size_t>((_height + BAND_HEIGHT - 1) / BAND_HEIGHT);
+}
+
+void OcclusionCuller::rasterizeBand(size_t band)
+{
+    const auto firstRow = static_cast<int>(band) * BAND_HEIGHT;
+    const auto lastRow = std::min(firstRow + BAND_HEIGHT, _height) - 1;
+    std::fill(_depth.begin() + static_cast<size_t>(firstRow) * _width, _depth.begin() + static_cast<size_t>(lastRow + 1) * _width, 1.0f);
+
+    for (const auto& triangle : _triangles)
+    {
+        const auto minY = std::max(triangle.minY, firstRow);
+        const auto maxY = std::min(triangle.maxY, lastRow);
+        if (minY > maxY) {
+            continue;
+        }
+
+        // Edge functions and depth as planes a * x + b * y + c over the pixel centers
+        const auto& v = triangle.vertices;
+        float edgeA[3], edgeB[3], edgeC[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const auto& from = v[i];
+            const auto& to = v[(i + 1) % 3];
+            edgeA[i] = from.y - to.y;
+            edgeB[i] = to.x - from.x;
+            edgeC[i] = -(edgeA[i] * from.x + edgeB[i] * from.y);
+        }
+        const auto edge1 = v[1] - v[0];
+        const auto edge2 = v[2] - v[0];
+        const auto area = edge1.x * edge2.y - edge2.x * edge1.y;
+        const auto depthA = (edge1.z * edge2.y - edge2.z * edge1.y) / area;
+        const auto depthB = (edge2.z * edge1.x - edge1.z * edge2.x) / area;
+        const auto depthC = v[0].z - depthA * v[0].x - depthB * v[0].y;
+
+        // Whole tile rows, lanes outside the triangle are masked by the edge functions
+        const auto firstX = triangle.minX - triangle.minX % TILE_WIDTH;
+        for (int y = minY; y <= maxY; y++)
+        {
+            const auto centerY = y + 0.5f;
+            auto* row = &_depth[static_cast<size_t>(y) * _width];
+            for (int x = firstX; x <= triangle.maxX; x += TILE_WIDTH)
+            {
+#if defined(OCCLUSION_CULLER_AVX)
+                const auto zero = _mm256_setzero_ps();
+                const auto centerX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+                auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int i = 0; i < 3; i++)
+                {
+                    const auto edge = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edgeA[i]), centerX), _mm256_set1_ps(edgeB[i] * centerY + edgeC[i]));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+                }
+                const auto depth = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(depthA), centerX), _mm256_set1_ps(depthB * centerY + depthC));
+                const auto stored = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(stored, _mm256_min_ps(stored, depth), inside));
+#elif defined(OCCLUSION_CULLER_SSE)
+                // Tile row as two halves of 4
+                for (int half = 0; half < 2; half++)
+                {
+                    const auto first = x + half * 4;
+                    const auto zero = _mm_setzero_ps();
+                    const auto centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(first)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+                    auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                    for (int i = 0; i < 3; i++)
+                    {
+                        const auto edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[i]), centerX), _mm_set1_ps(edgeB[i] * centerY + edgeC[i]));
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+                    }
+                    const auto depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), centerX), _mm_set1_ps(depthB * centerY + depthC));
+                    const auto stored = _mm_loadu_ps(row + first);
+                    const auto nearest = _mm_min_ps(stored, depth);
+                    _mm_storeu_ps(row + first, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+                }
+#else
+                for (int lane = 0; lane < TILE_WIDTH; lane++)
+                {
+                    const auto centerX = x + lane + 0.5f;
+                    bool inside = true;
+                    for (int i = 0; i < 3; i++) {
+                        inside = inside && edgeA[i] * centerX + (edgeB[i] * centerY + edgeC[i]) >= 0.0f;
+                    }
+                    if (inside) {
+                        row[x + lane] = std::min(row[x + lane], depthA * centerX + (depthB * centerY + depthC));
+                    }
+                }
+#endif
+            }
+        }
+    }
+
+    // Farthest depth of the tiles of the band
+    const auto tilesPerRow = _width / TILE_WIDTH;
+    for (int tileY = firstRow / TILE_HEIGHT; tileY <= lastRow / TILE_HEIGHT; tileY++)
+    {
+        for (int tileX = 0; tileX < tilesPerRow; tileX++)
+        {
+            auto maxDepth = -1.0f;
+            for (int y = tileY * TILE_HEIGHT; y < (tileY + 1) * TILE_HEIGHT; y++)
+            {
+                const auto* row = &_depth[static_cast<size_t>(y) * _width + tileX * TILE_WIDTH];
+                maxDepth = std::max(maxDepth, *std::max_element(row, row + TILE_WIDTH));
+            }
+            _tileMaxDepth[static_cast<size_t>(tileY) * tilesPerRow + tileX] = maxDepth;
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::mat4& model, const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+    glm::vec4 corners[8];
+    getBoxCorners(_viewProjection * model, boxMin, boxMax, corners);
+
+    // Screen rectangle and nearest depth of the box
+    glm::vec3 screenMin(1e30f);
+    glm::vec3 screenMax(-1e30f);
+    for (const auto& clip : corners)
+    {
+        if (isNearClipped(clip)) {
+            return true;
+        }
+        const glm::vec3 screen((clip.x / clip.w * 0.5f + 0.5f) * _width, (clip.y / clip.w * 0.5f + 0.5f) * _height, clip.z / clip.w);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+    }
+
+    // Every pixel the rectangle touches, not only those with the center inside
+    const auto minX = std::max(static_cast<int>(std::floor(screenMin.x)), 0);
+    const auto maxX = std::min(static_cast<int>(std::ceil(screenMax.x)), _width) - 1;
+    const auto minY = std::max(static_cast<int>(std::floor(screenMin.y)), 0);
+    const auto maxY = std::min(static_cast<int>(std::ceil(screenMax.y)), _height) - 1;
+    if (minX > maxX || minY > maxY) {
+        return true;
+    }
+
+    const auto tilesPerRow = _width / TILE_WIDTH;
+    for (int tileY = minY / TILE_HEIGHT; tileY <= maxY / TILE_HEIGHT; tileY++)
+    {
+        for (int tileX = minX / TILE_WIDTH; tileX <= maxX / TILE_WIDTH; tileX++)
+        {
+            // Whole tile is nearer than the box
+            if (_tileMaxDepth[static_cast<size_t>(tileY) * tilesPerRow + tileX] < screenMin.z) {
+                continue;
+            }
+
+            const auto lastY = std::min((tileY + 1) * TILE_HEIGHT - 1, maxY);
+            const auto lastX = std::min((tileX + 1) * TILE_WIDTH - 1, maxX);
+            for (int y = std::max(tileY * TILE_HEIGHT, minY); y <= lastY; y++)
+            {
+                const auto* row = &_depth[static_cast<size_t>(y) * _width];
+                for (int x = std::max(tileX * TILE_WIDTH, minX); x <= lastX; x++)
+                {
+                    if (row[x] >= screenMin.z) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void OcclusionCuller::deleteBuffer()
+{
+    _triangles = std::vector<ScreenTriangle>();
+    _depth = std::vector<float>();
+    _tileMaxDepth = std::vector<float>();
+    _width = 0;
+    _height = 0;
+}
@@ -0,0 +1,101 @@
+// STL
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Project
+#include "common/offscreenFramebuffer.h"
+
+bool OffscreenFramebuffer::createFramebuffer(GLsizei width, GLsizei height)
+{
+    if (_framebufferID != 0) {
+        deleteFramebuffer();
+    }
+
+    glGenRenderbuffers(1, &_colorRenderbufferID);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorRenderbufferID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &_depthRenderbufferID);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbufferID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+    glGenFramebuffers(1, &_framebufferID);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebufferID);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorRenderbufferID);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbufferID);
+
+    const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Offscreen framebuffer " << width << "x" << height << " is not complete (status 0x"
+            << std::hex << status << std::dec << ")!" << std::endl;
+        deleteFramebuffer();
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    return true;
+}
+
+void OffscreenFramebuffer::bindFramebuffer() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebufferID);
+    glViewport(0, 0, _width, _height);
+}
+
+GLsizei OffscreenFramebuffer::getWidth() const
+{
+    return _width;
+}
+
+GLsizei OffscreenFramebuffer::getHeight() const
+{
+    return _height;
+}
+
+void OffscreenFramebuffer::deleteFramebuffer()
+{
+    if (_framebufferID != 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &_framebufferID);
+        _framebufferID = 0;
+    }
+    if (_colorRenderbufferID != 0)
+    {
+        glDeleteRenderbuffers(1, &_colorRenderbufferID);
+        _colorRenderbufferID = 0;
+    }
+    if (_depthRenderbufferID != 0)
+    {
+        glDeleteRenderbuffers(1, &_depthRenderbufferID);
+        _depthRenderbufferID = 0;
+    }
+    _width = 0;
+    _height = 0;
+}
+
+bool OffscreenFramebuffer::writePPM(const std::string& path, GLsizei width, GLsizei height)
+{
+    const auto rowSize = static_cast<size_t>(width) * 3;
+    std::vector<unsigned char> pixels(rowSize * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot write frame to " << path << "!" << std::endl;
+        return false;
+    }
+
+    // OpenGL rows go bottom to top, PPM rows top to bottom
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (auto y = height - 1; y >= 0; y--) {
+        file.write(reinterpret_cast<const char*>(pixels.data() + rowSize * y), rowSize);
+    }
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,223 @@
+// Project
+#include "common/profiler.h"
+
+#if PROFILER_ENABLED
+
+// STL
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+int64_t steadyClockNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Zone names are identifiers, only quotes and backslashes need escaping
+void writeJSONString(std::ostream& stream, const char* text)
+{
+    stream << '"';
+    for (auto c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\') {
+            stream << '\\';
+        }
+        stream << *c;
+    }
+    stream << '"';
+}
+
+} // namespace
+
+Profiler& Profiler::getInstance()
+{
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::Profiler()
+    : _startTime(steadyClockNanoseconds()) {}
+
+int64_t Profiler::now() const
+{
+    return steadyClockNanoseconds() - _startTime;
+}
+
+ProfilerThreadBuffer& Profiler::getThreadBuffer()
+{
+    thread_local ProfilerThreadBuffer* threadBuffer = nullptr;
+    if (threadBuffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(_threadsMutex);
+        _threadBuffers.push_back(std::unique_ptr<ProfilerThreadBuffer>(new ProfilerThreadBuffer()));
+        threadBuffer = _threadBuffers.back().get();
+        threadBuffer->threadIndex = static_cast<uint32_t>(_threadBuffers.size() - 1);
+    }
+
+    return *threadBuffer;
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard<std::mutex> lock(_threadsMutex);
+    for (auto& buffer : _threadBuffers)
+    {
+        // Acquire pairs with the release in ProfilerScope, events below the index are complete
+        const auto writeIndex = buffer->writeIndex.load(std::memory_order_acquire);
+        if (writeIndex - buffer->readIndex > ProfilerThreadBuffer::CAPACITY)
+        {
+            _numLostEvents += static_cast<size_t>(writeIndex - buffer->readIndex - ProfilerThreadBuffer::CAPACITY);
+            buffer->readIndex = writeIndex - ProfilerThreadBuffer::CAPACITY;
+        }
+
+        for (; buffer->readIndex < writeIndex; buffer->readIndex++)
+        {
+            const auto& event = buffer->events[buffer->readIndex % ProfilerThreadBuffer::CAPACITY];
+
+            auto& zone = _zones[event.name];
+            const auto duration = event.endNanoseconds - event.startNanoseconds;
+            if (zone.durations.size() < WINDOW_SIZE) {
+                zone.durations.push_back(duration);
+            }
+            else {
+                zone.durations[zone.totalCount % WINDOW_SIZE] = duration;
+            }
+            zone.totalCount++;
+
+            if (_traceEvents.size() < MAX_TRACE_EVENTS) {
+                _traceEvents.push_back(event);
+            }
+        }
+    }
+}
+
+void Profiler::addTraceEvent(const ProfilerEvent& event)
+{
+    std::lock_guard<std::mutex> lock(_threadsMutex);
+    if (_traceEvents.size() < MAX_TRACE_EVENTS) {
+        _traceEvents.push_back(event);
+    }
+}
+
+std::vector<ProfilerZoneSummary> Profiler::getSummary() const
+{
+    std::vector<ProfilerZoneSummary> result;
+    std::vector<int64_t> sorted;
+    for (const auto& zone : _zones)
+    {
+        const auto& window = zone.second;
+        if (window.durations.empty()) {
+            continue;
+        }
+
+        sorted = window.durations;
+        std::sort(sorted.begin(), sorted.end());
+        const auto percentile = [&sorted](double p) {
+            const auto index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+            return sorted[index] / 1.0e6;
+        };
+
+        int64_t sum = 0;
+        for (const auto duration : sorted) {
+            sum += duration;
+        }
+
+        ProfilerZoneSummary summary;
+        summary.name = zone.first;
+        summary.totalCount = window.totalCount;
+        summary.averageMilliseconds = sum / 1.0e6 / sorted.size();
+        summary.p50Milliseconds = percentile(0.50);
+        summary.p95Milliseconds = percentile(0.95);
+        summary.p99Milliseconds = percentile(0.99);
+        summary.maxMilliseconds = sorted.back() / 1.0e6;
+        result.push_back(summary);
+    }
+
+    return result;
+}
+
+void Profiler::printSummary(std::ostream& stream) const
+{
+    const auto flags = stream.flags();
+    stream << std::left << std::setw(32) << "zone" << std::right
+        << std::setw(10) << "count" << std::setw(10) << "avg ms" << std::setw(10) << "p50 ms"
+        << std::setw(10) << "p95 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::endl;
+
+    stream << std::fixed << std::setprecision(3);
+    for (const auto& zone : getSummary())
+    {
+        stream << std::left << std::setw(32) << zone.name << std::right
+            << std::setw(10) << zone.totalCount << std::setw(10) << zone.averageMilliseconds
+            << std::setw(10) << zone.p50Milliseconds << std::setw(10) << zone.p95Milliseconds
+            << std::setw(10) << zone.p99Milliseconds << std::setw(10) << zone.maxMilliseconds << std::endl;
+    }
+    if (_numLostEvents > 0) {
+        stream << _numLostEvents << " events lost (thread buffer overflow)" << std::endl;
+    }
+    stream.flags(flags);
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot write profiler trace to " << path << "!" << std::endl;
+        return false;
+    }
+
+    // Complete events ("ph":"X"), times are in microseconds
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_THREAD_INDEX << ",\"args\":{\"name\":\"GPU\"}}";
+    file << (_traceEvents.empty() ? "" : ",") << std::endl;
+    file << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < _traceEvents.size(); i++)
+    {
+        const auto& event = _traceEvents[i];
+        file << "{\"name\":";
+        writeJSONString(file, event.name);
+        file << ",\"cat\":" << (event.threadIndex == GPU_THREAD_INDEX ? "\"gpu\"" : "\"cpu\"")
+            << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadIndex
+            << ",\"ts\":" << event.startNanoseconds / 1000.0
+            << ",\"dur\":" << (event.endNanoseconds - event.startNanoseconds) / 1000.0 << "}"
+            << (i + 1 < _traceEvents.size() ? "," : "") << std::endl;
+    }
+    file << "]}" << std::endl;
+
+    return true;
+}
+
+size_t Profiler::getNumLostEvents() const
+{
+    return _numLostEvents;
+}
+
+ProfilerScope::ProfilerScope(const char* name)
+    : _name(name)
+    , _buffer(Profiler::getInstance().getThreadBuffer())
+{
+    _buffer.depth++;
+    _start = Profiler::getInstance().now();
+}
+
+ProfilerScope::~ProfilerScope()
+{
+    const auto end = Profiler::getInstance().now();
+    _buffer.depth--;
+
+    // Only this thread writes the buffer, index is published after the event is complete
+    const auto index = _buffer.writeIndex.load(std::memory_order_relaxed);
+    auto& event = _buffer.events[index % ProfilerThreadBuffer::CAPACITY];
+    event.name = _name;
+    event.startNanoseconds = _start;
+    event.endNanoseconds = end;
+    event.threadIndex = _buffer.threadIndex;
+    event.depth = _buffer.depth;
+    _buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+#endif // PROFILER_ENABLED
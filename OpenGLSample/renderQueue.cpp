@@ -0,0 +1,467 @@
+// STL
+#include <algorithm>
+#include <iostream>
+
+// Project
+#include "common/renderQueue.h"
+#include "common/glStateCache.h"
+#include "common/profiler.h"
+#include "common/uploadCounter.h"
+
+const uint32_t RenderCommandBuffer::NO_MATRICES;
+
+void RenderCommandBuffer::reset(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float farPlane)
+{
+    _packets.clear();
+    _matrices.clear();
+    _timingGroup = nullptr;
+
+    _viewProjection = viewProjection;
+    _cameraPosition = cameraPosition;
+    _farPlane = farPlane;
+}
+
+void RenderCommandBuffer::setTimingGroup(const char* name)
+{
+    _timingGroup = name;
+}
+
+void RenderCommandBuffer::submitArrays(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLint first, GLsizei count, const glm::mat4& model)
+{
+    auto& packet = addPacket(pass, program, vao, texture, model, true);
+    packet.mode = mode;
+    packet.first = first;
+    packet.count = count;
+    packet.indexType = 0;
+    packet.indexByteOffset = 0;
+}
+
+void RenderCommandBuffer::submitArraysInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLint first, GLsizei count, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances)
+{
+    const auto instancesPerPacket = getInstancesPerPacket(pass, numInstances);
+    for (GLsizei i = 0; i < numInstances; i += instancesPerPacket)
+    {
+        auto& packet = addInstancedPacket(pass, program, vao, texture, instances, firstInstance + i, instancesPerPacket);
+        packet.mode = mode;
+        packet.first = first;
+        packet.count = count;
+        packet.indexType = 0;
+        packet.indexByteOffset = 0;
+    }
+}
+
+void RenderCommandBuffer::submitElementsInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances)
+{
+    const auto instancesPerPacket = getInstancesPerPacket(pass, numInstances);
+    for (GLsizei i = 0; i < numInstances; i += instancesPerPacket)
+    {
+        auto& packet = addInstancedPacket(pass, program, vao, texture, instances, firstInstance + i, instancesPerPacket);
+        packet.mode = mode;
+        packet.first = 0;
+        packet.count = count;
+        packet.indexType = indexType;
+        packet.indexByteOffset = indexByteOffset;
+    }
+}
+
+void RenderCommandBuffer::submitElements(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const glm::mat4& model)
+{
+    auto& packet = addPacket(pass, program, vao, texture, model, true);
+    packet.mode = mode;
+    packet.first = 0;
+    packet.count = count;
+    packet.indexType = indexType;
+    packet.indexByteOffset = indexByteOffset;
+}
+
+void RenderCommandBuffer::submitElementsIndirect(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLenum indexType, GLuint indirectBuffer, uintptr_t commandByteOffset, GLsizei numCommands)
+{
+    if (numCommands <= 0) {
+        return;
+    }
+
+    // Drawn objects are known only to the GPU, the packet is sorted as if it was at the origin
+    auto& packet = addPacket(pass, program, vao, texture, glm::mat4(1.0f), false);
+    packet.mode = mode;
+    packet.first = 0;
+    packet.count = numCommands;
+    packet.indexType = indexType;
+    packet.indexByteOffset = commandByteOffset;
+    packet.indirectBuffer = indirectBuffer;
+}
+
+size_t RenderCommandBuffer::getNumPackets() const
+{
+    return _packets.size();
+}
+
+const DrawPacket& RenderCommandBuffer::getPacket(size_t index) const
+{
+    return _packets[index];
+}
+
+const DrawMatrices& RenderCommandBuffer::getMatrices(uint32_t index) const
+{
+    return _matrices[index];
+}
+
+DrawPacket& RenderCommandBuffer::addPacket(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture, const glm::mat4& model, bool hasMatrices)
+{
+    _packets.emplace_back();
+
+    auto& packet = _packets.back();
+    packet.sortKey = RenderQueue::makeSortKey(pass, program.programID, texture, vao, quantizeDepth(pass, model));
+    packet.program = &program;
+    packet.vao = vao;
+    packet.texture = texture;
+    packet.instances = nullptr;
+    packet.firstInstance = 0;
+    packet.numInstances = 0;
+    packet.indirectBuffer = 0;
+    packet.timingGroup = _timingGroup;
+    packet.matrices = NO_MATRICES;
+
+    // Instanced draws read their matrices from the instance buffer
+    if (hasMatrices)
+    {
+        packet.matrices = static_cast<uint32_t>(_matrices.size());
+        _matrices.push_back({ model, _viewProjection * model });
+    }
+    return packet;
+}
+
+DrawPacket& RenderCommandBuffer::addInstancedPacket(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances)
+{
+    // Depth of the whole range is approximated by its first instance
+    auto& packet = addPacket(pass, program, vao, texture, instances.getInstance(firstInstance).model, false);
+    packet.instances = &instances;
+    packet.firstInstance = firstInstance;
+    packet.numInstances = numInstances;
+    return packet;
+}
+
+GLsizei RenderCommandBuffer::getInstancesPerPacket(RenderPass pass, GLsizei numInstances)
+{
+    // Blended instances get a packet each, so that they are sorted back to front among themselves and other packets.
+    // An instanced range would draw them in the order of the instance buffer.
+    return pass == RENDER_PASS_TRANSPARENT ? 1 : numInstances;
+}
+
+uint32_t RenderCommandBuffer::quantizeDepth(RenderPass pass, const glm::mat4& model) const
+{
+    const uint32_t maxDepth = (uint32_t(1) << DEPTH_BITS) - 1;
+    const auto objectPosition = glm::vec3(model[3]);
+    const auto distance = glm::length(objectPosition - _cameraPosition);
+    auto depth = static_cast<uint32_t>(std::min(distance / _farPlane, 1.0f) * maxDepth);
+
+    // Blended geometry has to be drawn back to front
+    if (pass == RENDER_PASS_TRANSPARENT) {
+        depth = maxDepth - depth;
+    }
+
+    return depth;
+}
+
+void RenderQueue::beginFrame(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float farPlane, size_t numCommandBuffers)
+{
+    _numCommandBuffers = std::max<size_t>(numCommandBuffers, 1);
+    if (_commandBuffers.size() < _numCommandBuffers) {
+        _commandBuffers.resize(_numCommandBuffers);
+    }
+    for (size_t i = 0; i < _numCommandBuffers; i++) {
+        _commandBuffers[i].reset(viewProjection, cameraPosition, farPlane);
+    }
+    _isSorted = false;
+}
+
+RenderCommandBuffer& RenderQueue::getCommandBuffer(size_t index)
+{
+    return _commandBuffers[index];
+}
+
+size_t RenderQueue::getNumCommandBuffers() const
+{
+    return _numCommandBuffers;
+}
+
+void RenderQueue::setTimingGroup(const char* name)
+{
+    _commandBuffers[0].setTimingGroup(name);
+}
+
+void RenderQueue::submitArrays(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLint first, GLsizei count, const glm::mat4& model)
+{
+    _commandBuffers[0].submitArrays(pass, program, vao, texture, mode, first, count, model);
+    _isSorted = false;
+}
+
+void RenderQueue::submitElements(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const glm::mat4& model)
+{
+    _commandBuffers[0].submitElements(pass, program, vao, texture, mode, count, indexType, indexByteOffset, model);
+    _isSorted = false;
+}
+
+void RenderQueue::submitArraysInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLint first, GLsizei count, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances)
+{
+    _commandBuffers[0].submitArraysInstanced(pass, program, vao, texture, mode, first, count, instances, firstInstance, numInstances);
+    _isSorted = false;
+}
+
+void RenderQueue::submitElementsInstanced(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLsizei count, GLenum indexType, uintptr_t indexByteOffset, const InstanceBuffer& instances, GLuint firstInstance, GLsizei numInstances)
+{
+    _commandBuffers[0].submitElementsInstanced(pass, program, vao, texture, mode, count, indexType, indexByteOffset, instances, firstInstance, numInstances);
+    _isSorted = false;
+}
+
+void RenderQueue::submitElementsIndirect(RenderPass pass, const RenderProgram& program, GLuint vao, GLuint texture,
+    GLenum mode, GLenum indexType, GLuint indirectBuffer, uintptr_t commandByteOffset, GLsizei numCommands)
+{
+    _commandBuffers[0].submitElementsIndirect(pass, program, vao, texture, mode, indexType, indirectBuffer, commandByteOffset, numCommands);
+    _isSorted = false;
+}
+
+void RenderQueue::sort()
+{
+    PROFILE_SCOPE("RenderQueue::sort");
+
+    // Merge: buffers one after another, so that the stable sort keeps their order among equal keys
+    const auto numPackets = getNumPackets();
+    _sorted.clear();
+    _sorted.reserve(numPackets);
+    _sortScratch.resize(numPackets);
+    for (size_t buffer = 0; buffer < _numCommandBuffers; buffer++)
+    {
+        const auto& commandBuffer = _commandBuffers[buffer];
+        for (size_t i = 0; i < commandBuffer.getNumPackets(); i++) {
+            _sorted.push_back({ commandBuffer.getPacket(i).sortKey, static_cast<uint32_t>(buffer), static_cast<uint32_t>(i) });
+        }
+    }
+
+    // LSD radix sort, one byte per pass. Passes, where all keys share the same byte, are skipped,
+    // which is the common case for the upper bytes (few passes and programs).
+    for (int shift = 0; shift < 64 && numPackets > 1; shift += 8)
+    {
+        size_t histogram[256] = {};
+        for (const auto& entry : _sorted) {
+            histogram[(entry.key >> shift) & 0xFF]++;
+        }
+
+        if (histogram[(_sorted[0].key >> shift) & 0xFF] == numPackets) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (auto& bucket : histogram)
+        {
+            const auto bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+
+        for (const auto& entry : _sorted) {
+            _sortScratch[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+        }
+        _sorted.swap(_sortScratch);
+    }
+
+    _isSorted = true;
+}
+
+void RenderQueue::execute(GPUProfiler* gpuProfiler)
+{
+    PROFILE_SCOPE("RenderQueue::execute");
+    if (!_isSorted) {
+        sort();
+    }
+
+    _stats = RenderQueueStats();
+
+    GLuint currentProgram = 0;
+    GLuint currentVAO = 0;
+    GLuint currentTexture = 0;
+    bool isFirstDraw = true;
+
+    static const char* const PASS_NAMES[] = { "Unlit pass", "Opaque pass", "Transparent pass" };
+    int currentPass = -1;
+    const char* currentGroup = nullptr;
+
+    auto& glState = GLStateCache::getInstance();
+    glState.activeTexture(GL_TEXTURE0);
+    for (const auto& entry : _sorted)
+    {
+        const auto& commandBuffer = _commandBuffers[entry.commandBuffer];
+        const auto& packet = commandBuffer.getPacket(entry.packetIndex);
+
+        if (gpuProfiler != nullptr)
+        {
+            // Pass zones contain zones of the timing groups, a group split by sorting gets more zones
+            const auto pass = static_cast<int>(packet.sortKey >> 60);
+            if (pass != currentPass || packet.timingGroup != currentGroup)
+            {
+                if (currentGroup != nullptr) {
+                    gpuProfiler->endZone();
+                }
+                if (pass != currentPass)
+                {
+                    if (currentPass != -1) {
+                        gpuProfiler->endZone();
+                    }
+                    gpuProfiler->beginZone(pass <= RENDER_PASS_TRANSPARENT ? PASS_NAMES[pass] : "Other pass");
+                    currentPass = pass;
+                }
+                if (packet.timingGroup != nullptr) {
+                    gpuProfiler->beginZone(packet.timingGroup);
+                }
+                currentGroup = packet.timingGroup;
+            }
+        }
+
+        if (isFirstDraw || packet.program->programID != currentProgram)
+        {
+            glState.useProgram(packet.program->programID);
+            currentProgram = packet.program->programID;
+            _stats.numProgramBinds++;
+        }
+        else {
+            _stats.numSkippedBinds++;
+        }
+
+        if (isFirstDraw || packet.vao != currentVAO)
+        {
+            glState.bindVertexArray(packet.vao);
+            currentVAO = packet.vao;
+            _stats.numVAOBinds++;
+        }
+        else {
+            _stats.numSkippedBinds++;
+        }
+
+        if (packet.texture != 0)
+        {
+            if (packet.texture != currentTexture)
+            {
+                glState.bindTexture(packet.program->textureTarget, packet.texture);
+                currentTexture = packet.texture;
+                _stats.numTextureBinds++;
+            }
+            else {
+                _stats.numSkippedBinds++;
+            }
+        }
+
+        auto& uploadCounter = UploadCounter::getInstance();
+        if (packet.matrices != RenderCommandBuffer::NO_MATRICES)
+        {
+            const auto& matrices = commandBuffer.getMatrices(packet.matrices);
+            if (packet.program->mvpLocation != -1)
+            {
+                glUniformMatrix4fv(packet.program->mvpLocation, 1, GL_FALSE, &matrices.MVP[0][0]);
+                uploadCounter.addBytes(sizeof(matrices.MVP));
+            }
+            if (packet.program->modelLocation != -1)
+            {
+                glUniformMatrix4fv(packet.program->modelLocation, 1, GL_FALSE, &matrices.model[0][0]);
+                uploadCounter.addBytes(sizeof(matrices.model));
+            }
+        }
+
+        if (packet.indirectBuffer != 0)
+        {
+            glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, packet.indirectBuffer);
+            glMultiDrawElementsIndirect(packet.mode, packet.indexType, reinterpret_cast<const void*>(packet.indexByteOffset), packet.count, 0);
+        }
+        else if (packet.instances != nullptr)
+        {
+            // Instance attributes are VAO state, so they are re-pointed for every range
+            packet.instances->setInstanceAttributesPointers(packet.firstInstance);
+            if (packet.indexType == 0) {
+                glDrawArraysInstanced(packet.mode, packet.first, packet.count, packet.numInstances);
+            }
+            else {
+                glDrawElementsInstanced(packet.mode, packet.count, packet.indexType, reinterpret_cast<const void*>(packet.indexByteOffset), packet.numInstances);
+            }
+            _stats.numInstances += packet.numInstances;
+        }
+        else if (packet.indexType == 0) {
+            glDrawArrays(packet.mode, packet.first, packet.count);
+        }
+        else {
+            glDrawElements(packet.mode, packet.count, packet.indexType, reinterpret_cast<const void*>(packet.indexByteOffset));
+        }
+
+        _stats.numDraws++;
+        if (packet.indirectBuffer == 0) {
+            _stats.numTriangles += getNumTriangles(packet.mode, packet.count) * std::max<GLsizei>(packet.numInstances, 1);
+        }
+        isFirstDraw = false;
+    }
+
+    if (gpuProfiler != nullptr)
+    {
+        if (currentGroup != nullptr) {
+            gpuProfiler->endZone();
+        }
+        if (currentPass != -1) {
+            gpuProfiler->endZone();
+        }
+    }
+}
+
+size_t RenderQueue::getNumPackets() const
+{
+    size_t numPackets = 0;
+    for (size_t i = 0; i < _numCommandBuffers; i++) {
+        numPackets += _commandBuffers[i].getNumPackets();
+    }
+    return numPackets;
+}
+
+const DrawPacket& RenderQueue::getSortedPacket(size_t index) const
+{
+    return _commandBuffers[_sorted[index].commandBuffer].getPacket(_sorted[index].packetIndex);
+}
+
+const RenderQueueStats& RenderQueue::getStats() const
+{
+    return _stats;
+}
+
+size_t RenderQueue::getNumTriangles(GLenum mode, GLsizei count)
+{
+    switch (mode)
+    {
+    case GL_TRIANGLES: return count / 3;
+    case GL_TRIANGLE_STRIP:
+    case GL_TRIANGLE_FAN: return count > 2 ? count - 2 : 0;
+    default: return 0;
+    }
+}
+
+uint64_t RenderQueue::makeSortKey(RenderPass pass, GLuint programID, GLuint texture, GLuint vao, uint32_t depth)
+{
+    const uint64_t depthMask = (uint64_t(1) << DEPTH_BITS) - 1;
+    if (pass == RENDER_PASS_TRANSPARENT)
+    {
+        // Depth (already inverted by quantizeDepth) decides the order, state only groups packets at the same depth
+        return (uint64_t(pass & 0xF) << 60)
+            | ((uint64_t(depth) & depthMask) << (60 - DEPTH_BITS))
+            | (uint64_t(programID & 0xFF) << 32)
+            | (uint64_t(texture & 0xFFFF) << 16)
+            | uint64_t(vao & 0xFFFF);
+    }
+    return (uint64_t(pass & 0xF) << 60)
+        | (uint64_t(programID & 0xFF) << 52)
+        | (uint64_t(texture & 0xFFFF) << 36)
+        | (uint64_t(vao & 0xFFFF) << DEPTH_BITS)
+        | (uint64_t(depth) & depthMask);
+}
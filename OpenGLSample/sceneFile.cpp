@@ -0,0 +1,653 @@
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Project
+#include "common/sceneFile.h"
+#include "common/profiler.h"
+#include "common/uniformBlocks.h"
+
+const uint32_t SceneFile::VERSION;
+const uint32_t SceneFile::NO_STRING;
+const uint32_t SceneFile::NO_TEXTURE;
+const uint32_t SceneFile::NO_MESH;
+const uint32_t SceneFile::NO_PARENT;
+const int SceneFile::MAX_SEGMENTS;
+const int SceneFile::MAX_PLANE_DIMENSION;
+
+namespace {
+
+const char SCENE_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+
+bool endsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool readFloats(std::istream& stream, float* values, int count)
+{
+    for (auto i = 0; i < count; i++)
+    {
+        if (!(stream >> values[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isPositive(float value)
+{
+    return std::isfinite(value) && value > 0.0f;
+}
+
+bool isCount(float value, int minCount, int maxCount)
+{
+    return value >= minCount && value <= maxCount && value == std::floor(value);
+}
+
+// Parameters flow into tessellation as they are, so the ones it cannot handle are refused at load.
+// Returns what is wrong with them, empty string if they are fine.
+std::string getMeshParametersError(const SceneMeshRecord& mesh)
+{
+    const float* parameters = mesh.parameters;
+    const auto maxSegments = std::to_string(SceneFile::MAX_SEGMENTS);
+    switch (mesh.primitive)
+    {
+    case SCENE_PRIMITIVE_PLANE:
+        if (!isCount(parameters[0], 2, SceneFile::MAX_PLANE_DIMENSION)) {
+            return "plane dimension must be an integer from 2 to " + std::to_string(SceneFile::MAX_PLANE_DIMENSION);
+        }
+        break;
+    case SCENE_PRIMITIVE_CYLINDER:
+        if (!isPositive(parameters[0]) || !isPositive(parameters[2])) {
+            return "cylinder radius and height must be positive";
+        }
+        if (!isCount(parameters[1], 3, SceneFile::MAX_SEGMENTS)) {
+            return "cylinder slices must be an integer from 3 to " + maxSegments;
+        }
+        break;
+    case SCENE_PRIMITIVE_TORUS:
+        if (!isPositive(parameters[0]) || !isPositive(parameters[1])) {
+            return "torus radii must be positive";
+        }
+        break;
+    case SCENE_PRIMITIVE_SPHERE:
+        if (!isPositive(parameters[0])) {
+            return "sphere radius must be positive";
+        }
+        if (!isCount(parameters[1], 3, SceneFile::MAX_SEGMENTS) || !isCount(parameters[2], 2, SceneFile::MAX_SEGMENTS)) {
+            return "sphere sectors must be an integer from 3 and stacks from 2 to " + maxSegments;
+        }
+        break;
+    }
+    return std::string();
+}
+
+} // namespace
+
+bool SceneFile::loadScene(const std::string& path)
+{
+    return endsWith(path, ".sceneb") ? loadBinary(path) : loadText(path);
+}
+
+bool SceneFile::loadText(const std::string& path)
+{
+    PROFILE_SCOPE("SceneFile::loadText");
+    clear();
+
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot open scene " << path << "!" << std::endl;
+        return false;
+    }
+
+    std::map<std::string, uint32_t> meshIndices;
+    std::map<std::string, uint32_t> textureIndices;
+    std::map<std::string, uint32_t> objectIndices;
+    std::string line;
+    auto lineNumber = 0;
+    const auto fail = [&path, &lineNumber](const std::string& message) {
+        std::cerr << "Scene " << path << ", line " << lineNumber << ": " << message << "!" << std::endl;
+        return false;
+    };
+
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        const auto commentStart = line.find('#');
+        if (commentStart != std::string::npos) {
+            line.erase(commentStart);
+        }
+
+        std::istringstream lineStream(line);
+        std::string statement;
+        if (!(lineStream >> statement)) {
+            continue;
+        }
+
+        if (statement == "specular")
+        {
+            std::string texturePath;
+            if (!(lineStream >> texturePath)) {
+                return fail("specular needs a texture path");
+            }
+            _header.specularTexturePath = addString(texturePath);
+        }
+        else if (statement == "texture")
+        {
+            std::string name, texturePath;
+            if (!(lineStream >> name >> texturePath)) {
+                return fail("texture needs a name and a path");
+            }
+            textureIndices[name] = static_cast<uint32_t>(_ownedTextures.size());
+            _ownedTextures.push_back({ addString(name), addString(texturePath) });
+        }
+        else if (statement == "mesh")
+        {
+            std::string name, primitive;
+            if (!(lineStream >> name >> primitive)) {
+                return fail("mesh needs a name and a primitive");
+            }
+
+            SceneMeshRecord mesh = {};
+            mesh.name = addString(name);
+            auto numParameters = 0;
+            if (primitive == "plane") {
+                mesh.primitive = SCENE_PRIMITIVE_PLANE;
+                numParameters = 1;
+            }
+            else if (primitive == "cube") {
+                mesh.primitive = SCENE_PRIMITIVE_CUBE;
+            }
+            else if (primitive == "container") {
+                mesh.primitive = SCENE_PRIMITIVE_CONTAINER;
+            }
+            else if (primitive == "cylinder") {
+                mesh.primitive = SCENE_PRIMITIVE_CYLINDER;
+                numParameters = 3;
+            }
+            else if (primitive == "torus") {
+                mesh.primitive = SCENE_PRIMITIVE_TORUS;
+                numParameters = 2;
+            }
+            else if (primitive == "sphere") {
+                mesh.primitive = SCENE_PRIMITIVE_SPHERE;
+                numParameters = 3;
+            }
+            else {
+                return fail("unknown primitive " + primitive);
+            }
+            if (!readFloats(lineStream, mesh.parameters, numParameters)) {
+                return fail(primitive + " needs " + std::to_string(numParameters) + " parameters");
+            }
+            const auto parametersError = getMeshParametersError(mesh);
+            if (!parametersError.empty()) {
+                return fail("mesh " + name + ": " + parametersError);
+            }
+
+            meshIndices[name] = static_cast<uint32_t>(_ownedMeshes.size());
+            _ownedMeshes.push_back(mesh);
+        }
+        else if (statement == "material")
+        {
+            if (_ownedMaterials.size() == MAX_MATERIALS) {
+                return fail("too many materials, the renderer holds " + std::to_string(MAX_MATERIALS));
+            }
+            SceneMaterialRecord material = {};
+            if (!readFloats(lineStream, material.uvScale, 2) || !readFloats(lineStream, &material.shininess, 1)) {
+                return fail("material needs uScale, vScale and shininess");
+            }
+            _ownedMaterials.push_back(material);
+        }
+        else if (statement == "light")
+        {
+            SceneLightRecord light = {};
+            if (!readFloats(lineStream, light.position, 3)) {
+                return fail("light needs a position");
+            }
+            light.position[3] = 1.0f;
+
+            std::string property;
+            while (lineStream >> property)
+            {
+                float* values = property == "ambient" ? light.ambient
+                    : property == "diffuse" ? light.diffuse
+                    : property == "specular" ? light.specular
+                    : property == "attenuation" ? light.attenuation
+                    : nullptr;
+                if (values == nullptr || !readFloats(lineStream, values, 3)) {
+                    return fail("invalid light property " + property);
+                }
+            }
+            _ownedLights.push_back(light);
+        }
+        else if (statement == "object")
+        {
+            std::string meshName, textureName;
+            if (!(lineStream >> meshName >> textureName)) {
+                return fail("object needs a mesh and a texture");
+            }
+
+            SceneObjectRecord object = {};
+            object.mesh = NO_MESH;
+            if (meshName != "-")
+            {
+                const auto meshIt = meshIndices.find(meshName);
+                if (meshIt == meshIndices.end()) {
+                    return fail("unknown mesh " + meshName);
+                }
+                object.mesh = meshIt->second;
+            }
+            object.texture = NO_TEXTURE;
+            if (textureName != "-")
+            {
+                const auto textureIt = textureIndices.find(textureName);
+                if (textureIt == textureIndices.end()) {
+                    return fail("unknown texture " + textureName);
+                }
+                object.texture = textureIt->second;
+            }
+            object.pass = SCENE_PASS_OPAQUE;
+            object.group = NO_STRING;
+            object.parent = NO_PARENT;
+
+            auto model = glm::mat4(1.0f);
+            std::string property;
+            while (lineStream >> property)
+            {
+                glm::vec3 vector;
+                float angle = 0.0f;
+                if (property == "translate" && readFloats(lineStream, &vector.x, 3)) {
+                    model = glm::translate(model, vector);
+                }
+                else if (property == "rotate" && readFloats(lineStream, &angle, 1) && readFloats(lineStream, &vector.x, 3)) {
+                    model = glm::rotate(model, glm::radians(angle), vector);
+                }
+                else if (property == "scale" && readFloats(lineStream, &vector.x, 3)) {
+                    model = glm::scale(model, vector);
+                }
+                else if (property == "material" && lineStream >> object.material) {
+                    continue;
+                }
+                else if (property == "name")
+                {
+                    std::string name;
+                    if (!(lineStream >> name)) {
+                        return fail("name needs a name");
+                    }
+                    objectIndices[name] = static_cast<uint32_t>(_ownedObjects.size());
+                }
+                else if (property == "parent")
+                {
+                    // Parents are defined before their children, so the hierarchy cannot have cycles
+                    std::string parent;
+                    if (!(lineStream >> parent)) {
+                        return fail("parent needs a name");
+                    }
+                    const auto parentIt = objectIndices.find(parent);
+                    if (parentIt == objectIndices.end()) {
+                        return fail("unknown parent " + parent);
+                    }
+                    object.parent = parentIt->second;
+                }
+                else if (property == "group")
+                {
+                    std::string group;
+                    if (!(lineStream >> group)) {
+                        return fail("group needs a name");
+                    }
+                    object.group = addString(group);
+                }
+                else if (property == "pass")
+                {
+                    std::string pass;
+                    if (!(lineStream >> pass)) {
+                        return fail("pass needs a name");
+                    }
+                    if (pass == "unlit") {
+                        object.pass = SCENE_PASS_UNLIT;
+                    }
+                    else if (pass == "opaque") {
+                        object.pass = SCENE_PASS_OPAQUE;
+                    }
+                    else if (pass == "transparent") {
+                        object.pass = SCENE_PASS_TRANSPARENT;
+                    }
+                    else {
+                        return fail("unknown pass " + pass);
+                    }
+                }
+                else {
+                    return fail("invalid object property " + property);
+                }
+            }
+            memcpy(object.model, glm::value_ptr(model), sizeof(object.model));
+            _ownedObjects.push_back(object);
+        }
+        else {
+            return fail("unknown statement " + statement);
+        }
+    }
+
+    for (const auto& object : _ownedObjects)
+    {
+        if (object.material >= std::max<size_t>(_ownedMaterials.size(), 1)) {
+            return fail("object material " + std::to_string(object.material) + " is not defined");
+        }
+    }
+
+    // Objects drawn together end up next to each other, parent indices follow their objects
+    std::vector<uint32_t> order(_ownedObjects.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t indexA, uint32_t indexB) {
+        const auto& a = _ownedObjects[indexA];
+        const auto& b = _ownedObjects[indexB];
+        if (a.pass != b.pass) return a.pass < b.pass;
+        if (a.group != b.group) return a.group < b.group;
+        if (a.mesh != b.mesh) return a.mesh < b.mesh;
+        return a.texture < b.texture;
+    });
+
+    std::vector<uint32_t> sortedIndices(order.size());
+    std::vector<SceneObjectRecord> sortedObjects(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        sortedIndices[order[i]] = static_cast<uint32_t>(i);
+        sortedObjects[i] = _ownedObjects[order[i]];
+    }
+    for (auto& object : sortedObjects)
+    {
+        if (object.parent != NO_PARENT) {
+            object.parent = sortedIndices[object.parent];
+        }
+    }
+    _ownedObjects.swap(sortedObjects);
+
+    if (_ownedStrings.empty()) {
+        _ownedStrings.push_back('\0');
+    }
+    pointToOwnedRecords();
+    return true;
+}
+
+bool SceneFile::loadBinary(const std::string& path)
+{
+    PROFILE_SCOPE("SceneFile::loadBinary");
+    clear();
+
+    if (!_mappedFile.openFile(path)) {
+        return false;
+    }
+    if (!validate(path))
+    {
+        _mappedFile.closeFile();
+        return false;
+    }
+
+    const auto data = _mappedFile.getData();
+    memcpy(&_header, data, sizeof(_header));
+    _meshes = reinterpret_cast<const SceneMeshRecord*>(data + _header.meshesOffset);
+    _textures = reinterpret_cast<const SceneTextureRecord*>(data + _header.texturesOffset);
+    _materials = reinterpret_cast<const SceneMaterialRecord*>(data + _header.materialsOffset);
+    _lights = reinterpret_cast<const SceneLightRecord*>(data + _header.lightsOffset);
+    _objects = reinterpret_cast<const SceneObjectRecord*>(data + _header.objectsOffset);
+    _strings = reinterpret_cast<const char*>(data + _header.stringsOffset);
+    return true;
+}
+
+bool SceneFile::saveBinary(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot write scene " << path << "!" << std::endl;
+        return false;
+    }
+
+    // All records are multiples of 4 bytes, so every array stays 4-byte aligned
+    auto header = _header;
+    memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.meshesOffset = sizeof(SceneFileHeader);
+    header.texturesOffset = header.meshesOffset + header.numMeshes * sizeof(SceneMeshRecord);
+    header.materialsOffset = header.texturesOffset + header.numTextures * sizeof(SceneTextureRecord);
+    header.lightsOffset = header.materialsOffset + header.numMaterials * sizeof(SceneMaterialRecord);
+    header.objectsOffset = header.lightsOffset + header.numLights * sizeof(SceneLightRecord);
+    header.stringsOffset = header.objectsOffset + header.numObjects * sizeof(SceneObjectRecord);
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(_meshes), header.numMeshes * sizeof(SceneMeshRecord));
+    file.write(reinterpret_cast<const char*>(_textures), header.numTextures * sizeof(SceneTextureRecord));
+    file.write(reinterpret_cast<const char*>(_materials), header.numMaterials * sizeof(SceneMaterialRecord));
+    file.write(reinterpret_cast<const char*>(_lights), header.numLights * sizeof(SceneLightRecord));
+    file.write(reinterpret_cast<const char*>(_objects), static_cast<std::streamsize>(header.numObjects) * sizeof(SceneObjectRecord));
+    file.write(_strings, header.stringsSize);
+
+    return static_cast<bool>(file);
+}
+
+uint32_t SceneFile::getNumMeshes() const
+{
+    return _header.numMeshes;
+}
+
+const SceneMeshRecord& SceneFile::getMesh(uint32_t index) const
+{
+    return _meshes[index];
+}
+
+uint32_t SceneFile::getNumTextures() const
+{
+    return _header.numTextures;
+}
+
+const SceneTextureRecord& SceneFile::getTexture(uint32_t index) const
+{
+    return _textures[index];
+}
+
+uint32_t SceneFile::getNumMaterials() const
+{
+    return _header.numMaterials;
+}
+
+const SceneMaterialRecord& SceneFile::getMaterial(uint32_t index) const
+{
+    return _materials[index];
+}
+
+uint32_t SceneFile::getNumLights() const
+{
+    return _header.numLights;
+}
+
+const SceneLightRecord& SceneFile::getLight(uint32_t index) const
+{
+    return _lights[index];
+}
+
+uint32_t SceneFile::getNumObjects() const
+{
+    return _header.numObjects;
+}
+
+const SceneObjectRecord* SceneFile::getObjects() const
+{
+    return _objects;
+}
+
+const char* SceneFile::getString(uint32_t offset) const
+{
+    return offset == NO_STRING ? nullptr : _strings + offset;
+}
+
+const char* SceneFile::getSpecularTexturePath() const
+{
+    return getString(_header.specularTexturePath);
+}
+
+void SceneFile::clear()
+{
+    _mappedFile.closeFile();
+    _ownedMeshes.clear();
+    _ownedTextures.clear();
+    _ownedMaterials.clear();
+    _ownedLights.clear();
+    _ownedObjects.clear();
+    _ownedStrings.clear();
+    _ownedStringOffsets.clear();
+
+    _header = SceneFileHeader();
+    _header.specularTexturePath = NO_STRING;
+    _meshes = nullptr;
+    _textures = nullptr;
+    _materials = nullptr;
+    _lights = nullptr;
+    _objects = nullptr;
+    _strings = nullptr;
+}
+
+uint32_t SceneFile::addString(const std::string& text)
+{
+    // Same names (e.g. groups of many objects) are stored once, so equal offsets mean equal strings
+    const auto offsetIt = _ownedStringOffsets.find(text);
+    if (offsetIt != _ownedStringOffsets.end()) {
+        return offsetIt->second;
+    }
+
+    const auto offset = static_cast<uint32_t>(_ownedStrings.size());
+    _ownedStrings.insert(_ownedStrings.end(), text.begin(), text.end());
+    _ownedStrings.push_back('\0');
+    _ownedStringOffsets.emplace(text, offset);
+    return offset;
+}
+
+void SceneFile::pointToOwnedRecords()
+{
+    _header.numMeshes = static_cast<uint32_t>(_ownedMeshes.size());
+    _header.numTextures = static_cast<uint32_t>(_ownedTextures.size());
+    _header.numMaterials = static_cast<uint32_t>(_ownedMaterials.size());
+    _header.numLights = static_cast<uint32_t>(_ownedLights.size());
+    _header.numObjects = static_cast<uint32_t>(_ownedObjects.size());
+    _header.stringsSize = static_cast<uint32_t>(_ownedStrings.size());
+
+    _meshes = _ownedMeshes.data();
+    _textures = _ownedTextures.data();
+    _materials = _ownedMaterials.data();
+    _lights = _ownedLights.data();
+    _objects = _ownedObjects.data();
+    _strings = _ownedStrings.data();
+}
+
+bool SceneFile::validate(const std::string& path) const
+{
+    const auto data = _mappedFile.getData();
+    const auto size = static_cast<uint64_t>(_mappedFile.getSize());
+    const auto fail = [&path](const std::string& message) {
+        std::cerr << "Scene " << path << " is not valid: " << message << "!" << std::endl;
+        return false;
+    };
+
+    SceneFileHeader header;
+    if (size < sizeof(header)) {
+        return fail("file too short");
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SCENE_MAGIC, sizeof(header.magic)) != 0) {
+        return fail("not a binary scene");
+    }
+    if (header.version != VERSION) {
+        return fail("unsupported version");
+    }
+
+    const auto isArrayInside = [size](uint32_t offset, uint32_t count, size_t recordSize) {
+        return offset % 4 == 0 && uint64_t(offset) + uint64_t(count) * recordSize <= size;
+    };
+    if (!isArrayInside(header.meshesOffset, header.numMeshes, sizeof(SceneMeshRecord))
+        || !isArrayInside(header.texturesOffset, header.numTextures, sizeof(SceneTextureRecord))
+        || !isArrayInside(header.materialsOffset, header.numMaterials, sizeof(SceneMaterialRecord))
+        || !isArrayInside(header.lightsOffset, header.numLights, sizeof(SceneLightRecord))
+        || !isArrayInside(header.objectsOffset, header.numObjects, sizeof(SceneObjectRecord))
+        || !isArrayInside(header.stringsOffset, header.stringsSize, 1)) {
+        return fail("array out of file");
+    }
+
+    // References are checked once here, so that the renderer can use records without checks
+    const auto strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+    if (header.stringsSize == 0 || strings[header.stringsSize - 1] != '\0') {
+        return fail("string table not terminated");
+    }
+    const auto isString = [&header](uint32_t offset) { return offset < header.stringsSize; };
+    if (header.specularTexturePath != NO_STRING && !isString(header.specularTexturePath)) {
+        return fail("invalid specular texture");
+    }
+
+    const auto meshes = reinterpret_cast<const SceneMeshRecord*>(data + header.meshesOffset);
+    for (uint32_t i = 0; i < header.numMeshes; i++)
+    {
+        if (!isString(meshes[i].name) || meshes[i].primitive > SCENE_PRIMITIVE_SPHERE) {
+            return fail("invalid mesh");
+        }
+        const auto parametersError = getMeshParametersError(meshes[i]);
+        if (!parametersError.empty()) {
+            return fail("mesh " + std::to_string(i) + " (" + (strings + meshes[i].name) + "): " + parametersError);
+        }
+    }
+
+    const auto textures = reinterpret_cast<const SceneTextureRecord*>(data + header.texturesOffset);
+    for (uint32_t i = 0; i < header.numTextures; i++)
+    {
+        if (!isString(textures[i].name) || !isString(textures[i].path)) {
+            return fail("invalid texture");
+        }
+    }
+
+    if (header.numMaterials > MAX_MATERIALS) {
+        return fail(std::to_string(header.numMaterials) + " materials, the renderer holds " + std::to_string(MAX_MATERIALS));
+    }
+
+    const auto objects = reinterpret_cast<const SceneObjectRecord*>(data + header.objectsOffset);
+    const auto numMaterials = std::max<uint32_t>(header.numMaterials, 1);
+    for (uint32_t i = 0; i < header.numObjects; i++)
+    {
+        const auto& object = objects[i];
+        if ((object.mesh != NO_MESH && object.mesh >= header.numMeshes)
+            || (object.parent != NO_PARENT && object.parent >= header.numObjects)
+            || (object.texture != NO_TEXTURE && object.texture >= header.numTextures)
+            || object.pass > SCENE_PASS_TRANSPARENT
+            || (object.group != NO_STRING && !isString(object.group))
+            || object.material >= numMaterials) {
+            return fail("invalid object");
+        }
+    }
+
+    // Every parent chain has to end at a root, walks stop at objects already known to be fine
+    std::vector<uint8_t> isChecked(header.numObjects, 0);
+    for (uint32_t i = 0; i < header.numObjects; i++)
+    {
+        uint32_t chainLength = 0;
+        for (auto object = i; object != NO_PARENT && !isChecked[object]; object = objects[object].parent)
+        {
+            if (++chainLength > header.numObjects) {
+                return fail("cyclic object hierarchy");
+            }
+        }
+        for (auto object = i; object != NO_PARENT && !isChecked[object]; object = objects[object].parent) {
+            isChecked[object] = 1;
+        }
+    }
+
+    return true;
+}
@@ -10,10 +10,15 @@
 #include <sstream>
 #include <iostream>
 
+#include "common/uniformTable.h"
+#include "common/glStateCache.h"
+
 class Shader
 {
 public:
 	unsigned int ID;
+	// active uniforms of the linked program, resolved once so setters never ask the driver
+	UniformTable uniforms;
 	// constructor generates the shader on the fly
 	// ------------------------------------------------------------------------
 	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
@@ -90,6 +95,7 @@ public:
 			glAttachShader(ID, geometry);
 		glLinkProgram(ID);
 		checkCompileErrors(ID, "PROGRAM");
+		uniforms.reflectProgram(ID);
 		// delete the shaders as they're linked into our program now and no longer necessery
 		glDeleteShader(vertex);
 		glDeleteShader(fragment);
@@ -101,65 +107,106 @@ public:
 	// ------------------------------------------------------------------------
 	void use()
 	{
-		glUseProgram(ID);
+		GLStateCache::getInstance().useProgram(ID);
 	}
 	// utility uniform functions
 	// ------------------------------------------------------------------------
+	GLint uniformLocation(const std::string &name) const
+	{
+		return uniforms.getLocation(name.c_str());
+	}
+	// ------------------------------------------------------------------------
 	void setBool(const std::string &name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		setBool(uniformLocation(name), value);
+	}
+	void setBool(GLint location, bool value) const
+	{
+		glUniform1i(location, (int)value);
 	}
 	// ------------------------------------------------------------------------
 	void setInt(const std::string &name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		setInt(uniformLocation(name), value);
+	}
+	void setInt(GLint location, int value) const
+	{
+		glUniform1i(location, value);
 	}
 	// ------------------------------------------------------------------------
 	void setFloat(const std::string &name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		setFloat(uniformLocation(name), value);
+	}
+	void setFloat(GLint location, float value) const
+	{
+		glUniform1f(location, value);
 	}
 	// ------------------------------------------------------------------------
 	void setVec2(const std::string &name, const glm::vec2 &value) const
 	{
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec2(uniformLocation(name), value);
+	}
+	void setVec2(GLint location, const glm::vec2 &value) const
+	{
+		glUniform2fv(location, 1, &value[0]);
 	}
 	void setVec2(const std::string &name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		glUniform2f(uniformLocation(name), x, y);
 	}
 	// ------------------------------------------------------------------------
 	void setVec3(const std::string &name, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec3(uniformLocation(name), value);
+	}
+	void setVec3(GLint location, const glm::vec3 &value) const
+	{
+		glUniform3fv(location, 1, &value[0]);
 	}
 	void setVec3(const std::string &name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		glUniform3f(uniformLocation(name), x, y, z);
 	}
 	// ------------------------------------------------------------------------
 	void setVec4(const std::string &name, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec4(uniformLocation(name), value);
+	}
+	void setVec4(GLint location, const glm::vec4 &value) const
+	{
+		glUniform4fv(location, 1, &value[0]);
 	}
 	void setVec4(const std::string &name, float x, float y, float z, float w)
 	{
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		glUniform4f(uniformLocation(name), x, y, z, w);
 	}
 	// ------------------------------------------------------------------------
 	void setMat2(const std::string &name, const glm::mat2 &mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat2(uniformLocation(name), mat);
+	}
+	void setMat2(GLint location, const glm::mat2 &mat) const
+	{
+		glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void setMat3(const std::string &name, const glm::mat3 &mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat3(uniformLocation(name), mat);
+	}
+	void setMat3(GLint location, const glm::mat3 &mat) const
+	{
+		glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
 	}
 	// ------------------------------------------------------------------------
 	void setMat4(const std::string &name, const glm::mat4 &mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat4(uniformLocation(name), mat);
+	}
+	void setMat4(GLint location, const glm::mat4 &mat) const
+	{
+		glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
 	}
 
 private:
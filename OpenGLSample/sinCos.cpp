@@ -0,0 +1,277 @@
+// STL
+#include <cmath>
+#include <cstring>
+
+// SSE2 is the x86 baseline, AVX is compiled in a function of its own and used only where the CPU supports it
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define SIN_COS_SSE
+#define SIN_COS_AVX
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SIN_COS_TARGET_AVX // MSVC compiles AVX intrinsics without /arch:AVX
+#else
+#define SIN_COS_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+// Project
+#include "common/sinCos.h"
+
+const int SinCos::BATCH_SIZE;
+
+namespace
+{
+    const float FOUR_OVER_PI = 1.27323954473516f;
+
+    // pi / 4 split into three parts, products of the first two with the octant are exact
+    const float PI_OVER_FOUR_A = 0.78515625f;
+    const float PI_OVER_FOUR_B = 2.4187564849853515625e-4f;
+    const float PI_OVER_FOUR_C = 3.77489497744594108e-8f;
+
+    // Minimax polynomials on [-pi/4, pi/4], from Cephes sinf and cosf
+    const float SIN_P0 = -1.9515295891e-4f;
+    const float SIN_P1 = 8.3321608736e-3f;
+    const float SIN_P2 = -1.6666654611e-1f;
+    const float COS_P0 = 2.443315711809948e-5f;
+    const float COS_P1 = -1.388731625493765e-3f;
+    const float COS_P2 = 4.166664568298827e-2f;
+
+    typedef void (*BatchFunction)(const float* angles, float* sines, float* cosines);
+
+    void computeBatchScalar(const float* angles, float* sines, float* cosines)
+    {
+        for (int lane = 0; lane < SinCos::BATCH_SIZE; lane++)
+        {
+            auto x = std::fabs(angles[lane]);
+            const auto octant = (static_cast<int>(x * FOUR_OVER_PI) + 1) & ~1;
+            const auto octantFloat = static_cast<float>(octant);
+            x = ((x - octantFloat * PI_OVER_FOUR_A) - octantFloat * PI_OVER_FOUR_B) - octantFloat * PI_OVER_FOUR_C;
+            const auto z = x * x;
+
+            auto cosPolynomial = ((COS_P0 * z + COS_P1) * z + COS_P2) * z * z;
+            cosPolynomial = cosPolynomial - z * 0.5f + 1.0f;
+            const auto sinPolynomial = ((SIN_P0 * z + SIN_P1) * z + SIN_P2) * z * x + x;
+
+            const auto swapPolynomials = (octant & 2) != 0;
+            const auto sine = swapPolynomials ? cosPolynomial : sinPolynomial;
+            const auto cosine = swapPolynomials ? sinPolynomial : cosPolynomial;
+            sines[lane] = std::signbit(angles[lane]) != ((octant & 4) != 0) ? -sine : sine;
+            cosines[lane] = ((octant - 2) & 4) == 0 ? -cosine : cosine;
+        }
+    }
+
+#if defined(SIN_COS_AVX)
+    SIN_COS_TARGET_AVX void computeBatchAvx(const float* angles, float* sines, float* cosines)
+    {
+        const auto signMask = _mm256_set1_ps(-0.0f);
+        const auto angle = _mm256_loadu_ps(angles);
+        auto x = _mm256_andnot_ps(signMask, angle);
+
+        // Even octant j nearest to |angle| * 4 / pi, kept as float (AVX has no 256-bit integer operations).
+        // Quadrant j / 2 modulo 4 selects polynomials and signs, same as the bits of j in the integer versions.
+        const auto truncated = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        const auto quadrant = _mm256_floor_ps(_mm256_mul_ps(_mm256_add_ps(truncated, _mm256_set1_ps(1.0f)), _mm256_set1_ps(0.5f)));
+        const auto octant = _mm256_add_ps(quadrant, quadrant);
+        const auto quadrantMod4 = _mm256_sub_ps(quadrant, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(quadrant, _mm256_set1_ps(0.25f))), _mm256_set1_ps(4.0f)));
+        const auto isOne = _mm256_cmp_ps(quadrantMod4, _mm256_set1_ps(1.0f), _CMP_EQ_OQ);
+        const auto isTwo = _mm256_cmp_ps(quadrantMod4, _mm256_set1_ps(2.0f), _CMP_EQ_OQ);
+        const auto isThree = _mm256_cmp_ps(quadrantMod4, _mm256_set1_ps(3.0f), _CMP_EQ_OQ);
+        const auto swapPolynomials = _mm256_or_ps(isOne, isThree);
+        const auto sinSign = _mm256_xor_ps(_mm256_and_ps(angle, signMask), _mm256_and_ps(_mm256_or_ps(isTwo, isThree), signMask));
+        const auto cosSign = _mm256_and_ps(_mm256_or_ps(isOne, isTwo), signMask);
+
+        x = _mm256_sub_ps(x, _mm256_mul_ps(octant, _mm256_set1_ps(PI_OVER_FOUR_A)));
+        x = _mm256_sub_ps(x, _mm256_mul_ps(octant, _mm256_set1_ps(PI_OVER_FOUR_B)));
+        x = _mm256_sub_ps(x, _mm256_mul_ps(octant, _mm256_set1_ps(PI_OVER_FOUR_C)));
+        const auto z = _mm256_mul_ps(x, x);
+
+        auto cosPolynomial = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P0), z), _mm256_set1_ps(COS_P1));
+        cosPolynomial = _mm256_add_ps(_mm256_mul_ps(cosPolynomial, z), _mm256_set1_ps(COS_P2));
+        cosPolynomial = _mm256_mul_ps(_mm256_mul_ps(cosPolynomial, z), z);
+        cosPolynomial = _mm256_sub_ps(cosPolynomial, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+        cosPolynomial = _mm256_add_ps(cosPolynomial, _mm256_set1_ps(1.0f));
+
+        auto sinPolynomial = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P0), z), _mm256_set1_ps(SIN_P1));
+        sinPolynomial = _mm256_add_ps(_mm256_mul_ps(sinPolynomial, z), _mm256_set1_ps(SIN_P2));
+        sinPolynomial = _mm256_mul_ps(_mm256_mul_ps(sinPolynomial, z), x);
+        sinPolynomial = _mm256_add_ps(sinPolynomial, x);
+
+        // Select by masks, GCC lowers blendv of compare results to scalar code without AVX2
+        const auto sine = _mm256_or_ps(_mm256_and_ps(swapPolynomials, cosPolynomial), _mm256_andnot_ps(swapPolynomials, sinPolynomial));
+        const auto cosine = _mm256_or_ps(_mm256_and_ps(swapPolynomials, sinPolynomial), _mm256_andnot_ps(swapPolynomials, cosPolynomial));
+        _mm256_storeu_ps(sines, _mm256_xor_ps(sine, sinSign));
+        _mm256_storeu_ps(cosines, _mm256_xor_ps(cosine, cosSign));
+    }
+#endif
+
+#if defined(SIN_COS_SSE)
+    void computeHalfBatch(const float* angles, float* sines, float* cosines)
+    {
+        const auto signMask = _mm_set1_ps(-0.0f);
+        const auto angle = _mm_loadu_ps(angles);
+        auto x = _mm_andnot_ps(signMask, angle);
+
+        // Even octant j nearest to |angle| * 4 / pi: bit 1 of j swaps the polynomials, bit 2 negates the sine,
+        // bit 2 of j - 2 is clear where the cosine is negative
+        auto octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+        octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+        const auto octantFloat = _mm_cvtepi32_ps(octant);
+        const auto swapPolynomials = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+        const auto sinSign = _mm_xor_ps(_mm_and_ps(angle, signMask), _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+        const auto cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+        x = _mm_sub_ps(x, _mm_mul_ps(octantFloat, _mm_set1_ps(PI_OVER_FOUR_A)));
+        x = _mm_sub_ps(x, _mm_mul_ps(octantFloat, _mm_set1_ps(PI_OVER_FOUR_B)));
+        x = _mm_sub_ps(x, _mm_mul_ps(octantFloat, _mm_set1_ps(PI_OVER_FOUR_C)));
+        const auto z = _mm_mul_ps(x, x);
+
+        auto cosPolynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+        cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, z), _mm_set1_ps(COS_P2));
+        cosPolynomial = _mm_mul_ps(_mm_mul_ps(cosPolynomial, z), z);
+        cosPolynomial = _mm_sub_ps(cosPolynomial, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+        cosPolynomial = _mm_add_ps(cosPolynomial, _mm_set1_ps(1.0f));
+
+        auto sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+        sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, z), _mm_set1_ps(SIN_P2));
+        sinPolynomial = _mm_mul_ps(_mm_mul_ps(sinPolynomial, z), x);
+        sinPolynomial = _mm_add_ps(sinPolynomial, x);
+
+        // SSE2 has no blend, select by masks
+        const auto sine = _mm_or_ps(_mm_and_ps(swapPolynomials, cosPolynomial), _mm_andnot_ps(swapPolynomials, sinPolynomial));
+        const auto cosine = _mm_or_ps(_mm_and_ps(swapPolynomials, sinPolynomial), _mm_andnot_ps(swapPolynomials, cosPolynomial));
+        _mm_storeu_ps(sines, _mm_xor_ps(sine, sinSign));
+        _mm_storeu_ps(cosines, _mm_xor_ps(cosine, cosSign));
+    }
+
+    void computeBatchSse(const float* angles, float* sines, float* cosines)
+    {
+        computeHalfBatch(angles, sines, cosines);
+        computeHalfBatch(angles + 4, sines + 4, cosines + 4);
+    }
+#endif
+
+    bool isAvxSupported()
+    {
+#if defined(SIN_COS_AVX) && defined(_MSC_VER) && !defined(__clang__)
+        // CPUID.1:ECX bit 28 = AVX, bit 27 = OSXSAVE, XCR0 bits 1 and 2 = the OS saves XMM and YMM registers
+        int cpuInfo[4];
+        __cpuid(cpuInfo, 1);
+        const auto avxAndOsxsave = (1 << 28) | (1 << 27);
+        return (cpuInfo[2] & avxAndOsxsave) == avxAndOsxsave && (_xgetbv(0) & 6) == 6;
+#elif defined(SIN_COS_AVX)
+        // Checks CPUID and XCR0 the same way
+        return __builtin_cpu_supports("avx") != 0;
+#else
+        return false;
+#endif
+    }
+
+    BatchFunction getBatchFunction(SinCos::Kernel kernel)
+    {
+        switch (kernel)
+        {
+#if defined(SIN_COS_AVX)
+        case SinCos::KERNEL_AVX:
+            return computeBatchAvx;
+#endif
+#if defined(SIN_COS_SSE)
+        case SinCos::KERNEL_SSE2:
+            return computeBatchSse;
+#endif
+        default:
+            return computeBatchScalar;
+        }
+    }
+}
+
+SinCos::Kernel SinCos::getKernel()
+{
+    // Selected once, at the first call
+    static const auto kernel = isKernelSupported(KERNEL_AVX) ? KERNEL_AVX : isKernelSupported(KERNEL_SSE2) ? KERNEL_SSE2 : KERNEL_SCALAR;
+    return kernel;
+}
+
+bool SinCos::isKernelSupported(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case KERNEL_SCALAR:
+        return true;
+#if defined(SIN_COS_SSE)
+    case KERNEL_SSE2:
+        return true;
+#endif
+    case KERNEL_AVX:
+    {
+        static const auto hasAvx = isAvxSupported();
+        return hasAvx;
+    }
+    default:
+        return false;
+    }
+}
+
+const char* SinCos::getKernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case KERNEL_SSE2:
+        return "SSE2";
+    case KERNEL_AVX:
+        return "AVX";
+    default:
+        return "scalar";
+    }
+}
+
+void SinCos::compute(const float* angles, size_t count, float* sines, float* cosines)
+{
+    compute(getKernel(), angles, count, sines, cosines);
+}
+
+void SinCos::compute(Kernel kernel, const float* angles, size_t count, float* sines, float* cosines)
+{
+    const auto computeBatch = getBatchFunction(kernel);
+    size_t i = 0;
+    for (; i + BATCH_SIZE <= count; i += BATCH_SIZE) {
+        computeBatch(angles + i, sines + i, cosines + i);
+    }
+
+    // Last angles in a zero-padded batch
+    if (i < count)
+    {
+        float paddedAngles[BATCH_SIZE] = {};
+        float paddedSines[BATCH_SIZE];
+        float paddedCosines[BATCH_SIZE];
+        std::memcpy(paddedAngles, angles + i, (count - i) * sizeof(float));
+        computeBatch(paddedAngles, paddedSines, paddedCosines);
+        std::memcpy(sines + i, paddedSines, (count - i) * sizeof(float));
+        std::memcpy(cosines + i, paddedCosines, (count - i) * sizeof(float));
+    }
+}
+
+void SinCos::computeSteps(float firstAngle, float angleStep, size_t count, float* sines, float* cosines)
+{
+    // Angles are written in chunks of several batches, so that the kernel does not load them right after their stores.
+    // Indices are converted from int, conversion of 64-bit unsigned integers to float is slow without AVX-512.
+    const int CHUNK_SIZE = 32 * BATCH_SIZE;
+    float angles[CHUNK_SIZE];
+    for (size_t i = 0; i < count; i += CHUNK_SIZE)
+    {
+        const auto chunkSize = count - i < CHUNK_SIZE ? static_cast<int>(count - i) : CHUNK_SIZE;
+        const auto firstIndex = static_cast<int>(i);
+        for (auto j = 0; j < chunkSize; j++) {
+            angles[j] = firstAngle + static_cast<float>(firstIndex + j) * angleStep;
+        }
+        compute(angles, chunkSize, sines + i, cosines + i);
+    }
+}
+
+void SinCos::computeCircle(int numSegments, float* sines, float* cosines)
+{
+    const auto angleStep = 2.0f * 3.14159265358979f / numSegments;
+    computeSteps(0.0f, angleStep, numSegments, sines, cosines);
+    sines[numSegments] = sines[0];
+    cosines[numSegments] = cosines[0];
+}
@@ -2,6 +2,7 @@
 
 // Project
 #include "common/staticMesh3D.h"
+#include "common/glStateCache.h"
 #include <glm/glm.hpp>
 
 
@@ -28,6 +29,7 @@ void StaticMesh3D::deleteMesh()
     }
 
     glDeleteVertexArrays(1, &_vao);
+    GLStateCache::getInstance().forgetVertexArray(_vao);
     _vbo.deleteVBO();
 
     _isInitialized = false;
@@ -64,6 +66,16 @@ int StaticMesh3D::getVertexByteSize() const
     return result;
 }
 
+GLuint StaticMesh3D::getVAO() const
+{
+    return _vao;
+}
+
+const Bounds& StaticMesh3D::getBounds() const
+{
+    return _bounds;
+}
+
 void StaticMesh3D::setVertexAttributesPointers(int numVertices)
 {
     uint64_t offset = 0;
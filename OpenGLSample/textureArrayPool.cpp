@@ -0,0 +1,297 @@
+// STL
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// Project
+#include "common/textureArrayPool.h"
+#include "common/glStateCache.h"
+#include "common/profiler.h"
+#include "common/textureCache.h"
+#include "common/uploadCounter.h"
+#include "stb_image.h"
+
+const int TextureArrayPool::MAX_LAYER_SIZE;
+const uint32_t TextureArrayPool::NO_IMAGE;
+
+namespace
+{
+    bool readFile(const std::string& path, std::vector<unsigned char>& data)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // Source pixels contributing to one destination pixel along one axis
+    struct ResampleTaps
+    {
+        int first = 0;
+        std::vector<float> weights;
+    };
+
+    // Area average when shrinking, linear interpolation when enlarging
+    std::vector<ResampleTaps> computeTaps(int sourceSize, int destinationSize)
+    {
+        std::vector<ResampleTaps> result(destinationSize);
+        const auto scale = static_cast<double>(sourceSize) / destinationSize;
+        for (int i = 0; i < destinationSize; i++)
+        {
+            auto& taps = result[i];
+            if (scale > 1.0)
+            {
+                const auto begin = i * scale;
+                const auto end = (i + 1) * scale;
+                taps.first = static_cast<int>(begin);
+                const auto last = std::min(static_cast<int>(std::ceil(end)), sourceSize);
+                for (int source = taps.first; source < last; source++)
+                {
+                    const auto coverage = std::min<double>(source + 1, end) - std::max<double>(source, begin);
+                    taps.weights.push_back(static_cast<float>(coverage / scale));
+                }
+            }
+            else
+            {
+                const auto center = std::max((i + 0.5) * scale - 0.5, 0.0);
+                taps.first = std::min(static_cast<int>(center), sourceSize - 1);
+                const auto fraction = static_cast<float>(center - taps.first);
+                taps.weights.push_back(1.0f - fraction);
+                if (taps.first + 1 < sourceSize) {
+                    taps.weights.push_back(fraction);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // Separable resampling of 8-bit image with interleaved channels, rows first
+    void resampleImage(const unsigned char* source, int sourceWidth, int sourceHeight, int numComponents,
+        int destinationWidth, int destinationHeight, unsigned char* destination)
+    {
+        const auto columnTaps = computeTaps(sourceWidth, destinationWidth);
+        const auto rowTaps = computeTaps(sourceHeight, destinationHeight);
+
+        std::vector<float> rows(static_cast<size_t>(destinationWidth) * sourceHeight * numComponents);
+        for (int y = 0; y < sourceHeight; y++)
+        {
+            const auto* sourceRow = source + static_cast<size_t>(y) * sourceWidth * numComponents;
+            auto* row = &rows[static_cast<size_t>(y) * destinationWidth * numComponents];
+            for (int x = 0; x < destinationWidth; x++)
+            {
+                const auto& taps = columnTaps[x];
+                for (int c = 0; c < numComponents; c++)
+                {
+                    float value = 0.0f;
+                    for (size_t t = 0; t < taps.weights.size(); t++) {
+                        value += taps.weights[t] * sourceRow[(taps.first + t) * numComponents + c];
+                    }
+                    row[x * numComponents + c] = value;
+                }
+            }
+        }
+
+        const auto rowSize = static_cast<size_t>(destinationWidth) * numComponents;
+        std::vector<float> values(rowSize);
+        for (int y = 0; y < destinationHeight; y++)
+        {
+            const auto& taps = rowTaps[y];
+            std::fill(values.begin(), values.end(), 0.0f);
+            for (size_t t = 0; t < taps.weights.size(); t++)
+            {
+                const auto* row = &rows[(taps.first + t) * rowSize];
+                for (size_t i = 0; i < rowSize; i++) {
+                    values[i] += taps.weights[t] * row[i];
+                }
+            }
+
+            auto* destinationRow = destination + y * rowSize;
+            for (size_t i = 0; i < rowSize; i++) {
+                destinationRow[i] = static_cast<unsigned char>(std::min(std::max(values[i] + 0.5f, 0.0f), 255.0f));
+            }
+        }
+    }
+}
+
+uint32_t TextureArrayPool::addImage(const std::string& path)
+{
+    PROFILE_SCOPE("TextureArrayPool::addImage");
+    if (_areArraysCreated)
+    {
+        std::cerr << "Images can be added only before the texture arrays are created!" << std::endl;
+        return NO_IMAGE;
+    }
+
+    auto pathIt = _imagesByPath.find(path);
+    if (pathIt != _imagesByPath.end()) {
+        return pathIt->second;
+    }
+
+    std::vector<unsigned char> fileData;
+    if (!readFile(path, fileData))
+    {
+        std::cerr << "Texture failed to load at path: " << path << std::endl;
+        return NO_IMAGE;
+    }
+
+    // Same file content under another path, share the layer. Hash alone could join different images,
+    // so the candidate's file is read again and compared, which happens only for (rare) duplicates.
+    const auto contentHash = TextureCache::hashContent(fileData.data(), fileData.size());
+    const auto candidates = _imagesByContent.equal_range(contentHash);
+    for (auto contentIt = candidates.first; contentIt != candidates.second; ++contentIt)
+    {
+        const auto& imageFile = _imageFiles[contentIt->second];
+        std::vector<unsigned char> imageFileData;
+        if (imageFile.size == fileData.size() && readFile(imageFile.path, imageFileData) && imageFileData == fileData)
+        {
+            _imagesByPath[path] = contentIt->second;
+            return contentIt->second;
+        }
+    }
+
+    int width, height, numComponents;
+    unsigned char* data = stbi_load_from_memory(fileData.data(), static_cast<int>(fileData.size()), &width, &height, &numComponents, 0);
+    if (data == nullptr)
+    {
+        std::cerr << "Texture failed to decode at path: " << path << std::endl;
+        return NO_IMAGE;
+    }
+
+    // Array class of the same size and number of channels, or a new one
+    const auto layerWidth = getLayerSize(width);
+    const auto layerHeight = getLayerSize(height);
+    auto classIt = std::find_if(_classes.begin(), _classes.end(), [&](const ArrayClass& arrayClass) {
+        return arrayClass.width == layerWidth && arrayClass.height == layerHeight && arrayClass.numComponents == numComponents;
+    });
+    if (classIt == _classes.end())
+    {
+        ArrayClass arrayClass;
+        arrayClass.width = layerWidth;
+        arrayClass.height = layerHeight;
+        arrayClass.numComponents = numComponents;
+        classIt = _classes.insert(_classes.end(), arrayClass);
+    }
+
+    const auto image = static_cast<uint32_t>(_layers.size());
+    TextureLayer layer;
+    layer.layer = static_cast<GLint>(classIt->images.size());
+    classIt->images.push_back(image);
+    _layers.push_back(layer);
+
+    std::vector<unsigned char> pixels(static_cast<size_t>(layerWidth) * layerHeight * numComponents);
+    if (layerWidth == width && layerHeight == height) {
+        std::copy(data, data + pixels.size(), pixels.begin());
+    }
+    else {
+        resampleImage(data, width, height, numComponents, layerWidth, layerHeight, pixels.data());
+    }
+    _pixels.push_back(std::move(pixels));
+    stbi_image_free(data);
+
+    _imageFiles.push_back({ path, fileData.size() });
+    _imagesByPath[path] = image;
+    _imagesByContent.emplace(contentHash, image);
+    return image;
+}
+
+void TextureArrayPool::createArrays()
+{
+    if (_areArraysCreated)
+    {
+        std::cerr << "These texture arrays are already created! You need to delete them before re-creating them!" << std::endl;
+        return;
+    }
+
+    // Rows of 1 and 3 channel images are not 4-byte aligned in general
+    auto& glState = GLStateCache::getInstance();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (auto& arrayClass : _classes)
+    {
+        GLenum format = GL_RGB;
+        if (arrayClass.numComponents == 1)
+            format = GL_RED;
+        else if (arrayClass.numComponents == 2)
+            format = GL_RG;
+        else if (arrayClass.numComponents == 4)
+            format = GL_RGBA;
+
+        const auto numLayers = static_cast<GLsizei>(arrayClass.images.size());
+        glGenTextures(1, &arrayClass.arrayID);
+        glState.bindTexture(GL_TEXTURE_2D_ARRAY, arrayClass.arrayID);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, arrayClass.width, arrayClass.height, numLayers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        for (GLsizei layer = 0; layer < numLayers; layer++)
+        {
+            const auto& pixels = _pixels[arrayClass.images[layer]];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, arrayClass.width, arrayClass.height, 1, format, GL_UNSIGNED_BYTE, pixels.data());
+            UploadCounter::getInstance().addBytes(pixels.size());
+        }
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        for (const auto image : arrayClass.images) {
+            _layers[image].arrayID = arrayClass.arrayID;
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    _pixels = std::vector<std::vector<unsigned char>>();
+    _areArraysCreated = true;
+}
+
+const TextureLayer& TextureArrayPool::getLayer(uint32_t image) const
+{
+    return _layers[image];
+}
+
+size_t TextureArrayPool::getNumImages() const
+{
+    return _layers.size();
+}
+
+size_t TextureArrayPool::getNumArrays() const
+{
+    return _classes.size();
+}
+
+int TextureArrayPool::getLayerSize(int size)
+{
+    int result = 1;
+    while (result < MAX_LAYER_SIZE && result * 2 <= size) {
+        result *= 2;
+    }
+
+    // Next power of two is nearer
+    if (result < MAX_LAYER_SIZE && size - result > result * 2 - size) {
+        result *= 2;
+    }
+    return result;
+}
+
+void TextureArrayPool::deleteArrays()
+{
+    auto& glState = GLStateCache::getInstance();
+    for (const auto& arrayClass : _classes)
+    {
+        if (arrayClass.arrayID != 0)
+        {
+            glDeleteTextures(1, &arrayClass.arrayID);
+            glState.forgetTexture(arrayClass.arrayID);
+        }
+    }
+
+    _layers.clear();
+    _pixels.clear();
+    _classes.clear();
+    _imagesByPath.clear();
+    _imagesByContent.clear();
+    _imageFiles.clear();
+    _areArraysCreated = false;
+}
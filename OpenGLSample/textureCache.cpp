@@ -0,0 +1,181 @@
+// STL
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Project
+#include "common/textureCache.h"
+#include "common/glStateCache.h"
+#include "common/profiler.h"
+#include "common/uploadCounter.h"
+#include "stb_image.h"
+
+namespace
+{
+    bool readFile(const std::string& path, std::vector<unsigned char>& data)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+}
+
+Texture::~Texture()
+{
+    if (textureID != 0) {
+        glDeleteTextures(1, &textureID);
+        GLStateCache::getInstance().forgetTexture(textureID);
+    }
+}
+
+TextureHandle TextureCache::load(const std::string& path)
+{
+    PROFILE_SCOPE("TextureCache::load");
+    auto pathIt = _texturesByPath.find(path);
+    if (pathIt != _texturesByPath.end())
+    {
+        if (auto texture = pathIt->second.lock())
+        {
+            _numHits++;
+            return texture;
+        }
+    }
+
+    std::vector<unsigned char> fileData;
+    if (!readFile(path, fileData))
+    {
+        std::cerr << "Texture failed to load at path: " << path << std::endl;
+        return TextureHandle();
+    }
+
+    // Same file content under another path, share the texture. Hash and size alone could join different images,
+    // so the candidate's file is read again and compared, which happens only for (rare) duplicates.
+    const auto contentHash = hashContent(fileData.data(), fileData.size());
+    const auto candidates = _texturesByContent.equal_range(contentHash);
+    for (auto contentIt = candidates.first; contentIt != candidates.second; ++contentIt)
+    {
+        auto texture = contentIt->second.lock();
+        std::vector<unsigned char> textureFileData;
+        if (texture && texture->contentSize == fileData.size() && readFile(texture->contentPath, textureFileData) && textureFileData == fileData)
+        {
+            _texturesByPath[path] = texture;
+            _numHits++;
+            return texture;
+        }
+    }
+
+    auto texture = createTexture(fileData.data(), fileData.size(), contentHash, path);
+    if (!texture) {
+        return texture;
+    }
+
+    _numDecodes++;
+    _texturesByPath[path] = texture;
+    _texturesByContent.emplace(contentHash, texture);
+    return texture;
+}
+
+void TextureCache::collectGarbage()
+{
+    for (auto it = _texturesByPath.begin(); it != _texturesByPath.end();)
+    {
+        if (it->second.expired()) {
+            it = _texturesByPath.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto it = _texturesByContent.begin(); it != _texturesByContent.end();)
+    {
+        if (it->second.expired()) {
+            it = _texturesByContent.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+size_t TextureCache::getNumTextures() const
+{
+    size_t result = 0;
+    for (const auto& entry : _texturesByContent)
+    {
+        if (!entry.second.expired()) {
+            result++;
+        }
+    }
+
+    return result;
+}
+
+size_t TextureCache::getNumDecodes() const
+{
+    return _numDecodes;
+}
+
+size_t TextureCache::getNumHits() const
+{
+    return _numHits;
+}
+
+uint64_t TextureCache::hashContent(const unsigned char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+TextureHandle TextureCache::createTexture(const unsigned char* fileData, size_t fileSize, uint64_t contentHash, const std::string& path)
+{
+    int width, height, numComponents;
+    unsigned char* data = stbi_load_from_memory(fileData, static_cast<int>(fileSize), &width, &height, &numComponents, 0);
+    if (data == nullptr)
+    {
+        std::cerr << "Texture failed to decode at path: " << path << std::endl;
+        return TextureHandle();
+    }
+
+    GLenum format = GL_RGB;
+    if (numComponents == 1)
+        format = GL_RED;
+    else if (numComponents == 2)
+        format = GL_RG;
+    else if (numComponents == 4)
+        format = GL_RGBA;
+
+    auto texture = std::make_shared<Texture>();
+    texture->width = width;
+    texture->height = height;
+    texture->numComponents = numComponents;
+    texture->contentHash = contentHash;
+    texture->contentSize = fileSize;
+    texture->contentPath = path;
+
+    // Rows of 1 and 3 channel images are not 4-byte aligned in general
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGenTextures(1, &texture->textureID);
+    GLStateCache::getInstance().bindTexture(GL_TEXTURE_2D, texture->textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    UploadCounter::getInstance().addBytes(static_cast<size_t>(width) * height * numComponents);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    stbi_image_free(data);
+    return texture;
+}
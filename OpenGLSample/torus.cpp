@@ -1,53 +1,230 @@
-// Include GLFW
-#include <GLFW/glfw3.h>
+// STL
+#include <vector>
 
-// Include GLM
+// GLM
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 
-#include "torus.h";
+// Project
+#include "torus.h"
+#include "common/glStateCache.h"
+#include "common/jobSystem.h"
+#include "common/profiler.h"
+#include "common/sinCos.h"
 
-using namespace glm;
+namespace static_meshes_3D {
 
-Torus::Torus() {}
+	const int Torus::TANGENT_ATTRIBUTE_INDEX = 9;
 
-void Torus::setCoords(double r, double c, int rSeg, int cSeg, int i, int j, GLfloat* vertices, GLfloat* uv) {
-	const double PI = 3.1415926535897932384626433832795;
-	const double TAU = 2 * PI;
+	namespace
+	{
+		// Two triangles per quad between tube segments i, i + 1 and ring segments j, j + 1, written in place
+		template<typename Index>
+		void addQuadIndices(VertexBufferObject& indicesVBO, int numTubeSegments, int numRingSegments)
+		{
+			const auto verticesPerTubeRow = numRingSegments + 1;
+			const auto allIndices = indicesVBO.allocateData<Index>(static_cast<size_t>(numTubeSegments) * numRingSegments * 6);
+			JobSystem::getInstance().runBands(numTubeSegments, numRingSegments * 6, [&](size_t firstRow, size_t endRow)
+			{
+				auto indices = allIndices + firstRow * numRingSegments * 6;
+				for (auto i = static_cast<int>(firstRow); i < static_cast<int>(endRow); i++)
+				{
+					for (auto j = 0; j < numRingSegments; j++)
+					{
+						const auto vertex = static_cast<Index>(i * verticesPerTubeRow + j);
+						const auto nextTube = static_cast<Index>(vertex + verticesPerTubeRow);
+						indices[0] = vertex;
+						indices[1] = nextTube;
+						indices[2] = static_cast<Index>(vertex + 1);
+						indices[3] = static_cast<Index>(vertex + 1);
+						indices[4] = nextTube;
+						indices[5] = static_cast<Index>(nextTube + 1);
+						indices += 6;
+					}
+				}
+			});
+		}
+	}
+
+	Torus::Torus(float tubeRadius, float ringRadius, int numTubeSegments, int numRingSegments,
+		bool withPositions, bool withTextureCoordinates, bool withNormals, bool withTangents)
+		: StaticMeshIndexed3D(withPositions, withTextureCoordinates, withNormals)
+		, _tubeRadius(tubeRadius)
+		, _ringRadius(ringRadius)
+		, _numTubeSegments(numTubeSegments)
+		, _numRingSegments(numRingSegments)
+		, _hasTangents(withTangents)
+	{
+		initializeData();
+	}
+
+	float Torus::getTubeRadius() const
+	{
+		return _tubeRadius;
+	}
+
+	float Torus::getRingRadius() const
+	{
+		return _ringRadius;
+	}
+
+	bool Torus::hasTangents() const
+	{
+		return _hasTangents;
+	}
+
+	int Torus::getNumIndices() const
+	{
+		return _numIndices;
+	}
+
+	GLenum Torus::getIndexType() const
+	{
+		return _indexType;
+	}
+
+	void Torus::initializeData()
+	{
+		if (_isInitialized) {
+			return;
+		}
+		PROFILE_SCOPE("Torus::initializeData");
+
+		// Bounds are known analytically, the sphere touches the outer equator
+		const auto outerRadius = _ringRadius + _tubeRadius;
+		_bounds = makeBoxBounds(glm::vec3(-outerRadius, -outerRadius, -_tubeRadius), glm::vec3(outerRadius, outerRadius, _tubeRadius));
+		_bounds.sphereRadius = outerRadius;
+
+		// Calculate and cache numbers of vertices and indices
+		_numVertices = (_numTubeSegments + 1) * (_numRingSegments + 1);
+		_numIndices = _numTubeSegments * _numRingSegments * 6;
+		_indexType = _numVertices <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
-	double x = (c + r * cos(i * TAU / rSeg)) * cos(j * TAU / cSeg);
-	double y = (c + r * cos(i * TAU / rSeg)) * sin(j * TAU / cSeg);
-	double z = r * sin(i * TAU / rSeg);
+		// Generate VAO and VBO for vertex attributes
+		glGenVertexArrays(1, &_vao);
+		GLStateCache::getInstance().bindVertexArray(_vao);
+		const auto tangentByteSize = hasTangents() ? static_cast<int>(sizeof(glm::vec4)) : 0;
+		_vbo.createVBO((getVertexByteSize() + tangentByteSize) * _numVertices);
 
-	vertices[0] = 2 * x;
-	vertices[1] = 2 * y;
-	vertices[2] = 2 * z;
+		// Pre-calculate sines / cosines around the tube and around the ring, once per segment instead of once per vertex
+		std::vector<float> tubeCosines(_numTubeSegments + 1), tubeSines(_numTubeSegments + 1);
+		std::vector<float> ringCosines(_numRingSegments + 1), ringSines(_numRingSegments + 1);
+		SinCos::computeCircle(_numTubeSegments, tubeSines.data(), tubeCosines.data());
+		SinCos::computeCircle(_numRingSegments, ringSines.data(), ringCosines.data());
 
-	uv[0] = i / (double)rSeg;
-	uv[1] = j / (double)cSeg;
-}
+		// Attributes are written in place, one block after another, each one by bands of tube rows in parallel.
+		// Every row has its fixed place in the block, so bands need no locking and output does not depend on them
+		const auto verticesPerTubeRow = static_cast<size_t>(_numRingSegments + 1);
+		const auto numTubeRows = static_cast<size_t>(_numTubeSegments + 1);
+		auto& jobSystem = JobSystem::getInstance();
 
-int Torus::createObject(double r, double c, int rSeg, int cSeg, GLfloat** vertices, GLfloat** uv) {
-	int count = rSeg * cSeg * 6;
-	*vertices = (GLfloat*)malloc(count * 3 * sizeof(GLfloat));
-	*uv = (GLfloat*)malloc(count * 2 * sizeof(GLfloat));
+		if (hasPositions())
+		{
+			const auto allPositions = _vbo.allocateData<glm::vec3>(_numVertices);
+			jobSystem.runBands(numTubeRows, verticesPerTubeRow, [&](size_t firstRow, size_t endRow)
+			{
+				auto positions = allPositions + firstRow * verticesPerTubeRow;
+				for (auto i = firstRow; i < endRow; i++, positions += verticesPerTubeRow)
+				{
+					const auto distance = _ringRadius + _tubeRadius * tubeCosines[i];
+					const auto z = _tubeRadius * tubeSines[i];
+					for (auto j = 0; j <= _numRingSegments; j++) {
+						positions[j] = glm::vec3(distance * ringCosines[j], distance * ringSines[j], z);
+					}
+				}
+			});
+		}
+
+		if (hasTextureCoordinates())
+		{
+			const auto allTextureCoordinates = _vbo.allocateData<glm::vec2>(_numVertices);
+			jobSystem.runBands(numTubeRows, verticesPerTubeRow, [&](size_t firstRow, size_t endRow)
+			{
+				auto textureCoordinates = allTextureCoordinates + firstRow * verticesPerTubeRow;
+				for (auto i = firstRow; i < endRow; i++, textureCoordinates += verticesPerTubeRow)
+				{
+					const auto u = float(i) / _numTubeSegments;
+					for (auto j = 0; j <= _numRingSegments; j++) {
+						textureCoordinates[j] = glm::vec2(u, float(j) / _numRingSegments);
+					}
+				}
+			});
+		}
+
+		if (hasNormals())
+		{
+			// Direction from the tube center to the vertex
+			const auto allNormals = _vbo.allocateData<glm::vec3>(_numVertices);
+			jobSystem.runBands(numTubeRows, verticesPerTubeRow, [&](size_t firstRow, size_t endRow)
+			{
+				auto normals = allNormals + firstRow * verticesPerTubeRow;
+				for (auto i = firstRow; i < endRow; i++, normals += verticesPerTubeRow)
+				{
+					for (auto j = 0; j <= _numRingSegments; j++) {
+						normals[j] = glm::vec3(tubeCosines[i] * ringCosines[j], tubeCosines[i] * ringSines[j], tubeSines[i]);
+					}
+				}
+			});
+		}
+
+		if (hasTangents())
+		{
+			// Texture coordinate U goes around the tube, V around the ring: cross(normal, tangent) points against V
+			const auto allTangents = _vbo.allocateData<glm::vec4>(_numVertices);
+			jobSystem.runBands(numTubeRows, verticesPerTubeRow, [&](size_t firstRow, size_t endRow)
+			{
+				auto tangents = allTangents + firstRow * verticesPerTubeRow;
+				for (auto i = firstRow; i < endRow; i++, tangents += verticesPerTubeRow)
+				{
+					for (auto j = 0; j <= _numRingSegments; j++) {
+						tangents[j] = glm::vec4(-tubeSines[i] * ringCosines[j], -tubeSines[i] * ringSines[j], tubeCosines[i], -1.0f);
+					}
+				}
+			});
+		}
+
+		// Finally upload data to the GPU
+		_vbo.bindVBO();
+		_vbo.uploadDataToGPU(GL_STATIC_DRAW);
+		setVertexAttributesPointers(_numVertices);
+		if (hasTangents())
+		{
+			glEnableVertexAttribArray(TANGENT_ATTRIBUTE_INDEX);
+			glVertexAttribPointer(TANGENT_ATTRIBUTE_INDEX, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), reinterpret_cast<void*>(static_cast<uint64_t>(getVertexByteSize()) * _numVertices));
+		}
 
-	for (int x = 0; x < cSeg; x++) { // through stripes
-		for (int y = 0; y < rSeg; y++) { // through squares on stripe
-			GLfloat* vertexPtr = *vertices + ((x * rSeg) + y) * 18;
-			GLfloat* uvPtr = *uv + ((x * rSeg) + y) * 12;
-			setCoords(r, c, rSeg, cSeg, x, y, vertexPtr + 0, uvPtr + 0);
-			setCoords(r, c, rSeg, cSeg, x + 1, y, vertexPtr + 3, uvPtr + 2);
-			setCoords(r, c, rSeg, cSeg, x, y + 1, vertexPtr + 6, uvPtr + 4);
+		// Indices stay bound to the VAO
+		_indicesVBO.createVBO(_numIndices * (_indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)));
+		if (_indexType == GL_UNSIGNED_SHORT) {
+			addQuadIndices<GLushort>(_indicesVBO, _numTubeSegments, _numRingSegments);
+		}
+		else {
+			addQuadIndices<GLuint>(_indicesVBO, _numTubeSegments, _numRingSegments);
+		}
+		_indicesVBO.bindVBO(GL_ELEMENT_ARRAY_BUFFER);
+		_indicesVBO.uploadDataToGPU(GL_STATIC_DRAW);
 
-			setCoords(r, c, rSeg, cSeg, x, y + 1, vertexPtr + 9, uvPtr + 6);
-			setCoords(r, c, rSeg, cSeg, x + 1, y, vertexPtr + 12, uvPtr + 8);
-			setCoords(r, c, rSeg, cSeg, x + 1, y + 1, vertexPtr + 15,
-				uvPtr + 10);
+		_isInitialized = true;
+	}
+
+	void Torus::render() const
+	{
+		if (!_isInitialized) {
+			return;
 		}
+
+		GLStateCache::getInstance().bindVertexArray(_vao);
+		glDrawElements(GL_TRIANGLES, _numIndices, _indexType, nullptr);
+	}
+
+	void Torus::renderPoints() const
+	{
+		if (!_isInitialized) {
+			return;
+		}
+
+		// Every vertex once, seam vertices twice
+		GLStateCache::getInstance().bindVertexArray(_vao);
+		glDrawArrays(GL_POINTS, 0, _numVertices);
 	}
 
-	this->vertices = count;
-	
-	return count;
-}
\ No newline at end of file
+} // namespace static_meshes_3D
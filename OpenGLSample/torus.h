@@ -1,11 +1,59 @@
 #pragma once
-#include <GLFW/glfw3.h>
-class Torus {
-public:
-	Torus();
-	void setCoords(double r, double c, int rSeg, int cSeg, int i, int j, GLfloat* vertices, GLfloat* uv);
-	int createObject(double r, double c, int rSeg, int cSeg, GLfloat** vertices, GLfloat** uv);
-	int getVertices() { return this->vertices; };
-private:
-	int vertices;
-};
\ No newline at end of file
+#include "common/staticMeshIndexed3D.h"
+
+namespace static_meshes_3D {
+
+	/**
+	* Torus static mesh with given tube radius, ring radius and numbers of segments around both circles.
+	* Vertices are shared by the neighbouring quads, (numTubeSegments + 1) * (numRingSegments + 1) of them
+	* (seam vertices are repeated, so that texture coordinates wrap), with analytic normals and tangents.
+	* Triangles are drawn with 16-bit indices, or 32-bit ones if there are too many vertices.
+	*/
+	class Torus : public StaticMeshIndexed3D
+	{
+	public:
+		static const int TANGENT_ATTRIBUTE_INDEX; //!< Vertex attribute index of vertex tangent (9, after the instance attributes)
+
+		Torus(float tubeRadius, float ringRadius, int numTubeSegments, int numRingSegments,
+			bool withPositions = true, bool withTextureCoordinates = true, bool withNormals = true, bool withTangents = true);
+
+		void render() const override;
+		void renderPoints() const override;
+
+		/**
+		 * Gets radius of the tube.
+		 */
+		float getTubeRadius() const;
+
+		/**
+		 * Gets distance of the tube center from the torus center.
+		 */
+		float getRingRadius() const;
+
+		/**
+		 * Checks, if the torus has vertex tangents: xyz = direction of texture coordinate U, w = sign of the bitangent.
+		 */
+		bool hasTangents() const;
+
+		/**
+		 * Gets number of indices of the triangle list.
+		 */
+		int getNumIndices() const;
+
+		/**
+		 * Gets type of the indices, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+		 */
+		GLenum getIndexType() const;
+
+	private:
+		float _tubeRadius; // Radius of the tube
+		float _ringRadius; // Distance of the tube center from the torus center
+		int _numTubeSegments; // Segments around the tube
+		int _numRingSegments; // Segments around the torus center
+		bool _hasTangents; // Flag telling, if we have vertex tangents
+		GLenum _indexType = GL_UNSIGNED_SHORT;
+
+		void initializeData() override;
+	};
+
+} // namespace static_meshes_3D
@@ -0,0 +1,103 @@
+// STL
+#include <algorithm>
+#include <iostream>
+
+// Project
+#include "common/transformHierarchy.h"
+#include "common/profiler.h"
+
+const uint32_t TransformHierarchy::NO_PARENT;
+
+uint32_t TransformHierarchy::addNode(uint32_t parent, const glm::mat4& localMatrix)
+{
+    const auto node = getNumNodes();
+    if (parent != NO_PARENT && parent >= node)
+    {
+        std::cerr << "Parent " << parent << " of transform node " << node << " has to be added before it, adding it as a root!" << std::endl;
+        parent = NO_PARENT;
+    }
+
+    _parents.push_back(parent);
+    _localMatrices.push_back(localMatrix);
+    _worldMatrices.push_back(localMatrix);
+    _isDirty.push_back(1);
+    _hasChanged.push_back(0);
+    _firstDirtyNode = std::min(_firstDirtyNode, node);
+    return node;
+}
+
+void TransformHierarchy::setLocalMatrix(uint32_t node, const glm::mat4& localMatrix)
+{
+    _localMatrices[node] = localMatrix;
+    _isDirty[node] = 1;
+    _firstDirtyNode = std::min(_firstDirtyNode, node);
+}
+
+const glm::mat4& TransformHierarchy::getLocalMatrix(uint32_t node) const
+{
+    return _localMatrices[node];
+}
+
+const glm::mat4& TransformHierarchy::getWorldMatrix(uint32_t node) const
+{
+    return _worldMatrices[node];
+}
+
+uint32_t TransformHierarchy::getParent(uint32_t node) const
+{
+    return _parents[node];
+}
+
+uint32_t TransformHierarchy::getNumNodes() const
+{
+    return static_cast<uint32_t>(_parents.size());
+}
+
+size_t TransformHierarchy::update()
+{
+    for (const auto node : _changedNodes) {
+        _hasChanged[node] = 0;
+    }
+    _changedNodes.clear();
+
+    if (_firstDirtyNode == NO_PARENT) {
+        return 0;
+    }
+
+    PROFILE_SCOPE("TransformHierarchy::update");
+
+    // Parent precedes its children, so its world matrix and changed flag are final when a child is visited
+    const auto numNodes = getNumNodes();
+    for (auto node = _firstDirtyNode; node < numNodes; node++)
+    {
+        const auto parent = _parents[node];
+        const bool isParentChanged = parent != NO_PARENT && _hasChanged[parent];
+        if (!_isDirty[node] && !isParentChanged) {
+            continue;
+        }
+
+        _worldMatrices[node] = parent == NO_PARENT ? _localMatrices[node] : _worldMatrices[parent] * _localMatrices[node];
+        _isDirty[node] = 0;
+        _hasChanged[node] = 1;
+        _changedNodes.push_back(node);
+    }
+
+    _firstDirtyNode = NO_PARENT;
+    return _changedNodes.size();
+}
+
+const std::vector<uint32_t>& TransformHierarchy::getChangedNodes() const
+{
+    return _changedNodes;
+}
+
+void TransformHierarchy::clear()
+{
+    _parents.clear();
+    _localMatrices.clear();
+    _worldMatrices.clear();
+    _isDirty.clear();
+    _hasChanged.clear();
+    _changedNodes.clear();
+    _firstDirtyNode = NO_PARENT;
+}
@@ -0,0 +1,112 @@
+// STL
+#include <iostream>
+#include <cstring>
+
+// Project
+#include "common/uniformBufferObject.h"
+#include "common/glStateCache.h"
+#include "common/uploadCounter.h"
+
+void UniformBufferObject::createUBO(GLuint bindingPoint, size_t sizeBytes)
+{
+    if (_isBufferCreated)
+    {
+        std::cerr << "This uniform buffer is already created! You need to delete it before re-creating it!" << std::endl;
+        return;
+    }
+
+    _bindingPoint = bindingPoint;
+    _rawData.assign(sizeBytes, 0);
+
+    glGenBuffers(1, &_bufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, _bufferID);
+    glBufferData(GL_UNIFORM_BUFFER, sizeBytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, _bindingPoint, _bufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    _isBufferCreated = true;
+    _isDirty = true;
+}
+
+bool UniformBufferObject::bindToProgram(GLuint programID, const char* blockName) const
+{
+    const auto blockIndex = glGetUniformBlockIndex(programID, blockName);
+    if (blockIndex == GL_INVALID_INDEX) {
+        return false;
+    }
+
+    glUniformBlockBinding(programID, blockIndex, _bindingPoint);
+    return true;
+}
+
+void UniformBufferObject::setRawData(const void* ptrData, size_t dataSizeBytes, size_t offset)
+{
+    if (offset + dataSizeBytes > _rawData.size())
+    {
+        std::cerr << "Data written to uniform buffer " << _bufferID << " exceed its size!" << std::endl;
+        return;
+    }
+
+    if (memcmp(_rawData.data() + offset, ptrData, dataSizeBytes) != 0)
+    {
+        memcpy(_rawData.data() + offset, ptrData, dataSizeBytes);
+        _isDirty = true;
+    }
+}
+
+bool UniformBufferObject::uploadIfDirty()
+{
+    if (!_isBufferCreated || !_isDirty) {
+        return false;
+    }
+
+    GLStateCache::getInstance().bindBuffer(GL_UNIFORM_BUFFER, _bufferID);
+    // Invalidating whole range lets the driver hand out fresh memory instead of waiting for draws still reading the old block
+    auto ptrMapped = glMapBufferRange(GL_UNIFORM_BUFFER, 0, _rawData.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (ptrMapped != nullptr)
+    {
+        memcpy(ptrMapped, _rawData.data(), _rawData.size());
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    else {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, _rawData.size(), _rawData.data());
+    }
+
+    _isDirty = false;
+    _numUploads++;
+    UploadCounter::getInstance().addBytes(_rawData.size());
+    return true;
+}
+
+bool UniformBufferObject::isDirty() const
+{
+    return _isDirty;
+}
+
+size_t UniformBufferObject::getNumUploads() const
+{
+    return _numUploads;
+}
+
+GLuint UniformBufferObject::getBufferID() const
+{
+    return _bufferID;
+}
+
+GLuint UniformBufferObject::getBindingPoint() const
+{
+    return _bindingPoint;
+}
+
+void UniformBufferObject::deleteUBO()
+{
+    if (!_isBufferCreated) {
+        return;
+    }
+
+    glDeleteBuffers(1, &_bufferID);
+    GLStateCache::getInstance().forgetBuffer(_bufferID);
+    _rawData.clear();
+    _isBufferCreated = false;
+    _isDirty = false;
+}
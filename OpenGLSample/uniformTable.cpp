@@ -0,0 +1,92 @@
+// STL
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// Project
+#include "common/uniformTable.h"
+
+void UniformTable::reflectProgram(GLuint programID)
+{
+    _programID = programID;
+    _entries.clear();
+
+    GLint numUniforms = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+    for (GLint i = 0; i < numUniforms; i++)
+    {
+        GLsizei nameLength = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, i, (GLsizei)nameBuffer.size(), &nameLength, &arraySize, &type, nameBuffer.data());
+
+        std::string name(nameBuffer.data(), nameLength);
+        const auto location = glGetUniformLocation(programID, name.c_str());
+        if (location == -1) {
+            continue; // Member of an uniform block, these are not set through locations
+        }
+
+        // Arrays are reported as "name[0]", register the plain name and every element
+        const auto bracket = name.rfind("[0]");
+        if (bracket == std::string::npos || bracket + 3 != name.size())
+        {
+            addEntry(name.c_str(), location);
+            continue;
+        }
+
+        const auto baseName = name.substr(0, bracket);
+        addEntry(baseName.c_str(), location);
+        for (GLint element = 0; element < arraySize; element++)
+        {
+            const auto elementName = baseName + "[" + std::to_string(element) + "]";
+            addEntry(elementName.c_str(), glGetUniformLocation(programID, elementName.c_str()));
+        }
+    }
+
+    std::sort(_entries.begin(), _entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    for (size_t i = 1; i < _entries.size(); i++)
+    {
+        if (_entries[i].key == _entries[i - 1].key && _entries[i].location != _entries[i - 1].location) {
+            std::cerr << "Uniform name hash collision in program " << programID << "! Rename one of the uniforms." << std::endl;
+        }
+    }
+}
+
+GLint UniformTable::getLocation(uint32_t key) const
+{
+    const auto it = std::lower_bound(_entries.begin(), _entries.end(), key, [](const Entry& entry, uint32_t k) { return entry.key < k; });
+    if (it == _entries.end() || it->key != key) {
+        return -1;
+    }
+
+    return it->location;
+}
+
+GLint UniformTable::getLocation(const char* name) const
+{
+    return getLocation(uniformKey(name));
+}
+
+bool UniformTable::hasUniform(uint32_t key) const
+{
+    return getLocation(key) != -1;
+}
+
+GLuint UniformTable::getProgramID() const
+{
+    return _programID;
+}
+
+size_t UniformTable::getNumUniforms() const
+{
+    return _entries.size();
+}
+
+void UniformTable::addEntry(const char* name, GLint location)
+{
+    _entries.push_back({ uniformKey(name), location });
+}
@@ -0,0 +1,23 @@
+// Project
+#include "common/uploadCounter.h"
+
+UploadCounter& UploadCounter::getInstance()
+{
+    static UploadCounter instance;
+    return instance;
+}
+
+void UploadCounter::addBytes(size_t numBytes)
+{
+    _numBytes += numBytes;
+}
+
+size_t UploadCounter::getNumBytes() const
+{
+    return _numBytes;
+}
+
+void UploadCounter::reset()
+{
+    _numBytes = 0;
+}
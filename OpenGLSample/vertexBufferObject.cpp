@@ -4,6 +4,8 @@
 
 // Project
 #include "common/vertexBufferObject.h"
+#include "common/glStateCache.h"
+#include "common/uploadCounter.h"
 
 void VertexBufferObject::createVBO(size_t reserveSizeBytes)
 {
@@ -20,10 +22,6 @@ void VertexBufferObject::createVBO(size_t reserveSizeBytes)
     _isBufferCreated = true;
 }
 
-//void VertexBufferObject::createVBO(uint32_t reserveSizeBytes)
-//{
-//}
-
 void VertexBufferObject::bindVBO(GLenum bufferType)
 {
     if (!_isBufferCreated)
@@ -33,17 +31,22 @@ void VertexBufferObject::bindVBO(GLenum bufferType)
     }
 
     _bufferType = bufferType;
-    glBindBuffer(_bufferType, _bufferID);
+    GLStateCache::getInstance().bindBuffer(_bufferType, _bufferID);
 }
 
-//void VertexBufferObject::addRawData(const void* ptrData, uint32_t dataSizeBytes, int repeat)
-//{
-//}
-
 void VertexBufferObject::addRawData(const void* ptrData, size_t dataSize, int repeat)
 {
-    const auto bytesToAdd = dataSize * repeat;
-    const auto requiredCapacity = _bytesAdded + bytesToAdd;
+    auto ptrDestination = static_cast<unsigned char*>(allocateRawData(dataSize * repeat));
+    for (int i = 0; i < repeat; i++)
+    {
+        memcpy(ptrDestination, ptrData, dataSize);
+        ptrDestination += dataSize;
+    }
+}
+
+void* VertexBufferObject::allocateRawData(size_t dataSizeBytes)
+{
+    const auto requiredCapacity = _bytesAdded + dataSizeBytes;
     if (requiredCapacity > _rawData.capacity())
     {
         auto newCapacity = _rawData.capacity() * 2;
@@ -57,11 +60,9 @@ void VertexBufferObject::addRawData(const void* ptrData, size_t dataSize, int re
         _rawData = std::move(newRawData);
     }
 
-    for (int i = 0; i < repeat; i++)
-    {
-        memcpy(_rawData.data() + _bytesAdded, ptrData, dataSize);
-        _bytesAdded += dataSize;
-    }
+    const auto ptrData = _rawData.data() + _bytesAdded;
+    _bytesAdded += dataSizeBytes;
+    return ptrData;
 }
 
 void* VertexBufferObject::getRawDataPointer()
@@ -78,6 +79,7 @@ void VertexBufferObject::uploadDataToGPU(GLenum usageHint)
     }
 
     glBufferData(_bufferType, _bytesAdded, _rawData.data(), usageHint);
+    UploadCounter::getInstance().addBytes(_bytesAdded);
     _isDataUploaded = true;
     _uploadedDataSize = _bytesAdded;
     _bytesAdded = 0;
@@ -111,28 +113,125 @@ GLuint VertexBufferObject::getBufferID() const
     return _bufferID;
 }
 
-void* VertexBufferObject::mapBufferToMemory(GLenum usageHint)
+size_t VertexBufferObject::getBufferSize()
+{
+    return _isDataUploaded ? _uploadedDataSize : _bytesAdded;
+}
+
+void VertexBufferObject::createStreamingVBO(size_t regionSizeBytes, int numRegions, GLenum bufferType)
 {
-    return nullptr;
+    if (_isBufferCreated)
+    {
+        std::cerr << "This buffer is already created! You need to delete it before re-creating it!" << std::endl;
+        return;
+    }
+
+    _bufferType = bufferType;
+    _regionSizeBytes = regionSizeBytes;
+    _regionFences.assign(numRegions, nullptr);
+    _currentRegion = -1;
+    _regionBytesUsed = 0;
+
+    // Storage is allocated once and never re-specified, regions are recycled instead
+    glGenBuffers(1, &_bufferID);
+    GLStateCache::getInstance().bindBuffer(_bufferType, _bufferID);
+    glBufferData(_bufferType, _regionSizeBytes * numRegions, nullptr, GL_STREAM_DRAW);
+
+    std::cout << "Created streaming buffer object with ID " << _bufferID << " and " << numRegions << " regions of " << _regionSizeBytes << " bytes" << std::endl;
+    _isBufferCreated = true;
+    _isDataUploaded = true;
+    _isStreaming = true;
+    _uploadedDataSize = _regionSizeBytes * numRegions;
 }
 
-void* VertexBufferObject::mapSubBufferToMemory(GLenum usageHint, uint32_t offset, uint32_t length)
+bool VertexBufferObject::beginStreamingRegion()
 {
-    return nullptr;
+    if (!_isStreaming)
+    {
+        std::cerr << "This buffer is not a streaming buffer! Call createStreamingVBO first!" << std::endl;
+        return false;
+    }
+
+    if (_ptrMappedRegion != nullptr) {
+        endStreamingRegion();
+    }
+
+    // All commands using the previous region have been issued by now, so its fence can be placed
+    if (_currentRegion >= 0) {
+        _regionFences[_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    _currentRegion = (_currentRegion + 1) % static_cast<int>(_regionFences.size());
+    _regionBytesUsed = 0;
+
+    auto& fence = _regionFences[_currentRegion];
+    if (fence != nullptr)
+    {
+        // First check without waiting, the region is usually free already, when there are enough regions
+        auto waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (waitResult == GL_TIMEOUT_EXPIRED)
+        {
+            _numStreamingWaits++;
+            do {
+                waitResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (waitResult == GL_TIMEOUT_EXPIRED);
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    // GPU is not using the region anymore, so there is nothing to synchronize with
+    const auto regionOffset = _regionSizeBytes * _currentRegion;
+    GLStateCache::getInstance().bindBuffer(_bufferType, _bufferID);
+    _ptrMappedRegion = static_cast<unsigned char*>(glMapBufferRange(_bufferType, regionOffset, _regionSizeBytes,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+
+    return _ptrMappedRegion != nullptr;
 }
 
-void VertexBufferObject::unmapBuffer()
+void* VertexBufferObject::allocateStreamingData(size_t sizeBytes, size_t alignment, size_t& bufferOffset)
 {
+    if (_ptrMappedRegion == nullptr) {
+        return nullptr;
+    }
+
+    auto offset = _regionBytesUsed;
+    if (alignment > 1) {
+        offset = (offset + alignment - 1) / alignment * alignment;
+    }
+
+    if (offset + sizeBytes > _regionSizeBytes)
+    {
+        std::cerr << "Streaming buffer " << _bufferID << " region is full, cannot allocate " << sizeBytes << " bytes!" << std::endl;
+        return nullptr;
+    }
+
+    _regionBytesUsed = offset + sizeBytes;
+    bufferOffset = _regionSizeBytes * _currentRegion + offset;
+    return _ptrMappedRegion + offset;
 }
 
-GLuint VertexBufferObject::getBufferID()
+void VertexBufferObject::endStreamingRegion()
 {
-    return GLuint();
+    if (_ptrMappedRegion == nullptr) {
+        return;
+    }
+
+    // Only the bytes really written have to be made visible to the GPU
+    GLStateCache::getInstance().bindBuffer(_bufferType, _bufferID);
+    if (_regionBytesUsed > 0)
+    {
+        glFlushMappedBufferRange(_bufferType, 0, _regionBytesUsed);
+        UploadCounter::getInstance().addBytes(_regionBytesUsed);
+    }
+    glUnmapBuffer(_bufferType);
+    _ptrMappedRegion = nullptr;
 }
 
-size_t VertexBufferObject::getBufferSize()
+size_t VertexBufferObject::getNumStreamingWaits() const
 {
-    return _isDataUploaded ? _uploadedDataSize : _bytesAdded;
+    return _numStreamingWaits;
 }
 
 void VertexBufferObject::deleteVBO()
@@ -142,7 +241,21 @@ void VertexBufferObject::deleteVBO()
     }
 
     std::cout << "Deleting vertex buffer object with ID " << _bufferID << "..." << std::endl;
+    if (_ptrMappedRegion != nullptr) {
+        endStreamingRegion();
+    }
+    for (auto& fence : _regionFences)
+    {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    _regionFences.clear();
+
     glDeleteBuffers(1, &_bufferID);
+    GLStateCache::getInstance().forgetBuffer(_bufferID);
     _isDataUploaded = false;
     _isBufferCreated = false;
+    _isStreaming = false;
+    _currentRegion = -1;
 }